@@ -23,12 +23,24 @@
 *   #define PHYSAC_NO_THREADS
 *       The generated implementation won't include pthread library and user must create a secondary thread to call PhysicsThread().
 *       It is so important that the thread where PhysicsThread() is called must not have v-sync or any other CPU limitation.
+*       Islands are solved on the thread running the physics step (SetPhysicsThreads() has no effect).
+*
+*   #define PHYSAC_NO_LOOP_THREAD
+*       InitPhysics() won't create the physics loop thread, so RunPhysicsStep() must be called by the user,
+*       but islands can still be solved by several threads (see SetPhysicsThreads()).
+*
+*   #define PHYSAC_MAX_COMMANDS
+*       You can define your own size of the commands queue (power of 2) before including this file.
 *
 *   #define PHYSAC_STANDALONE
 *       Avoid raylib.h header inclusion in this file. Data types defined on raylib are defined
 *       internally in the library and input management and drawing functions must be provided by
 *       the user (check library implementation for further details).
 *
+*   #define PHYSAC_DETERMINISTIC
+*       Physics steps give exactly the same results on every build and platform, so lockstep games only need
+*       to send their inputs between peers (see DETERMINISM).
+*
 *   #define PHYSAC_DEBUG
 *       Traces log messages when creating and destroying physics bodies and detects errors in physics
 *       calculations and reference exceptions; it is useful for debug purposes
@@ -38,6 +50,115 @@
 *       You can define your own malloc/free implementation replacing stdlib.h malloc()/free() functions.
 *       Otherwise it will include stdlib.h and use the C standard library malloc()/free() function.
 *
+*   #define PHYSAC_MAX_MANIFOLDS
+*       You can define your own limit of physics manifolds (collisions solved each step) before including this file.
+*
+*   #define PHYSAC_COLLISION_ITERATIONS
+*       You can define your own default amount of collision solver iterations before including this file
+*       (10 by default, it can be changed at runtime with SetPhysicsCollisionIterations()).
+*
+*   BODIES STORAGE:
+*
+*   Physics bodies are allocated in chunks of PHYSAC_BODIES_CHUNK bodies that are never moved, so PhysicsBody
+*   pointers stay valid while more bodies are created. Bodies count is only limited by memory.
+*   Every step, bodies hot data (position, velocity, forces, orientation and inverse mass/inertia) is copied
+*   into contiguous arrays that the integration and solver loops work on, and copied back at the end of the step.
+*   NOTE: Destroying a physics body moves the last created body to its index (GetPhysicsBody() order changes).
+*
+*   #define PHYSAC_NO_SIMD
+*       Disables SSE2/AVX2 kernels. Otherwise on x86 CPUs bodies integration and polygons support points
+*       use SIMD instructions, chosen at InitPhysics() from the ones the CPU supports (see SetPhysicsSimd()).
+*       While SIMD kernels are compiled, multiplications and additions are not fused (FMA) inside implementation,
+*       so every kernel gives the same results.
+*
+*   BROADPHASE:
+*
+*   Before solving collisions, bodies axis aligned bounding boxes are used to find pairs of bodies that
+*   can be colliding, so bodies far away from each other are never tested. It can be chosen with
+*   SetPhysicsBroadphase():
+*       PHYSICS_BROADPHASE_GRID (default): uniform grid spatial hash, cell size set with SetPhysicsGridCellSize()
+*           or chosen from average bodies size. Good for many bodies of similar size.
+*       PHYSICS_BROADPHASE_SAP: sweep and prune along x axis, keeps bodies sorted between steps so sorting
+*           is almost free when bodies move little. Good for bodies of very different sizes.
+*       PHYSICS_BROADPHASE_NONE: tests every pair of bodies (previous behaviour).
+*
+*   ISLANDS:
+*
+*   Every step, colliding bodies are grouped in islands with union-find. Bodies of different islands never touch
+*   (disabled bodies like the ground don't join islands), so islands are solved in parallel by the threads set with
+*   SetPhysicsThreads(), each one taking the next unsolved island until none is left. An island solves its manifolds
+*   in the same order a single thread would, so results are exactly the same for any amount of threads.
+*
+*   SPATIAL QUERIES:
+*
+*   PhysicsRaycast(), PhysicsCircleCast(), PhysicsQueryAABB() and PhysicsQueryPoint() find bodies using the same
+*   uniform grid as the broadphase, built again on the first query after bodies move (any broadphase type).
+*   Casts return hits sorted by distance and don't report bodies already overlapping their origin.
+*   NOTE: Queries must not run while a physics step is running, and after changing bodies position directly
+*   results are not updated until next step. While the physics thread runs, they read and rebuild bodies it owns,
+*   so they return -1 when called from any other thread (see PHYSICS THREAD).
+*   PhysicsStateRaycast(), PhysicsStateCircleCast(), PhysicsStateQueryAABB() and PhysicsStateQueryPoint() answer the
+*   same queries against a published PhysicsState (bodies in its last step) from any thread, returning bodies indices
+*   in state. They test every body of the state without grid, so they are slower with many bodies.
+*
+*   CONTINUOUS COLLISION DETECTION:
+*
+*   Bodies with isBullet set don't tunnel through other bodies when they move farther than their own size in a
+*   step. After the step, the shape core (circle radius, or polygon inner circle) is cast along the motion
+*   against the bodies in their new position, and the body is moved back to the first time of impact, so
+*   next step collision solves it. Only enable it on fast bodies, each moving bullet costs a circle cast.
+*
+*   SOLVER:
+*
+*   Collisions are solved with sequential impulses: each contact point accumulates the impulses applied to it,
+*   keeping the normal impulse pushing bodies apart and the friction impulse inside the friction cone. Contact
+*   points are matched with the ones of previous step by bodies pair and shape features (faces and vertices that
+*   made them), and their accumulated impulses are applied again at the start of the step (warm starting), so
+*   resting contacts are solved with a few iterations. It can be disabled with SetPhysicsWarmStarting(false).
+*
+*   SLEEPING:
+*
+*   Islands whose bodies stay below PHYSAC_SLEEP_VELOCITY (plus the velocity gravity adds in a step) for
+*   PHYSAC_SLEEP_TIME are put to sleep: they are not integrated nor solved, and collisions between sleeping
+*   bodies are not solved, until an awake body touches one of them or a force, torque or rotation is applied
+*   to one of them. Then every body that fell asleep with it wakes up. Sleeping can be disabled with
+*   SetPhysicsSleeping(false). After changing bodies position or velocity directly, call PhysicsWakeBody().
+*   Disabled bodies never sleep, so waking or destroying one wakes up the bodies touching or overlapping it.
+*
+*   DETERMINISM:
+*
+*   Physics steps only use float additions, multiplications, divisions and square roots, rounded the same by any
+*   IEEE 754 CPU, except for C library sines and cosines (they differ between platforms), SIMD kernels (chosen at
+*   runtime from CPU) and compilers fusing multiplications and additions (FMA). With PHYSAC_DETERMINISTIC:
+*     - Sines and cosines are computed with own polynomials, and SIMD kernels are disabled (PHYSAC_NO_SIMD).
+*     - Multiplications and additions are not fused inside implementation (GCC, Clang and MSVC pragmas).
+*     - Compilation fails if floats are computed with extra precision (x87 FPU) or with -ffast-math.
+*   Islands already give the same results for any amount of threads. A lockstep game defines PHYSAC_NO_LOOP_THREAD,
+*   queues the same commands on every peer for each step and calls StepPhysics(), then compares GetPhysicsHash()
+*   (also published in PhysicsState hash) between peers to detect desyncs. Body handles are hashed too, so
+*   InitPhysics() starts them over: handles kept from before ClosePhysics() may refer to new bodies.
+*
+*   PHYSICS THREAD:
+*
+*   Unless PHYSAC_NO_LOOP_THREAD or PHYSAC_NO_THREADS are defined, InitPhysics() creates a thread that steps
+*   physics every SetPhysicsTimeStep() milliseconds and sleeps between steps. Bodies belong to that thread,
+*   so other threads must not use PhysicsBody pointers nor functions taking them while it runs:
+*     - Commands (create, destroy, add force, add torque, rotate, gravity, sleeping) are queued with QueuePhysics*()
+*       functions from any thread, lock free, and are done before next step. Bodies are referred by PhysicsHandle,
+*       returned when queueing its creation, so commands can refer to bodies not created yet.
+*     - After every step, bodies state is published into a triple buffer. AcquirePhysicsState() returns the
+*       last published state without locks, holding last two steps positions and rotations of every body, so
+*       drawing can interpolate them with GetPhysicsStateAlpha(). Only one thread must acquire states.
+*   While no body is awake and no command is queued, it sleeps PHYSAC_IDLE_WAIT milliseconds at once and then does the
+*   skipped steps in a row, so an idle physics thread barely uses CPU (commands queued meanwhile wait up to that long).
+*   Physics settings (threads, broadphase...) must be set before InitPhysics(). SetPhysicsGravity() and
+*   SetPhysicsSleeping() wake bodies up, so called from other threads they queue QueuePhysicsGravity() and
+*   QueuePhysicsSleeping() commands instead (check those return values to know if the queue was full).
+*   Spatial queries, GetPhysicsBodyHandle() and GetPhysicsBodyByHandle() use bodies too, so while the physics thread
+*   runs they refuse to run on other threads (queries return -1, handle functions PHYSAC_NO_HANDLE or NULL). Other
+*   threads query the state from AcquirePhysicsState() with PhysicsState*() queries instead, or define
+*   PHYSAC_NO_LOOP_THREAD to query bodies from the stepping thread.
+*   With PHYSAC_NO_LOOP_THREAD, RunPhysicsStep() also runs queued commands and publishes states.
 *
 *   NOTE 1: Physac requires multi-threading, when InitPhysics() a second thread is created to manage physics calculations.
 *   NOTE 2: Physac requires static C library linkage to avoid dependency on MinGW DLL (-static -lpthread)
@@ -98,15 +219,32 @@
 //----------------------------------------------------------------------------------
 // Defines and Macros
 //----------------------------------------------------------------------------------
-#define     PHYSAC_MAX_BODIES               64
-#define     PHYSAC_MAX_MANIFOLDS            4096
+#if !defined(PHYSAC_MAX_MANIFOLDS)
+    #define PHYSAC_MAX_MANIFOLDS            65536
+#endif
 #define     PHYSAC_MAX_VERTICES             24
 #define     PHYSAC_CIRCLE_VERTICES          24
 
-#define     PHYSAC_COLLISION_ITERATIONS     100
+#if !defined(PHYSAC_COLLISION_ITERATIONS)
+    #define PHYSAC_COLLISION_ITERATIONS     10
+#endif
 #define     PHYSAC_PENETRATION_ALLOWANCE    0.05f
 #define     PHYSAC_PENETRATION_CORRECTION   0.4f
 
+#define     PHYSAC_GRID_MAX_CELLS           64      // Bodies covering more grid cells are tested against all bodies instead
+#define     PHYSAC_BODIES_CHUNK             256     // Physics bodies allocated at once when more bodies are needed
+#define     PHYSAC_MAX_THREADS              64      // Max threads solving physics islands
+#define     PHYSAC_SLEEP_VELOCITY           0.005f  // Max velocity of resting bodies besides the one gravity adds in a step (pixels per millisecond)
+#define     PHYSAC_SLEEP_ANGULAR_VELOCITY   0.0002f // Max angular velocity of resting bodies (radians per millisecond)
+#define     PHYSAC_SLEEP_TIME               500.0f  // Time islands bodies must be resting to fall asleep (milliseconds)
+#define     PHYSAC_MAX_STEPS_DELAY          250.0   // Physics thread drops time when it is more behind (milliseconds)
+#define     PHYSAC_IDLE_WAIT                10.0    // Physics thread sleep while no body is awake nor commands are queued (milliseconds)
+#define     PHYSAC_CCD_ITERATIONS           16      // Bisection iterations finding polygon bullets time of impact
+
+#if !defined(PHYSAC_MAX_COMMANDS)
+    #define PHYSAC_MAX_COMMANDS             4096    // Commands queued by other threads until next physics step (power of 2)
+#endif
+
 #define     PHYSAC_PI                       3.14159265358979323846
 #define     PHYSAC_DEG2RAD                  (PHYSAC_PI/180.0f)
 
@@ -133,6 +271,10 @@
 
 typedef enum PhysicsShapeType { PHYSICS_CIRCLE, PHYSICS_POLYGON } PhysicsShapeType;
 
+typedef enum PhysicsBroadphaseType { PHYSICS_BROADPHASE_NONE, PHYSICS_BROADPHASE_GRID, PHYSICS_BROADPHASE_SAP } PhysicsBroadphaseType;
+
+typedef enum PhysicsSimdType { PHYSICS_SIMD_NONE, PHYSICS_SIMD_SSE2, PHYSICS_SIMD_AVX2 } PhysicsSimdType;
+
 // Previously defined to be used in PhysicsShape struct as circular dependencies
 typedef struct PhysicsBodyData *PhysicsBody;
 
@@ -177,17 +319,72 @@ typedef struct PhysicsBodyData {
     bool useGravity;                            // Apply gravity force to dynamics
     bool isGrounded;                            // Physics grounded on other body state
     bool freezeOrient;                          // Physics rotation constraint
+    bool isBullet;                              // Continuous collision detection state (fast body doesn't tunnel through others)
+    bool isAwake;                               // Physics body is simulated (sleeping bodies are skipped until woken up)
+    float sleepTime;                            // Time physics body velocity has been below sleep thresholds, in milliseconds
     PhysicsShape shape;                         // Physics body shape information (type, radius, vertices, normals)
 } PhysicsBodyData;
 
+typedef struct PhysicsHit {
+    PhysicsBody body;                           // Physics body hit
+    Vector2 point;                              // Point of body shape hit
+    Vector2 normal;                             // Body shape normal at hit point
+    float distance;                             // Distance travelled by ray or circle until hit
+} PhysicsHit;
+
+// Physics body reference to use from other threads than physics one, 0 is no body
+typedef unsigned int PhysicsHandle;
+
+// Physics body state published after a physics step
+typedef struct PhysicsBodyState {
+    PhysicsHandle handle;                       // Physics body handle
+    PhysicsShapeType type;                      // Physics shape type (circle or polygon)
+    bool enabled;                               // Enabled dynamics state (collisions are calculated anyway)
+    Vector2 previousPosition;                   // Physical body position in previous step
+    Vector2 position;                           // Physical body position
+    float previousOrient;                       // Physical body rotation in previous step (radians)
+    float orient;                               // Physical body rotation (radians)
+    float radius;                               // Circle shape radius (used for circle shapes)
+    unsigned int verticesStart;                 // First polygon vertex in state vertices array (used for polygon shapes)
+    unsigned int verticesCount;                 // Polygon vertices count (used for polygon shapes)
+} PhysicsBodyState;
+
+// Physics bodies states published after a physics step (see AcquirePhysicsState())
+typedef struct PhysicsState {
+    unsigned int stepsCount;                    // Physics steps done when state was published
+    unsigned int hash;                          // Bodies state hash after the step (0 unless PHYSAC_DETERMINISTIC, see GetPhysicsHash())
+    double time;                                // Time the step was due (milliseconds, physics timer)
+    int bodiesCount;                            // Physics bodies in state
+    PhysicsBodyState *bodies;                   // Physics bodies states, in bodies pointers array order
+    Vector2 *vertices;                          // Polygon shapes vertices (model space)
+    unsigned int *handles;                      // Bodies states indices by handle (hash table, internal)
+    unsigned int handlesSize;                   // Handles hash table slots (internal)
+    unsigned int bodiesCapacity;                // Bodies states that fit before growing (internal)
+    unsigned int verticesCapacity;              // Vertices that fit before growing (internal)
+} PhysicsState;
+
+// Physics body hit by a cast against a published physics state
+typedef struct PhysicsStateHit {
+    int index;                                  // Physics body index in state
+    Vector2 point;                              // Point of body shape hit
+    Vector2 normal;                             // Body shape normal at hit point
+    float distance;                             // Distance travelled by ray or circle until hit
+} PhysicsStateHit;
+
 typedef struct PhysicsManifoldData {
     unsigned int id;                            // Reference unique identifier
     PhysicsBody bodyA;                          // Manifold first physics body reference
     PhysicsBody bodyB;                          // Manifold second physics body reference
+    unsigned int indexA;                        // Manifold first physics body index in bodies array
+    unsigned int indexB;                        // Manifold second physics body index in bodies array
     float penetration;                          // Depth of penetration from collision
     Vector2 normal;                             // Normal direction vector from 'a' to 'b'
     Vector2 contacts[2];                        // Points of contact during collision
     unsigned int contactsCount;                 // Current collision number of contacts
+    unsigned int features[2];                   // Shapes faces and vertices that made each contact point (used to match them between steps)
+    float normalImpulses[2];                    // Impulses accumulated along normal by each contact point
+    float tangentImpulses[2];                   // Impulses accumulated along tangent by each contact point (friction)
+    float velocityBias[2];                      // Normal velocity each contact point must reach when solved (restitution)
     float restitution;                          // Mixed restitution during collision
     float dynamicFriction;                      // Mixed dynamic friction during collision
     float staticFriction;                       // Mixed static friction during collision
@@ -202,15 +399,58 @@ extern "C" {                                    // Prevents name mangling of fun
 //----------------------------------------------------------------------------------
 PHYSACDEF void InitPhysics(void);                                                                           // Initializes physics values, pointers and creates physics loop thread
 PHYSACDEF void RunPhysicsStep(void);                                                                        // Run physics step, to be used if PHYSICS_NO_THREADS is set in your main loop
+PHYSACDEF void StepPhysics(void);                                                                           // Runs queued commands and exactly one physics step, to be used by lockstep games instead of RunPhysicsStep()
+PHYSACDEF unsigned int GetPhysicsHash(void);                                                                // Returns a hash of bodies state after last step, to check lockstep peers simulate the same
 PHYSACDEF void SetPhysicsTimeStep(double delta);                                                            // Sets physics fixed time step in milliseconds. 1.666666 by default
 PHYSACDEF bool IsPhysicsEnabled(void);                                                                      // Returns true if physics thread is currently enabled
-PHYSACDEF void SetPhysicsGravity(float x, float y);                                                         // Sets physics global gravity force
+PHYSACDEF void SetPhysicsGravity(float x, float y);                                                         // Sets physics global gravity force (queued off physics thread)
+PHYSACDEF void SetPhysicsBroadphase(PhysicsBroadphaseType type);                                            // Sets how pairs of bodies to test for collision are found (PHYSICS_BROADPHASE_GRID by default)
+PHYSACDEF void SetPhysicsGridCellSize(float size);                                                          // Sets broadphase grid cell size, 0 chooses it from average bodies size (default)
+PHYSACDEF int GetPhysicsBroadphasePairsCount(void);                                                         // Returns the amount of bodies pairs tested for collision in last step
+PHYSACDEF void SetPhysicsSimd(PhysicsSimdType type);                                                        // Sets SIMD instructions used by physics kernels (limited to the ones CPU supports)
+PHYSACDEF PhysicsSimdType GetPhysicsSimd(void);                                                             // Returns SIMD instructions used by physics kernels
+PHYSACDEF void SetPhysicsThreads(int count);                                                                // Sets threads solving physics islands, including the one running physics step (1 by default)
+PHYSACDEF int GetPhysicsThreads(void);                                                                      // Returns threads solving physics islands
+PHYSACDEF int GetPhysicsIslandsCount(void);                                                                 // Returns the amount of islands solved in last step
+PHYSACDEF void SetPhysicsSleeping(bool enabled);                                                            // Sets resting islands falling asleep state, enabled by default (queued off physics thread)
+PHYSACDEF int GetPhysicsAwakeBodiesCount(void);                                                             // Returns the amount of enabled bodies simulated in last step
+PHYSACDEF int GetPhysicsSleepingBodiesCount(void);                                                          // Returns the amount of sleeping physics bodies
+PHYSACDEF void SetPhysicsCollisionIterations(int iterations);                                               // Sets collision solver iterations done every step (PHYSAC_COLLISION_ITERATIONS by default)
+PHYSACDEF int GetPhysicsCollisionIterations(void);                                                          // Returns collision solver iterations done every step
+PHYSACDEF void SetPhysicsWarmStarting(bool enabled);                                                        // Sets contact points starting from previous step impulses state (enabled by default)
+PHYSACDEF int PhysicsRaycast(Vector2 origin, Vector2 direction, float maxDistance, PhysicsHit *hits, int maxHits);   // Casts a ray and fills nearest hits sorted by distance, returns hits count (-1 off physics thread)
+PHYSACDEF int PhysicsCircleCast(Vector2 origin, float radius, Vector2 direction, float maxDistance, PhysicsHit *hits, int maxHits);  // Casts a circle and fills nearest hits sorted by distance, returns hits count (-1 off physics thread)
+PHYSACDEF int PhysicsQueryAABB(Vector2 boxMin, Vector2 boxMax, PhysicsBody *results, int maxResults);         // Fills bodies which bounding box overlaps a box, returns bodies count (-1 off physics thread)
+PHYSACDEF int PhysicsQueryPoint(Vector2 point, PhysicsBody *results, int maxResults);                       // Fills bodies which shape contains a point, returns bodies count (-1 off physics thread)
+PHYSACDEF PhysicsHandle QueuePhysicsBodyCircle(Vector2 pos, float radius, float density);                 // Queues creation of a circle physics body, returns its handle (0 if queue is full)
+PHYSACDEF PhysicsHandle QueuePhysicsBodyRectangle(Vector2 pos, float width, float height, float density); // Queues creation of a rectangle physics body, returns its handle (0 if queue is full)
+PHYSACDEF PhysicsHandle QueuePhysicsBodyPolygon(Vector2 pos, float radius, int sides, float density);     // Queues creation of a polygon physics body, returns its handle (0 if queue is full)
+PHYSACDEF bool QueuePhysicsAddForce(PhysicsHandle handle, Vector2 force);                                   // Queues adding a force to a physics body, returns false if queue is full
+PHYSACDEF bool QueuePhysicsAddTorque(PhysicsHandle handle, float amount);                                   // Queues adding an angular force to a physics body, returns false if queue is full
+PHYSACDEF bool QueuePhysicsBodyRotation(PhysicsHandle handle, float radians);                               // Queues setting a physics body rotation, returns false if queue is full
+PHYSACDEF bool QueuePhysicsBodyBullet(PhysicsHandle handle, bool enabled);                                  // Queues setting a physics body continuous collision detection, returns false if queue is full
+PHYSACDEF bool QueueDestroyPhysicsBody(PhysicsHandle handle);                                               // Queues destroying a physics body, returns false if queue is full
+PHYSACDEF bool QueuePhysicsGravity(float x, float y);                                                       // Queues setting physics global gravity force, returns false if queue is full
+PHYSACDEF bool QueuePhysicsSleeping(bool enabled);                                                          // Queues setting resting islands falling asleep state, returns false if queue is full
+PHYSACDEF const PhysicsState *AcquirePhysicsState(void);                                                    // Returns last published physics state (valid until next call), NULL if none yet
+PHYSACDEF float GetPhysicsStateAlpha(const PhysicsState *state);                                            // Returns how far current time is between state previous and last step (0 - 1)
+PHYSACDEF int FindPhysicsBodyState(const PhysicsState *state, PhysicsHandle handle);                        // Returns index of a physics body in state, -1 if not found
+PHYSACDEF Vector2 GetPhysicsStatePosition(const PhysicsState *state, int index, float alpha);               // Returns physics body position interpolated between previous and last step
+PHYSACDEF float GetPhysicsStateOrient(const PhysicsState *state, int index, float alpha);                   // Returns physics body rotation interpolated between previous and last step
+PHYSACDEF Vector2 GetPhysicsStateVertex(const PhysicsState *state, int index, int vertex, float alpha);     // Returns physics body shape vertex interpolated between previous and last step
+PHYSACDEF int PhysicsStateRaycast(const PhysicsState *state, Vector2 origin, Vector2 direction, float maxDistance, PhysicsStateHit *hits, int maxHits);  // Casts a ray against bodies in state last step, returns hits count
+PHYSACDEF int PhysicsStateCircleCast(const PhysicsState *state, Vector2 origin, float radius, Vector2 direction, float maxDistance, PhysicsStateHit *hits, int maxHits);  // Casts a circle against bodies in state last step, returns hits count
+PHYSACDEF int PhysicsStateQueryAABB(const PhysicsState *state, Vector2 boxMin, Vector2 boxMax, int *results, int maxResults);  // Fills state indices of bodies which bounding box overlaps a box, returns bodies count
+PHYSACDEF int PhysicsStateQueryPoint(const PhysicsState *state, Vector2 point, int *results, int maxResults);  // Fills state indices of bodies which shape contains a point, returns bodies count
+PHYSACDEF PhysicsHandle GetPhysicsBodyHandle(PhysicsBody body);                                             // Returns the handle of a physics body (PHYSAC_NO_HANDLE off physics thread)
+PHYSACDEF PhysicsBody GetPhysicsBodyByHandle(PhysicsHandle handle);                                         // Returns the physics body of a handle, NULL if destroyed, not created yet or off physics thread
 PHYSACDEF PhysicsBody CreatePhysicsBodyCircle(Vector2 pos, float radius, float density);                    // Creates a new circle physics body with generic parameters
 PHYSACDEF PhysicsBody CreatePhysicsBodyRectangle(Vector2 pos, float width, float height, float density);    // Creates a new rectangle physics body with generic parameters
 PHYSACDEF PhysicsBody CreatePhysicsBodyPolygon(Vector2 pos, float radius, int sides, float density);        // Creates a new polygon physics body with generic parameters
 PHYSACDEF void PhysicsAddForce(PhysicsBody body, Vector2 force);                                            // Adds a force to a physics body
 PHYSACDEF void PhysicsAddTorque(PhysicsBody body, float amount);                                            // Adds an angular force to a physics body
 PHYSACDEF void PhysicsShatter(PhysicsBody body, Vector2 position, float force);                             // Shatters a polygon shape physics body to little physics bodies with explosion force
+PHYSACDEF void PhysicsWakeBody(PhysicsBody body);                                                           // Wakes up a sleeping physics body and the bodies that fell asleep with it
 PHYSACDEF int GetPhysicsBodiesCount(void);                                                                  // Returns the current amount of created physics bodies
 PHYSACDEF PhysicsBody GetPhysicsBody(int index);                                                            // Returns a physics body of the bodies pool at a specific index
 PHYSACDEF int GetPhysicsShapeType(int index);                                                               // Returns the physics body shape type (PHYSICS_CIRCLE or PHYSICS_POLYGON)
@@ -234,14 +474,103 @@ PHYSACDEF void ClosePhysics(void);
 
 #if defined(PHYSAC_IMPLEMENTATION)
 
+// Must be defined before any system header is included, they only check it the first time
+// NOTE: If system headers were included before this file, compile with -D_POSIX_C_SOURCE=199309L or gnu99 instead
+#if defined(__linux__)
+    #if !defined(_POSIX_C_SOURCE) || (_POSIX_C_SOURCE < 199309L)
+        #undef _POSIX_C_SOURCE
+        #define _POSIX_C_SOURCE 199309L // Required for CLOCK_MONOTONIC and nanosleep() if compiled with c99 without gnu ext.
+    #endif
+#endif
+
 #if !defined(PHYSAC_NO_THREADS)
-    #include <pthread.h>            // Required for: pthread_t, pthread_create()
+    #include <pthread.h>            // Required for: pthread_t, pthread_create(), pthread_mutex_t, pthread_cond_t
+
+    #if defined(_MSC_VER)
+        #include <intrin.h>         // Required for: _InterlockedExchangeAdd()
+        #define PHYSAC_ATOMIC_FETCH_ADD(ptr, value)     _InterlockedExchangeAdd((volatile long *)(ptr), (long)(value))
+    #else
+        #define PHYSAC_ATOMIC_FETCH_ADD(ptr, value)     __atomic_fetch_add((ptr), (value), __ATOMIC_RELAXED)
+    #endif
+#else
+    #define PHYSAC_ATOMIC_FETCH_ADD(ptr, value)         ((*(ptr) += (value)) - (value))
+#endif
+
+// Commands queue and published states are shared between threads even without pthread library
+#if defined(_MSC_VER)
+    #include <intrin.h>             // Required for: _InterlockedExchange(), _InterlockedCompareExchange(), _InterlockedIncrement()
+    #define PHYSAC_ATOMIC_LOAD(ptr)                             (*(volatile long *)(ptr))
+    #define PHYSAC_ATOMIC_STORE(ptr, value)                     _InterlockedExchange((volatile long *)(ptr), (long)(value))
+    #define PHYSAC_ATOMIC_EXCHANGE(ptr, value)                  _InterlockedExchange((volatile long *)(ptr), (long)(value))
+    #define PHYSAC_ATOMIC_COMPARE_EXCHANGE(ptr, expected, value) (_InterlockedCompareExchange((volatile long *)(ptr), (long)(value), (long)(expected)) == (long)(expected))
+    #define PHYSAC_ATOMIC_INCREMENT(ptr)                        _InterlockedIncrement((volatile long *)(ptr))
+#else
+    #define PHYSAC_ATOMIC_LOAD(ptr)                             __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+    #define PHYSAC_ATOMIC_STORE(ptr, value)                     __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+    #define PHYSAC_ATOMIC_EXCHANGE(ptr, value)                  __atomic_exchange_n((ptr), (value), __ATOMIC_ACQ_REL)
+    #define PHYSAC_ATOMIC_COMPARE_EXCHANGE(ptr, expected, value) __sync_bool_compare_and_swap((ptr), (expected), (value))
+    #define PHYSAC_ATOMIC_INCREMENT(ptr)                        __atomic_add_fetch((ptr), 1, __ATOMIC_RELAXED)
 #endif
 
 #if defined(PHYSAC_DEBUG)
     #include <stdio.h>              // Required for: printf()
 #endif
 
+#include <stdlib.h>                 // Required for: malloc(), free(), srand()
+#include <math.h>                   // Required for: floorf()
+#include <string.h>                 // Required for: memcpy(), memset()
+#include <stdint.h>                 // Required for: uint64_t, uintptr_t
+
+// Deterministic steps don't use SIMD kernels nor fused multiply-add, and need floats without extra precision
+#if defined(PHYSAC_DETERMINISTIC)
+    #include <float.h>              // Required for: FLT_EVAL_METHOD
+
+    #if !defined(PHYSAC_NO_SIMD)
+        #define PHYSAC_NO_SIMD
+    #endif
+
+    #if defined(__FAST_MATH__)
+        #error "PHYSAC_DETERMINISTIC can't be used with -ffast-math"
+    #endif
+
+    // NOTE: FLT_EVAL_METHOD 16 means only half floats are computed as themselves (AVX512-FP16), floats still are
+    #if defined(FLT_EVAL_METHOD) && ((FLT_EVAL_METHOD == 1) || (FLT_EVAL_METHOD == 2) || (FLT_EVAL_METHOD < 0))
+        #error "PHYSAC_DETERMINISTIC requires floats computed without extra precision (use SSE2 instead of x87 FPU)"
+    #endif
+#endif
+
+// SIMD kernels are only available on x86 CPUs, AVX2 ones are compiled for that target and selected at runtime
+#if !defined(PHYSAC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+    #define PHYSAC_SIMD_SSE2
+    #include <emmintrin.h>          // Required for: SSE2 intrinsics
+
+    #if defined(__GNUC__) || defined(__clang__)
+        #define PHYSAC_SIMD_AVX2
+        #define PHYSAC_TARGET_AVX2  __attribute__((target("avx2")))
+        #include <immintrin.h>      // Required for: AVX2 intrinsics
+        #include <cpuid.h>          // Required for: __get_cpuid(), __cpuid_count()
+    #elif defined(_MSC_VER)
+        #define PHYSAC_SIMD_AVX2
+        #define PHYSAC_TARGET_AVX2
+        #include <immintrin.h>      // Required for: AVX2 intrinsics, _xgetbv()
+        #include <intrin.h>         // Required for: __cpuid(), __cpuidex()
+    #endif
+#endif
+
+// Multiplications and additions are not fused inside implementation by deterministic steps, nor when SIMD kernels are
+// compiled: scalar code rounds them once if fused (FMA) while SIMD kernels round them twice, so results would differ
+#if defined(PHYSAC_DETERMINISTIC) || defined(PHYSAC_SIMD_SSE2)
+    #define PHYSAC_NO_FP_CONTRACT
+
+    #if defined(__clang__)
+        #pragma STDC FP_CONTRACT OFF
+    #elif defined(__GNUC__)
+        #pragma GCC push_options
+        #pragma GCC optimize ("fp-contract=off")
+    #elif defined(_MSC_VER)
+        #pragma fp_contract (off)
+    #endif
+#endif
 
 
 #if !defined(PHYSAC_STANDALONE)
@@ -257,14 +586,11 @@ PHYSACDEF void ClosePhysics(void);
     #endif
     int __stdcall QueryPerformanceCounter(unsigned long long int* lpPerformanceCount);
     int __stdcall QueryPerformanceFrequency(unsigned long long int* lpFrequency);
+    void __stdcall Sleep(unsigned long msTimeout);
     #if defined(__cplusplus)
     }
     #endif
 #elif defined(__linux__)
-    #if _POSIX_C_SOURCE < 199309L
-        #undef _POSIX_C_SOURCE
-        #define _POSIX_C_SOURCE 199309L // Required for CLOCK_MONOTONIC if compiled with c99 without gnu ext.
-    #endif
     #include <sys/time.h>           // Required for: timespec
 #elif defined(__APPLE__)            // macOS also defines __MACH__
     #include <mach/mach_time.h>     // Required for: mach_absolute_time()
@@ -279,15 +605,75 @@ PHYSACDEF void ClosePhysics(void);
 #define     PHYSAC_EPSILON              0.000001f
 #define     PHYSAC_K                    1.0f/3.0f
 #define     PHYSAC_VECTOR_ZERO          (Vector2){ 0.0f, 0.0f }
+#define     PHYSAC_NO_ISLAND            0xFFFFFFFF
+#define     PHYSAC_NO_MANIFOLD          0xFFFFFFFF
+#define     PHYSAC_NO_BODY              0xFFFFFFFF
+#define     PHYSAC_NO_HANDLE            0
+#define     PHYSAC_STATE_FRESH          0x4
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+// Physics bodies hot data, contiguous arrays indexed like bodies pointers array
+// NOTE: Flags are stored as 0.0f or 1.0f so integration loops have no branches, sleeping bodies are stored as disabled
+typedef struct PhysicsBodiesData {
+    float *positionX;                           // Physics bodies positions x
+    float *positionY;                           // Physics bodies positions y
+    float *velocityX;                           // Physics bodies linear velocities x
+    float *velocityY;                           // Physics bodies linear velocities y
+    float *forceX;                              // Physics bodies linear forces x
+    float *forceY;                              // Physics bodies linear forces y
+    float *angularVelocity;                     // Physics bodies angular velocities
+    float *torque;                              // Physics bodies angular forces
+    float *orient;                              // Physics bodies rotations in radians
+    float *inverseMass;                         // Physics bodies inverse mass
+    float *inverseInertia;                      // Physics bodies inverse inertia
+    float *enabled;                             // Physics bodies enabled dynamics state
+    float *dynamic;                             // Physics bodies enabled and not static state (forces are applied)
+    float *useGravity;                          // Physics bodies gravity state
+    float *rotation;                            // Physics bodies rotation enabled state (not freezeOrient)
+} PhysicsBodiesData;
+
+// Physics island, manifolds that share dynamic bodies (stored in islandManifolds array)
+typedef struct PhysicsIsland {
+    unsigned int start;                         // First manifold of the island in islandManifolds array
+    unsigned int count;                         // Manifolds in the island
+} PhysicsIsland;
+
+// Work done on every island by solver threads
+typedef enum PhysicsIslandsJob { PHYSICS_JOB_IMPULSES, PHYSICS_JOB_CORRECTION } PhysicsIslandsJob;
+
+// Commands queued by other threads
+typedef enum PhysicsCommandType {
+    PHYSICS_COMMAND_CIRCLE,
+    PHYSICS_COMMAND_RECTANGLE,
+    PHYSICS_COMMAND_POLYGON,
+    PHYSICS_COMMAND_FORCE,
+    PHYSICS_COMMAND_TORQUE,
+    PHYSICS_COMMAND_ROTATION,
+    PHYSICS_COMMAND_BULLET,
+    PHYSICS_COMMAND_DESTROY,
+    PHYSICS_COMMAND_GRAVITY,
+    PHYSICS_COMMAND_SLEEPING
+} PhysicsCommandType;
+
+// Command queued by other threads, done by physics thread before next step
+typedef struct PhysicsCommand {
+    unsigned int sequence;                      // Queue position the slot can be written at, or position + 1 once written
+    PhysicsCommandType type;                    // Command type
+    PhysicsHandle handle;                       // Physics body handle (created body handle for creation commands)
+    Vector2 vector;                             // Position of created body, force or gravity
+    float values[3];                            // Created body sizes and density, torque, rotation or enabled state
+} PhysicsCommand;
 
 //----------------------------------------------------------------------------------
 // Global Variables Definition
 //----------------------------------------------------------------------------------
-#if !defined(PHYSAC_NO_THREADS)
+#if !defined(PHYSAC_NO_THREADS) && !defined(PHYSAC_NO_LOOP_THREAD)
 static pthread_t physicsThreadId;                           // Physics thread id
 #endif
 static unsigned int usedMemory = 0;                         // Total allocated dynamic memory
-static bool physicsThreadEnabled = false;                   // Physics thread enabled state
+static unsigned int physicsThreadEnabled = false;           // Physics thread enabled state (changed by other threads while physics thread runs)
 static double baseTime = 0.0;                               // Offset time for MONOTONIC clock
 static double startTime = 0.0;                              // Start time in milliseconds
 static double deltaTime = 1.0/60.0/10.0 * 1000;             // Delta time used for physics steps, in milliseconds
@@ -297,41 +683,206 @@ static uint64_t frequency = 0;                              // Hi-res clock freq
 static double accumulator = 0.0;                            // Physics time step delta time accumulator
 static unsigned int stepsCount = 0;                         // Total physics steps processed
 static Vector2 gravityForce = { 0.0f, 9.81f };              // Physics world gravity force
-static PhysicsBody bodies[PHYSAC_MAX_BODIES];               // Physics bodies pointers array
+static PhysicsBody *bodies = NULL;                          // Physics bodies pointers array
 static unsigned int physicsBodiesCount = 0;                 // Physics world current bodies counter
-static PhysicsManifold contacts[PHYSAC_MAX_MANIFOLDS];      // Physics bodies pointers array
+static unsigned int physicsBodiesCapacity = 0;              // Physics bodies that fit in bodies arrays before growing
+static PhysicsBodiesData bodiesData = { 0 };                // Physics bodies hot data (filled every step)
+static PhysicsBodyData **bodiesChunks = NULL;               // Physics bodies memory chunks (never moved, so bodies pointers stay valid)
+static unsigned int bodiesChunksCount = 0;                  // Physics bodies memory chunks count
+static unsigned int bodiesChunksCapacity = 0;               // Physics bodies memory chunks that fit in chunks array before growing
+static unsigned int bodiesIdsCount = 0;                     // Physics bodies ids used so far (ids are chunks slots)
+static unsigned int *bodiesIndex = NULL;                    // Physics bodies index in bodies pointers array by id
+static unsigned int *bodiesFreeIds = NULL;                  // Physics bodies ids of destroyed bodies, used again first
+static unsigned int bodiesFreeIdsCount = 0;                 // Physics bodies ids available to be used again
+static PhysicsManifoldData *contacts = NULL;                // Physics manifolds pool (contiguous, reset every step)
 static unsigned int physicsManifoldsCount = 0;              // Physics world current manifolds counter
+static unsigned int physicsManifoldsCapacity = 0;           // Physics manifolds that fit in pool before growing
+static PhysicsManifoldData *previousContacts = NULL;        // Physics manifolds of previous step (swapped with manifolds pool every step)
+static unsigned int previousManifoldsCount = 0;             // Physics manifolds of previous step
+static unsigned int previousManifoldsCapacity = 0;          // Physics manifolds that fit in previous step pool before growing
+static unsigned int *contactsCache = NULL;                  // Previous step manifolds indices by bodies ids pair (hash table, PHYSAC_NO_MANIFOLD if empty)
+static unsigned int contactsCacheSize = 0;                  // Previous step manifolds hash table slots (power of 2)
+static int collisionIterations = PHYSAC_COLLISION_ITERATIONS;   // Collision solver iterations done every step
+static bool warmStarting = true;                            // Contact points start from previous step impulses
+
+static PhysicsBroadphaseType broadphaseType = PHYSICS_BROADPHASE_GRID;  // Broadphase used to find pairs of bodies to test for collision
+static float gridCellSize = 0.0f;                           // Broadphase grid cell size (0 to choose from average bodies size)
+static Vector2 *boundsMin = NULL;                           // Physics bodies bounding boxes minimum positions
+static Vector2 *boundsMax = NULL;                           // Physics bodies bounding boxes maximum positions
+static unsigned int *broadphasePairs = NULL;                // Pairs of bodies indices to test for collision (two per pair)
+static unsigned int broadphasePairsCount = 0;               // Current pairs of bodies to test for collision
+static unsigned int broadphasePairsCapacity = 0;            // Pairs that fit in pairs array before growing
+static unsigned int *gridEntries = NULL;                    // Grid cells covered by bodies (body index, cell x, cell y, hash)
+static unsigned int gridEntriesCapacity = 0;                // Grid entries that fit in entries array before growing
+static unsigned int *gridSorted = NULL;                     // Grid entries sorted by hash bucket
+static unsigned int gridSortedCapacity = 0;                 // Grid entries that fit in sorted array before growing
+static unsigned int *gridBuckets = NULL;                    // First sorted grid entry of each hash bucket
+static unsigned int gridBucketsCapacity = 0;                // Hash buckets that fit in buckets array before growing
+static bool *gridLarge = NULL;                              // Physics bodies covering too many grid cells (tested against all bodies)
+static unsigned int *gridLargeBodies = NULL;                // Physics bodies indices covering too many grid cells
+static int gridLargeBodiesCount = 0;                        // Physics bodies covering too many grid cells
+static unsigned int gridBucketsCount = 0;                   // Hash buckets of last built grid (power of 2)
+static float gridCellSizeUsed = 1.0f;                       // Cell size of last built grid
+static Vector2 gridBoundsMin = { 0.0f, 0.0f };              // Bounding box of all bodies when grid was built (minimum)
+static Vector2 gridBoundsMax = { 0.0f, 0.0f };              // Bounding box of all bodies when grid was built (maximum)
+static bool queryGridValid = false;                         // Grid and bounds match bodies current position (queries build them again otherwise)
+static unsigned int *queryStamps = NULL;                    // Last query that tested each physics body, so bodies covering several cells are tested once
+static unsigned int queryStamp = 0;                         // Current query number
+static unsigned int *bullets = NULL;                        // Awake bullet physics bodies indices in current step
+static Vector2 *bulletsStart = NULL;                        // Bullet physics bodies positions at current step start
+static unsigned int bulletsCount = 0;                       // Awake bullet physics bodies in current step
+static unsigned int bulletsCapacity = 0;                    // Bullet physics bodies that fit in bullets arrays before growing
+static unsigned int bulletsStartCapacity = 0;               // Bullet physics bodies that fit in start positions array before growing
+static unsigned int *sapOrder = NULL;                       // Physics bodies indices sorted by bounding box minimum x (kept between steps)
+static unsigned int sapCount = 0;                           // Physics bodies sorted in previous step
+
+static PhysicsSimdType physicsSimd = PHYSICS_SIMD_NONE;     // SIMD instructions used by physics kernels
+static PhysicsSimdType physicsSimdSupported = PHYSICS_SIMD_NONE;    // Best SIMD instructions supported by CPU
+
+static unsigned int *islandParent = NULL;                   // Physics bodies union-find parents (bodies with the same root share island)
+static unsigned int *islandIds = NULL;                      // Island of each union-find root body (PHYSAC_NO_ISLAND if none yet)
+static PhysicsIsland *islands = NULL;                       // Physics islands found in current step
+static unsigned int islandsCount = 0;                       // Physics islands found in current step
+static unsigned int islandsCapacity = 0;                    // Physics islands that fit in islands array before growing
+static unsigned int *islandManifolds = NULL;                // Manifolds indices grouped by island, in manifolds order inside each island
+static unsigned int islandManifoldsCapacity = 0;            // Manifolds indices that fit in island manifolds array before growing
+static PhysicsIslandsJob islandsJob = PHYSICS_JOB_IMPULSES; // Work being done on islands
+static volatile unsigned int islandsNext = 0;               // Next island to be taken by a solver thread
+
+static bool sleepingEnabled = true;                         // Resting islands fall asleep
+static PhysicsCommand *physicsCommands = NULL;              // Commands queued by other threads (ring of PHYSAC_MAX_COMMANDS slots)
+static unsigned int commandsHead = 0;                       // Next queue position physics thread reads from
+static unsigned int commandsTail = 0;                       // Next queue position other threads write at
+static PhysicsHandle physicsHandlesNext = 0;                // Last physics body handle given
+static PhysicsHandle queuedHandle = PHYSAC_NO_HANDLE;       // Handle given to body created by current command
+static PhysicsHandle *bodiesHandles = NULL;                 // Physics bodies handles by id, PHYSAC_NO_HANDLE if destroyed
+static unsigned int *handlesTable = NULL;                   // Physics bodies ids by handle (hash table, has entries of destroyed bodies)
+static unsigned int handlesTableSize = 0;                   // Handles hash table slots (power of 2)
+static unsigned int handlesTableCount = 0;                  // Handles hash table used slots
+static PhysicsBodyState *lastStates = NULL;                 // Physics bodies state in last published state by id
+static PhysicsState physicsStates[3] = { 0 };               // Triple buffer of published states
+static unsigned int statesBack = 0;                         // State physics thread writes next
+static unsigned int statesMiddle = 1;                       // Last published state, with PHYSAC_STATE_FRESH if not acquired yet
+static unsigned int statesFront = 2;                        // State acquired by reader thread
+static unsigned int *sleepNext = NULL;                      // Next body (by id) that fell asleep with each body (circular list), PHYSAC_NO_ISLAND if awake
+static float *islandSleepTime = NULL;                       // Shortest resting time of the bodies of each union-find root body island
+static unsigned int *islandSleepHead = NULL;                // First body (by id) falling asleep in each union-find root body island
+static unsigned int *sleepingPairs = NULL;                  // Pairs of bodies without awake bodies, solved only if one of them wakes up
+static unsigned int sleepingPairsCount = 0;                 // Pairs of bodies without awake bodies in current step
+static unsigned int sleepingPairsCapacity = 0;              // Pairs that fit in sleeping pairs array before growing
+static unsigned int physicsSleepingCount = 0;               // Sleeping physics bodies
+static unsigned int physicsAwakeCount = 0;                  // Enabled physics bodies simulated in last step
+static bool physicsBodiesWoken = false;                     // Sleeping bodies were woken up by a contact in current step
+#if !defined(PHYSAC_NO_THREADS)
+static pthread_t physicsWorkers[PHYSAC_MAX_THREADS - 1];    // Solver worker threads ids
+static int physicsWorkersCount = 0;                         // Solver worker threads running (besides the one running physics step)
+static pthread_mutex_t physicsWorkersLock = PTHREAD_MUTEX_INITIALIZER;  // Guards solver workers job state
+static pthread_cond_t physicsWorkersWake = PTHREAD_COND_INITIALIZER;    // Signaled when a new job is started or workers must exit
+static pthread_cond_t physicsWorkersDone = PTHREAD_COND_INITIALIZER;    // Signaled when last busy worker finishes its job
+static unsigned int physicsWorkersJob = 0;                  // Jobs started so far (workers wait for it to change)
+static int physicsWorkersBusy = 0;                          // Solver workers still working on current job
+static bool physicsWorkersExit = false;                     // Solver workers must exit
+#endif
 
 //----------------------------------------------------------------------------------
 // Module Internal Functions Declaration
 //----------------------------------------------------------------------------------
-static int FindAvailableBodyIndex();                                                                        // Finds a valid index for a new physics body initialization
+static PhysicsBody AllocatePhysicsBody(void);                                                               // Allocates a physics body from bodies chunks with a free id
+static void ReservePhysicsBodies(unsigned int count);                                                       // Grows physics bodies arrays to fit count bodies
+static void GatherPhysicsBodies(void);                                                                      // Copies physics bodies hot data to contiguous arrays
+static void ScatterPhysicsBodies(void);                                                                     // Copies physics bodies hot data back to bodies and clears forces
 static PolygonData CreateRandomPolygon(float radius, int sides);                                            // Creates a random polygon shape with max vertex distance from polygon pivot
 static PolygonData CreateRectanglePolygon(Vector2 pos, Vector2 size);                                       // Creates a rectangle polygon shape based on a min and max positions
+#if !defined(PHYSAC_NO_THREADS) && !defined(PHYSAC_NO_LOOP_THREAD)
 static void *PhysicsLoop(void *arg);                                                                        // Physics loop thread function
+static void WaitPhysicsTime(double milliseconds);                                                           // Sleeps physics thread for some time
+#endif
+static bool QueuePhysicsCommand(PhysicsCommand command);                                                    // Adds a command to commands queue, returns false if queue is full
+static void RunPhysicsCommands(void);                                                                       // Does commands queued by other threads
+static PhysicsHandle NewPhysicsHandle(void);                                                                // Returns an unused physics body handle
+static void AddPhysicsHandle(unsigned int id);                                                              // Adds a physics body to handles hash table
+static void PublishPhysicsState(double time);                                                               // Copies bodies state to triple buffer and makes it the last published one
 static void PhysicsStep(void);                                                                              // Physics steps calculations (dynamics, collisions and position corrections)
-static int FindAvailableManifoldIndex();                                                                    // Finds a valid index for a new manifold initialization
-static PhysicsManifold CreatePhysicsManifold(PhysicsBody a, PhysicsBody b);                                 // Creates a new physics manifold to solve collision
-static void DestroyPhysicsManifold(PhysicsManifold manifold);                                               // Unitializes and destroys a physics manifold
+static PhysicsManifold CreatePhysicsManifold(unsigned int a, unsigned int b);                               // Creates a new physics manifold to solve collision in manifolds pool next slot
+static bool AddPhysicsContact(unsigned int a, unsigned int b);                                              // Keeps manifold of a pair of bodies if colliding, returns false if manifolds pool is full
+static void CachePhysicsContacts(void);                                                                     // Keeps last step manifolds and indexes them by bodies ids pair
+static unsigned int ContactsCacheSlot(unsigned int idA, unsigned int idB);                                  // Returns first contacts cache slot to look for a bodies ids pair
+static void ReusePhysicsImpulses(PhysicsManifold manifold);                                                 // Copies impulses accumulated in previous step by matching contact points
 static void SolvePhysicsManifold(PhysicsManifold manifold);                                                 // Solves a created physics manifold between two physics bodies
 static void SolveCircleToCircle(PhysicsManifold manifold);                                                  // Solves collision between two circle shape physics bodies
 static void SolveCircleToPolygon(PhysicsManifold manifold);                                                 // Solves collision between a circle to a polygon shape physics bodies
 static void SolvePolygonToCircle(PhysicsManifold manifold);                                                 // Solves collision between a polygon to a circle shape physics bodies
 static void SolveDifferentShapes(PhysicsManifold manifold, PhysicsBody bodyA, PhysicsBody bodyB);           // Solve collision between two different types of shapes
 static void SolvePolygonToPolygon(PhysicsManifold manifold);                                                // Solves collision between two polygons shape physics bodies
-static void IntegratePhysicsForces(PhysicsBody body);                                                       // Integrates physics forces into velocity
+static void IntegratePhysicsForces(void);                                                                   // Integrates physics forces into velocity
 static void InitializePhysicsManifolds(PhysicsManifold manifold);                                           // Initializes physics manifolds to solve collisions
 static void IntegratePhysicsImpulses(PhysicsManifold manifold);                                             // Integrates physics collisions impulses to solve collisions
-static void IntegratePhysicsVelocity(PhysicsBody body);                                                     // Integrates physics velocity into position and forces
+static void ApplyPhysicsImpulse(unsigned int a, unsigned int b, Vector2 radiusA, Vector2 radiusB, Vector2 impulse);  // Applies an impulse from body a to body b at a contact point
+static void IntegratePhysicsVelocity(void);                                                                 // Integrates physics velocity into position and forces
+static void IntegrateForcesScalar(int start, float halfStep, float gravityX, float gravityY);               // Integrates bodies forces from start index, one body at a time
+static void IntegrateVelocityScalar(int start, float step);                                                 // Integrates bodies velocity from start index, one body at a time
+#if defined(PHYSAC_SIMD_SSE2)
+static int IntegrateForcesSSE2(float halfStep, float gravityX, float gravityY);                             // Integrates bodies forces 4 at a time, returns bodies integrated
+static int IntegrateVelocitySSE2(float step);                                                               // Integrates bodies velocity 4 at a time, returns bodies integrated
+#endif
+#if defined(PHYSAC_SIMD_AVX2)
+static int IntegrateForcesAVX2(float halfStep, float gravityX, float gravityY);                             // Integrates bodies forces 8 at a time, returns bodies integrated
+static int IntegrateVelocityAVX2(float step);                                                               // Integrates bodies velocity 8 at a time, returns bodies integrated
+#endif
 static void CorrectPhysicsPositions(PhysicsManifold manifold);                                              // Corrects physics bodies positions based on manifolds collision information
-static float FindAxisLeastPenetration(int *faceIndex, PhysicsShape shapeA, PhysicsShape shapeB);            // Finds polygon shapes axis least penetration
-static void FindIncidentFace(Vector2 *v0, Vector2 *v1, PhysicsShape ref, PhysicsShape inc, int index);      // Finds two polygon shapes incident face
+static void BuildPhysicsIslands(void);                                                                      // Groups manifolds in islands that share no dynamic bodies
+static unsigned int FindIslandRoot(unsigned int index);                                                     // Returns union-find root body of a physics body island
+static void SolvePhysicsIslands(PhysicsIslandsJob job);                                                     // Does a job on every island, in parallel on solver threads
+static void RunIslandsJob(void);                                                                            // Takes islands and does current job on them until none is left
+static void UpdatePhysicsSleeping(void);                                                                    // Puts islands resting long enough to sleep
+static void WakePhysicsBodyNeighbours(PhysicsBody body);                                                    // Wakes up sleeping bodies touching a disabled body, they don't share its sleep list
+#if !defined(PHYSAC_NO_THREADS)
+static void *PhysicsWorker(void *arg);                                                                      // Solver worker thread function
+static void StopPhysicsWorkers(void);                                                                       // Exits and joins solver worker threads
+#endif
+static Vector2 GetSupport(const PhysicsShape *shape, Vector2 dir);                                          // Returns the extreme point along a direction within a polygon
+static float FindAxisLeastPenetration(int *faceIndex, const PhysicsShape *shapeA, const PhysicsShape *shapeB);  // Finds polygon shapes axis least penetration
+#if defined(PHYSAC_SIMD_SSE2)
+static int FindFacesDistanceSSE2(float *distances, const PhysicsShape *shapeA, const PhysicsShape *shapeB); // Computes A shape faces penetration distances into B shape 4 faces at a time
+#endif
+static int FindIncidentFace(Vector2 *v0, Vector2 *v1, PhysicsShape ref, PhysicsShape inc, int index);       // Finds two polygon shapes incident face, returns its index
 static int Clip(Vector2 normal, float clip, Vector2 *faceA, Vector2 *faceB);                                // Calculates clipping based on a normal and two faces
 static bool BiasGreaterThan(float valueA, float valueB);                                                    // Check if values are between bias range
+static void UpdatePhysicsBounds(void);                                                                      // Calculates physics bodies axis aligned bounding boxes
+static void GetPhysicsBodyBounds(PhysicsBody body, Vector2 *boundMin, Vector2 *boundMax);                   // Calculates a physics body axis aligned bounding box
+static void FindBroadphasePairs(void);                                                                      // Finds pairs of bodies which bounding boxes overlap
+static void FindPairsBruteForce(void);                                                                      // Adds every pair of bodies
+static void FindPairsGrid(void);                                                                            // Finds overlapping pairs with uniform grid spatial hash
+static void BuildPhysicsGrid(void);                                                                         // Adds bodies to uniform grid spatial hash cells their bounding box covers
+static void GetGridCell(int x, int y, unsigned int *start, unsigned int *end);                              // Returns sorted grid entries range of the bucket containing a cell
+static void UpdateQueryGrid(void);                                                                          // Builds bounds and grid again if bodies moved since last built
+static bool IsPhysicsBodiesOwner(void);                                                                     // Returns true if calling thread may use bodies (physics thread, or any while it doesn't run)
+static void BeginBodiesQuery(void);                                                                         // Starts a query which tests each physics body once
+static bool IsBodyQueried(unsigned int index);                                                              // Returns true if body was already tested by current query, marks it tested otherwise
+static bool ClipRayToBox(Vector2 origin, Vector2 direction, Vector2 inverseDirection, Vector2 boxMin, Vector2 boxMax, float *enter, float *exit);  // Clips a ray to a box, returns false if it doesn't cross it
+static bool CastShape(unsigned int index, Vector2 origin, Vector2 direction, Vector2 inverseDirection, float radius, float maxDistance, PhysicsHit *hit);  // Casts a ray or circle against a body shape, returns true if hit
+static bool CastShapeData(const PhysicsShape *shape, Vector2 position, Vector2 origin, Vector2 direction, float radius, float *hitDistance, Vector2 *hitNormal);  // Casts a ray or circle against a shape at a position, returns true if hit
+static int AddPhysicsHit(PhysicsHit *hits, int hitsCount, int maxHits, PhysicsHit hit);                     // Inserts a hit keeping hits sorted by distance, returns hits count
+static int AddPhysicsStateHit(PhysicsStateHit *hits, int hitsCount, int maxHits, PhysicsStateHit hit);      // Inserts a state hit keeping hits sorted by distance, returns hits count
+static int CastPhysicsState(const PhysicsState *state, Vector2 origin, float radius, Vector2 direction, float maxDistance, PhysicsStateHit *hits, int maxHits);  // Casts a ray (radius 0) or circle against bodies in a state, returns hits count
+static void GetPhysicsStateShape(const PhysicsState *state, int index, PhysicsShape *shape);                // Builds a physics body shape from its state in last step
+static void GetPhysicsStateBounds(const PhysicsState *state, int index, Vector2 *boundMin, Vector2 *boundMax);  // Calculates a physics body axis aligned bounding box from its state in last step
+static int CastPhysicsCircle(Vector2 origin, float radius, Vector2 direction, float maxDistance, PhysicsHit *hits, int maxHits, unsigned int ignored);  // Casts a circle ignoring a body, returns hits count
+static void SolvePhysicsBullets(void);                                                                      // Moves bullet bodies back to their first time of impact in last step
+static bool PolygonOverlapsBody(PhysicsBody polygon, PhysicsBody body);                                     // Returns true if a polygon shape body overlaps another body shape
+static bool BodyContainsPoint(unsigned int index, Vector2 point);                                           // Returns true if a body shape contains a point
+static bool ShapeContainsPoint(const PhysicsShape *shape, Vector2 position, Vector2 point);                 // Returns true if a shape at a position contains a point
+static void FindPairsSweepAndPrune(void);                                                                   // Finds overlapping pairs with sweep and prune along x axis
+static void AddBroadphasePair(unsigned int a, unsigned int b);                                              // Adds pair of bodies to test for collision
+static void *GrowArray(void *data, unsigned int *capacity, unsigned int count, unsigned int size);          // Returns array with room for count elements (moves data if needed)
+static void *ResizeArray(void *data, unsigned int count, unsigned int newCount, unsigned int size);         // Returns new array of newCount elements with first count elements of data
+static PhysicsSimdType DetectPhysicsSimd(void);                                                             // Returns best SIMD instructions supported by CPU and operating system
 static Vector2 TriangleBarycenter(Vector2 v1, Vector2 v2, Vector2 v3);                                      // Returns the barycenter of a triangle given by 3 points
 
 static void InitTimer(void);                                                                                // Initializes hi-resolution MONOTONIC timer
 static uint64_t TimeCount(void);                                                                         // Get hi-res MONOTONIC time measure in mseconds
+static float MathSin(float radians);                                                                        // Returns the sine of an angle (own polynomial if PHYSAC_DETERMINISTIC)
+static float MathCos(float radians);                                                                        // Returns the cosine of an angle (own polynomial if PHYSAC_DETERMINISTIC)
 static double CurrentTime(void);                                                                         // Get current time measure in milliseconds
 
 // Math functions
@@ -357,46 +908,71 @@ static inline Vector2 Mat2MultiplyVector2(Mat2 matrix, Vector2 vector);
 // Initializes physics values, pointers and creates physics loop thread
 PHYSACDEF void InitPhysics(void)
 {
-    #if !defined(PHYSAC_NO_THREADS)
-        // NOTE: if defined, user will need to create a thread for PhysicsThread function manually
-        // Create physics thread using POSIXS thread libraries
-        pthread_create(&physicsThreadId, NULL, &PhysicsLoop, NULL);
-    #endif
-
     // Initialize high resolution timer
     InitTimer();
 
+    // Select best SIMD kernels supported by CPU
+    physicsSimdSupported = DetectPhysicsSimd();
+    physicsSimd = physicsSimdSupported;
+
+    // Initialize commands queue, each slot can be written first at its own position
+    physicsCommands = (PhysicsCommand *)PHYSAC_MALLOC(sizeof(PhysicsCommand)*PHYSAC_MAX_COMMANDS);
+
+    for (unsigned int i = 0; i < PHYSAC_MAX_COMMANDS; i++)
+        physicsCommands[i].sequence = i;
+
+    commandsHead = 0;
+    commandsTail = 0;
+
+    // Handles are part of physics hash, so they start over for every peer initializing physics again
+    physicsHandlesNext = 0;
+
     #if defined(PHYSAC_DEBUG)
         printf("[PHYSAC] physics module initialized successfully\n");
     #endif
 
     accumulator = 0.0;
+
+    #if !defined(PHYSAC_NO_THREADS) && !defined(PHYSAC_NO_LOOP_THREAD)
+        // NOTE: if defined, user will need to create a thread for PhysicsThread function manually
+        // Create physics thread using POSIXS thread libraries, once everything it uses is initialized
+        physicsThreadEnabled = true;
+        pthread_create(&physicsThreadId, NULL, &PhysicsLoop, NULL);
+    #endif
 }
 
 // Returns true if physics thread is currently enabled
 PHYSACDEF bool IsPhysicsEnabled(void)
 {
-    return physicsThreadEnabled;
+    return (PHYSAC_ATOMIC_LOAD(&physicsThreadEnabled) != 0);
 }
 
 // Sets physics global gravity force
 PHYSACDEF void SetPhysicsGravity(float x, float y)
 {
+    // Waking bodies up races physics thread, it sets gravity before next step instead
+    if (!IsPhysicsBodiesOwner())
+    {
+        QueuePhysicsGravity(x, y);
+        return;
+    }
+
     gravityForce.x = x;
     gravityForce.y = y;
+
+    // Resting bodies may not be resting anymore
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
+        PhysicsWakeBody(bodies[i]);
 }
 
 // Creates a new circle physics body with generic parameters
 PHYSACDEF PhysicsBody CreatePhysicsBodyCircle(Vector2 pos, float radius, float density)
 {
-    PhysicsBody newBody = (PhysicsBody)PHYSAC_MALLOC(sizeof(PhysicsBodyData));
-    usedMemory += sizeof(PhysicsBodyData);
+    PhysicsBody newBody = AllocatePhysicsBody();
 
-    int newId = FindAvailableBodyIndex();
-    if (newId != -1)
+    if (newBody != NULL)
     {
         // Initialize new body with generic values
-        newBody->id = newId;
         newBody->enabled = true;
         newBody->position = pos;
         newBody->velocity = PHYSAC_VECTOR_ZERO;
@@ -420,8 +996,12 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyCircle(Vector2 pos, float radius, float d
         newBody->useGravity = true;
         newBody->isGrounded = false;
         newBody->freezeOrient = false;
+        newBody->isBullet = false;
+        newBody->isAwake = true;
+        newBody->sleepTime = 0.0f;
 
         // Add new body to bodies pointers array and update bodies count
+        bodiesIndex[newBody->id] = physicsBodiesCount;
         bodies[physicsBodiesCount] = newBody;
         physicsBodiesCount++;
 
@@ -431,7 +1011,7 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyCircle(Vector2 pos, float radius, float d
     }
     #if defined(PHYSAC_DEBUG)
         else
-            printf("[PHYSAC] new physics body creation failed because there is any available id to use\n");
+            printf("[PHYSAC] new physics body creation failed because there is not enough memory\n");
     #endif
 
     return newBody;
@@ -440,18 +1020,15 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyCircle(Vector2 pos, float radius, float d
 // Creates a new rectangle physics body with generic parameters
 PHYSACDEF PhysicsBody CreatePhysicsBodyRectangle(Vector2 pos, float width, float height, float density)
 {
-    PhysicsBody newBody = (PhysicsBody)PHYSAC_MALLOC(sizeof(PhysicsBodyData));
-    usedMemory += sizeof(PhysicsBodyData);
+    PhysicsBody newBody = AllocatePhysicsBody();
 
-    int newId = FindAvailableBodyIndex();
-    if (newId != -1)
+    if (newBody != NULL)
     {
         // Initialize new body with generic values
-        newBody->id = newId;
         newBody->enabled = true;
         newBody->position = pos;
-        newBody->velocity = (Vector2){ 0.0f };
-        newBody->force = (Vector2){ 0.0f };
+        newBody->velocity = PHYSAC_VECTOR_ZERO;
+        newBody->force = PHYSAC_VECTOR_ZERO;
         newBody->angularVelocity = 0.0f;
         newBody->torque = 0.0f;
         newBody->orient = 0.0f;
@@ -466,7 +1043,7 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyRectangle(Vector2 pos, float width, float
         float area = 0.0f;
         float inertia = 0.0f;
 
-        for (int i = 0; i < newBody->shape.vertexData.vertexCount; i++)
+        for (unsigned int i = 0; i < newBody->shape.vertexData.vertexCount; i++)
         {
             // Triangle vertices, third vertex implied as (0, 0)
             Vector2 p1 = newBody->shape.vertexData.positions[i];
@@ -492,7 +1069,7 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyRectangle(Vector2 pos, float width, float
 
         // Translate vertices to centroid (make the centroid (0, 0) for the polygon in model space)
         // Note: this is not really necessary
-        for (int i = 0; i < newBody->shape.vertexData.vertexCount; i++)
+        for (unsigned int i = 0; i < newBody->shape.vertexData.vertexCount; i++)
         {
             newBody->shape.vertexData.positions[i].x -= center.x;
             newBody->shape.vertexData.positions[i].y -= center.y;
@@ -508,8 +1085,12 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyRectangle(Vector2 pos, float width, float
         newBody->useGravity = true;
         newBody->isGrounded = false;
         newBody->freezeOrient = false;
+        newBody->isBullet = false;
+        newBody->isAwake = true;
+        newBody->sleepTime = 0.0f;
 
         // Add new body to bodies pointers array and update bodies count
+        bodiesIndex[newBody->id] = physicsBodiesCount;
         bodies[physicsBodiesCount] = newBody;
         physicsBodiesCount++;
 
@@ -519,7 +1100,7 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyRectangle(Vector2 pos, float width, float
     }
     #if defined(PHYSAC_DEBUG)
         else
-            printf("[PHYSAC] new physics body creation failed because there is any available id to use\n");
+            printf("[PHYSAC] new physics body creation failed because there is not enough memory\n");
     #endif
 
     return newBody;
@@ -528,14 +1109,11 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyRectangle(Vector2 pos, float width, float
 // Creates a new polygon physics body with generic parameters
 PHYSACDEF PhysicsBody CreatePhysicsBodyPolygon(Vector2 pos, float radius, int sides, float density)
 {
-    PhysicsBody newBody = (PhysicsBody)PHYSAC_MALLOC(sizeof(PhysicsBodyData));
-    usedMemory += sizeof(PhysicsBodyData);
+    PhysicsBody newBody = AllocatePhysicsBody();
 
-    int newId = FindAvailableBodyIndex();
-    if (newId != -1)
+    if (newBody != NULL)
     {
         // Initialize new body with generic values
-        newBody->id = newId;
         newBody->enabled = true;
         newBody->position = pos;
         newBody->velocity = PHYSAC_VECTOR_ZERO;
@@ -553,7 +1131,7 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyPolygon(Vector2 pos, float radius, int si
         float area = 0.0f;
         float inertia = 0.0f;
 
-        for (int i = 0; i < newBody->shape.vertexData.vertexCount; i++)
+        for (unsigned int i = 0; i < newBody->shape.vertexData.vertexCount; i++)
         {
             // Triangle vertices, third vertex implied as (0, 0)
             Vector2 position1 = newBody->shape.vertexData.positions[i];
@@ -579,7 +1157,7 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyPolygon(Vector2 pos, float radius, int si
 
         // Translate vertices to centroid (make the centroid (0, 0) for the polygon in model space)
         // Note: this is not really necessary
-        for (int i = 0; i < newBody->shape.vertexData.vertexCount; i++)
+        for (unsigned int i = 0; i < newBody->shape.vertexData.vertexCount; i++)
         {
             newBody->shape.vertexData.positions[i].x -= center.x;
             newBody->shape.vertexData.positions[i].y -= center.y;
@@ -595,8 +1173,12 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyPolygon(Vector2 pos, float radius, int si
         newBody->useGravity = true;
         newBody->isGrounded = false;
         newBody->freezeOrient = false;
+        newBody->isBullet = false;
+        newBody->isAwake = true;
+        newBody->sleepTime = 0.0f;
 
         // Add new body to bodies pointers array and update bodies count
+        bodiesIndex[newBody->id] = physicsBodiesCount;
         bodies[physicsBodiesCount] = newBody;
         physicsBodiesCount++;
 
@@ -606,7 +1188,7 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyPolygon(Vector2 pos, float radius, int si
     }
     #if defined(PHYSAC_DEBUG)
         else
-            printf("[PHYSAC] new physics body creation failed because there is any available id to use\n");
+            printf("[PHYSAC] new physics body creation failed because there is not enough memory\n");
     #endif
 
     return newBody;
@@ -616,14 +1198,58 @@ PHYSACDEF PhysicsBody CreatePhysicsBodyPolygon(Vector2 pos, float radius, int si
 PHYSACDEF void PhysicsAddForce(PhysicsBody body, Vector2 force)
 {
     if (body != NULL)
+    {
         body->force = Vector2Add(body->force, force);
+
+        if ((force.x != 0.0f) || (force.y != 0.0f))
+            PhysicsWakeBody(body);
+    }
 }
 
 // Adds an angular force to a physics body
 PHYSACDEF void PhysicsAddTorque(PhysicsBody body, float amount)
 {
     if (body != NULL)
+    {
         body->torque += amount;
+
+        if (amount != 0.0f)
+            PhysicsWakeBody(body);
+    }
+}
+
+// Wakes up a sleeping physics body and the bodies that fell asleep with it
+PHYSACDEF void PhysicsWakeBody(PhysicsBody body)
+{
+    if (body == NULL)
+        return;
+
+    if (sleepNext[body->id] != PHYSAC_NO_ISLAND)
+    {
+        unsigned int id = body->id;
+
+        do
+        {
+            PhysicsBody sleeping = &bodiesChunks[id/PHYSAC_BODIES_CHUNK][id%PHYSAC_BODIES_CHUNK];
+            unsigned int index = bodiesIndex[id];
+            unsigned int next = sleepNext[id];
+
+            sleeping->isAwake = true;
+            sleeping->sleepTime = 0.0f;
+            sleepNext[id] = PHYSAC_NO_ISLAND;
+            physicsSleepingCount--;
+
+            // Body can be woken up during a physics step, so it must be simulated from now on
+            bodiesData.enabled[index] = (sleeping->enabled ? 1.0f : 0.0f);
+            bodiesData.dynamic[index] = ((sleeping->enabled && (sleeping->inverseMass != 0.0f)) ? 1.0f : 0.0f);
+
+            id = next;
+        } while (id != body->id);
+    }
+
+    // Disabled bodies never fall asleep with the bodies resting on them, so these are woken up one by one
+    if (!body->enabled)
+        WakePhysicsBodyNeighbours(body);
 }
 
 // Shatters a polygon shape physics body to little physics bodies with explosion force
@@ -636,7 +1262,7 @@ PHYSACDEF void PhysicsShatter(PhysicsBody body, Vector2 position, float force)
             PolygonData vertexData = body->shape.vertexData;
             bool collision = false;
 
-            for (int i = 0; i < vertexData.vertexCount; i++)
+            for (unsigned int i = 0; i < vertexData.vertexCount; i++)
             {
                 Vector2 positionA = body->position;
                 Vector2 positionB = Mat2MultiplyVector2(body->shape.transform, Vector2Add(body->position, vertexData.positions[i]));
@@ -697,7 +1323,7 @@ PHYSACDEF void PhysicsShatter(PhysicsBody body, Vector2 position, float force)
                     newData.positions[2].y *= 0.95f;
 
                     // Calculate polygon faces normals
-                    for (int j = 0; j < newData.vertexCount; j++)
+                    for (unsigned int j = 0; j < newData.vertexCount; j++)
                     {
                         int nextVertex = (((j + 1) < newData.vertexCount) ? (j + 1) : 0);
                         Vector2 face = Vector2Subtract(newData.positions[nextVertex], newData.positions[j]);
@@ -715,7 +1341,7 @@ PHYSACDEF void PhysicsShatter(PhysicsBody body, Vector2 position, float force)
                     float area = 0.0f;
                     float inertia = 0.0f;
 
-                    for (int j = 0; j < newBody->shape.vertexData.vertexCount; j++)
+                    for (unsigned int j = 0; j < newBody->shape.vertexData.vertexCount; j++)
                     {
                         // Triangle vertices, third vertex implied as (0, 0)
                         Vector2 p1 = newBody->shape.vertexData.positions[j];
@@ -768,1214 +1394,3793 @@ PHYSACDEF void PhysicsShatter(PhysicsBody body, Vector2 position, float force)
     #endif
 }
 
-// Returns the current amount of created physics bodies
-PHYSACDEF int GetPhysicsBodiesCount(void)
+// Sets how pairs of bodies to test for collision are found
+PHYSACDEF void SetPhysicsBroadphase(PhysicsBroadphaseType type)
 {
-    return physicsBodiesCount;
+    broadphaseType = type;
 }
 
-// Returns a physics body of the bodies pool at a specific index
-PHYSACDEF PhysicsBody GetPhysicsBody(int index)
+// Sets broadphase grid cell size, 0 chooses it from average bodies size
+PHYSACDEF void SetPhysicsGridCellSize(float size)
 {
-    if (index < physicsBodiesCount)
-    {
-        if (bodies[index] == NULL)
-        {
-            #if defined(PHYSAC_DEBUG)
-                printf("[PHYSAC] error when trying to get a null reference physics body");
-            #endif
-        }
-    }
-    #if defined(PHYSAC_DEBUG)
-        else
-            printf("[PHYSAC] physics body index is out of bounds");
-    #endif
-
-    return bodies[index];
+    gridCellSize = size;
 }
 
-// Returns the physics body shape type (PHYSICS_CIRCLE or PHYSICS_POLYGON)
-PHYSACDEF int GetPhysicsShapeType(int index)
+// Returns the amount of bodies pairs tested for collision in last step
+PHYSACDEF int GetPhysicsBroadphasePairsCount(void)
 {
-    int result = -1;
-
-    if (index < physicsBodiesCount)
-    {
-        if (bodies[index] != NULL) 
-            result = bodies[index]->shape.type;
+    return broadphasePairsCount;
+}
 
-        #if defined(PHYSAC_DEBUG)
-            else
-                printf("[PHYSAC] error when trying to get a null reference physics body");
-        #endif
-    }
-    #if defined(PHYSAC_DEBUG)
-        else
-            printf("[PHYSAC] physics body index is out of bounds");
-    #endif
+// Sets SIMD instructions used by physics kernels (limited to the ones CPU supports)
+PHYSACDEF void SetPhysicsSimd(PhysicsSimdType type)
+{
+    physicsSimd = ((type > physicsSimdSupported) ? physicsSimdSupported : type);
+}
 
-    return result;
+// Returns SIMD instructions used by physics kernels
+PHYSACDEF PhysicsSimdType GetPhysicsSimd(void)
+{
+    return physicsSimd;
 }
 
-// Returns the amount of vertices of a physics body shape
-PHYSACDEF int GetPhysicsShapeVerticesCount(int index)
+// Sets threads solving physics islands, including the one running physics step (1 by default)
+// NOTE: Must not be called while a physics step is running, ClosePhysics() sets it back to 1
+PHYSACDEF void SetPhysicsThreads(int count)
 {
-    int result = 0;
+    count = min(max(count, 1), PHYSAC_MAX_THREADS);
 
-    if (index < physicsBodiesCount)
-    {
-        if (bodies[index] != NULL)
+    #if !defined(PHYSAC_NO_THREADS)
+        StopPhysicsWorkers();
+
+        // Workers wait for a job started after they were created
+        for (int i = 0; i < count - 1; i++)
         {
-            switch (bodies[index]->shape.type)
+            if (pthread_create(&physicsWorkers[physicsWorkersCount], NULL, &PhysicsWorker, (void *)(uintptr_t)physicsWorkersJob) != 0)
             {
-                case PHYSICS_CIRCLE: result = PHYSAC_CIRCLE_VERTICES; break;
-                case PHYSICS_POLYGON: result = bodies[index]->shape.vertexData.vertexCount; break;
-                default: break;
+                #if defined(PHYSAC_DEBUG)
+                    printf("[PHYSAC] physics solver thread creation failed, using %i threads\n", physicsWorkersCount + 1);
+                #endif
+                break;
             }
+
+            physicsWorkersCount++;
         }
-        #if defined(PHYSAC_DEBUG)
-            else
-                printf("[PHYSAC] error when trying to get a null reference physics body");
-        #endif
-    }
-    #if defined(PHYSAC_DEBUG)
-        else
-            printf("[PHYSAC] physics body index is out of bounds");
     #endif
+}
 
-    return result;
+// Returns threads solving physics islands
+PHYSACDEF int GetPhysicsThreads(void)
+{
+    #if !defined(PHYSAC_NO_THREADS)
+        return physicsWorkersCount + 1;
+    #else
+        return 1;
+    #endif
 }
 
-// Returns transformed position of a body shape (body position + vertex transformed position)
-PHYSACDEF Vector2 GetPhysicsShapeVertex(PhysicsBody body, int vertex)
+// Returns the amount of islands solved in last step
+PHYSACDEF int GetPhysicsIslandsCount(void)
 {
-    Vector2 position = { 0.0f, 0.0f };
+    return islandsCount;
+}
 
-    if (body != NULL)
+// Sets resting islands falling asleep state (enabled by default)
+PHYSACDEF void SetPhysicsSleeping(bool enabled)
+{
+    // Waking bodies up races physics thread, it sets sleeping state before next step instead
+    if (!IsPhysicsBodiesOwner())
     {
-        switch (body->shape.type)
-        {
-            case PHYSICS_CIRCLE:
-            {
-                position.x = body->position.x + cosf(360.0f/PHYSAC_CIRCLE_VERTICES*vertex*PHYSAC_DEG2RAD)*body->shape.radius;
-                position.y = body->position.y + sinf(360.0f/PHYSAC_CIRCLE_VERTICES*vertex*PHYSAC_DEG2RAD)*body->shape.radius;
-            } break;
-            case PHYSICS_POLYGON:
-            {
-                PolygonData vertexData = body->shape.vertexData;
-                position = Vector2Add(body->position, Mat2MultiplyVector2(body->shape.transform, vertexData.positions[vertex]));
-            } break;
-            default: break;
-        }
+        QueuePhysicsSleeping(enabled);
+        return;
     }
-    #if defined(PHYSAC_DEBUG)
-        else
-            printf("[PHYSAC] error when trying to get a null reference physics body");
-    #endif
 
-    return position;
+    sleepingEnabled = enabled;
+
+    if (!enabled)
+    {
+        for (unsigned int i = 0; i < physicsBodiesCount; i++)
+            PhysicsWakeBody(bodies[i]);
+    }
 }
 
-// Sets physics body shape transform based on radians parameter
-PHYSACDEF void SetPhysicsBodyRotation(PhysicsBody body, float radians)
+// Returns the amount of enabled bodies simulated in last step
+PHYSACDEF int GetPhysicsAwakeBodiesCount(void)
 {
-    if (body != NULL)
-    {
-        body->orient = radians;
+    return physicsAwakeCount;
+}
 
-        if (body->shape.type == PHYSICS_POLYGON)
-            body->shape.transform = Mat2Radians(radians);
-    }
+// Returns the amount of sleeping physics bodies
+PHYSACDEF int GetPhysicsSleepingBodiesCount(void)
+{
+    return physicsSleepingCount;
 }
 
-// Unitializes and destroys a physics body
-PHYSACDEF void DestroyPhysicsBody(PhysicsBody body)
+// Sets collision solver iterations done every step (PHYSAC_COLLISION_ITERATIONS by default)
+PHYSACDEF void SetPhysicsCollisionIterations(int iterations)
 {
-    if (body != NULL)
+    collisionIterations = max(iterations, 1);
+}
+
+// Returns collision solver iterations done every step
+PHYSACDEF int GetPhysicsCollisionIterations(void)
+{
+    return collisionIterations;
+}
+
+// Sets contact points starting from previous step impulses state (enabled by default)
+PHYSACDEF void SetPhysicsWarmStarting(bool enabled)
+{
+    warmStarting = enabled;
+}
+
+// Casts a ray and fills nearest hits sorted by distance, returns hits count
+// NOTE: Returns -1 when called from other thread than physics one while it runs (see PhysicsStateRaycast())
+PHYSACDEF int PhysicsRaycast(Vector2 origin, Vector2 direction, float maxDistance, PhysicsHit *hits, int maxHits)
+{
+    if (!IsPhysicsBodiesOwner())
+        return -1;
+
+    float length = sqrtf(MathLenSqr(direction));
+
+    if ((hits == NULL) || (maxHits <= 0) || (length == 0.0f) || (physicsBodiesCount == 0))
+        return 0;
+
+    BeginBodiesQuery();
+
+    direction = (Vector2){ direction.x/length, direction.y/length };
+    Vector2 inverseDirection = { 1.0f/direction.x, 1.0f/direction.y };
+    int hitsCount = 0;
+    PhysicsHit hit = { 0 };
+
+    // Bodies covering too many cells are not in the grid
+    for (int i = 0; i < gridLargeBodiesCount; i++)
     {
-        int id = body->id;
-        int index = -1;
+        if (CastShape(gridLargeBodies[i], origin, direction, inverseDirection, 0.0f, maxDistance, &hit))
+            hitsCount = AddPhysicsHit(hits, hitsCount, maxHits, hit);
+    }
 
-        for (int i = 0; i < physicsBodiesCount; i++)
-        {
-            if (bodies[i]->id == id)
-            {
-                index = i;
-                break;
-            }
-        }
+    // Clip ray to bodies bounding box, there is nothing to hit outside
+    float enter = 0.0f;
+    float exit = maxDistance;
+
+    if (!ClipRayToBox(origin, direction, inverseDirection, gridBoundsMin, gridBoundsMax, &enter, &exit))
+        return hitsCount;
+
+    // Walk grid cells crossed by ray in order (stops when no farther cell can have a nearer hit)
+    const float cellSize = gridCellSizeUsed;
+    Vector2 entry = { origin.x + direction.x*enter, origin.y + direction.y*enter };
+    int x = (int)floorf(entry.x/cellSize);
+    int y = (int)floorf(entry.y/cellSize);
+    int stepX = ((direction.x > 0.0f) ? 1 : -1);
+    int stepY = ((direction.y > 0.0f) ? 1 : -1);
+    float deltaX = ((direction.x != 0.0f) ? fabsf(cellSize*inverseDirection.x) : PHYSAC_FLT_MAX);
+    float deltaY = ((direction.y != 0.0f) ? fabsf(cellSize*inverseDirection.y) : PHYSAC_FLT_MAX);
+    float nextX = ((direction.x != 0.0f) ? (((x + ((stepX > 0) ? 1 : 0))*cellSize - origin.x)*inverseDirection.x) : PHYSAC_FLT_MAX);
+    float nextY = ((direction.y != 0.0f) ? (((y + ((stepY > 0) ? 1 : 0))*cellSize - origin.y)*inverseDirection.y) : PHYSAC_FLT_MAX);
+
+    while (true)
+    {
+        unsigned int first = 0;
+        unsigned int last = 0;
+        GetGridCell(x, y, &first, &last);
 
-        if (index == -1)
+        for (unsigned int i = first; i < last; i++)
         {
-            #if defined(PHYSAC_DEBUG)
-                printf("[PHYSAC] Not possible to find body id %i in pointers array\n", id);
-            #endif
-            return;
-        }
+            const unsigned int *cell = &gridSorted[i*4];
 
-        // Free body allocated memory
-        PHYSAC_FREE(body);
-        usedMemory -= sizeof(PhysicsBodyData);
-        bodies[index] = NULL;
+            if (((int)cell[1] != x) || ((int)cell[2] != y) || IsBodyQueried(cell[0]))
+                continue;
 
-        // Reorder physics bodies pointers array and its catched index
-        for (int i = index; i < physicsBodiesCount; i++)
-        {
-            if ((i + 1) < physicsBodiesCount)
-                bodies[i] = bodies[i + 1];
+            if (CastShape(cell[0], origin, direction, inverseDirection, 0.0f, ((hitsCount == maxHits) ? hits[hitsCount - 1].distance : maxDistance), &hit))
+                hitsCount = AddPhysicsHit(hits, hitsCount, maxHits, hit);
         }
 
-        // Update physics bodies count
-        physicsBodiesCount--;
+        float cellExit = min(nextX, nextY);
 
-        #if defined(PHYSAC_DEBUG)
-            printf("[PHYSAC] destroyed physics body id %i\n", id);
-        #endif
-    }
-    #if defined(PHYSAC_DEBUG)
-        else
-            printf("[PHYSAC] error trying to destroy a null referenced body\n");
-    #endif
-}
-
-// Unitializes physics pointers and exits physics loop thread
-PHYSACDEF void ClosePhysics(void)
-{
-    // Exit physics loop thread
-    physicsThreadEnabled = false;
-
-    #if !defined(PHYSAC_NO_THREADS)
-        pthread_join(physicsThreadId, NULL);
-    #endif
-
-    // Unitialize physics manifolds dynamic memory allocations
-    for (int i = physicsManifoldsCount - 1; i >= 0; i--)
-        DestroyPhysicsManifold(contacts[i]);
-
-    // Unitialize physics bodies dynamic memory allocations
-    for (int i = physicsBodiesCount - 1; i >= 0; i--)
-        DestroyPhysicsBody(bodies[i]);
-
-    #if defined(PHYSAC_DEBUG)
-        if (physicsBodiesCount > 0 || usedMemory != 0)
-            printf("[PHYSAC] physics module closed with %i still allocated bodies [MEMORY: %i bytes]\n", physicsBodiesCount, usedMemory);
-        else if (physicsManifoldsCount > 0 || usedMemory != 0)
-            printf("[PHYSAC] physics module closed with %i still allocated manifolds [MEMORY: %i bytes]\n", physicsManifoldsCount, usedMemory);
-        else
-            printf("[PHYSAC] physics module closed successfully\n");
-    #endif
-}
-
-//----------------------------------------------------------------------------------
-// Module Internal Functions Definition
-//----------------------------------------------------------------------------------
-// Finds a valid index for a new physics body initialization
-static int FindAvailableBodyIndex()
-{
-    int index = -1;
-    for (int i = 0; i < PHYSAC_MAX_BODIES; i++)
-    {
-        int currentId = i;
+        if ((cellExit > exit) || ((hitsCount == maxHits) && (hits[hitsCount - 1].distance <= cellExit)))
+            break;
 
-        // Check if current id already exist in other physics body
-        for (int k = 0; k < physicsBodiesCount; k++)
+        if (nextX < nextY)
         {
-            if (bodies[k]->id == currentId)
-            {
-                currentId++;
-                break;
-            }
+            x += stepX;
+            nextX += deltaX;
         }
-
-        // If it is not used, use it as new physics body id
-        if (currentId == i)
+        else
         {
-            index = i;
-            break;
+            y += stepY;
+            nextY += deltaY;
         }
     }
 
-    return index;
+    return hitsCount;
 }
 
-// Creates a random polygon shape with max vertex distance from polygon pivot
-static PolygonData CreateRandomPolygon(float radius, int sides)
+// Casts a circle and fills nearest hits sorted by distance, returns hits count
+// NOTE: Bodies are found with swept circle bounding box, so it is meant for short casts. Returns -1 when called
+// from other thread than physics one while it runs (see PhysicsStateCircleCast())
+PHYSACDEF int PhysicsCircleCast(Vector2 origin, float radius, Vector2 direction, float maxDistance, PhysicsHit *hits, int maxHits)
 {
-    PolygonData data = { 0 };
-    data.vertexCount = sides;
+    if (!IsPhysicsBodiesOwner())
+        return -1;
 
-    // Calculate polygon vertices positions
-    for (int i = 0; i < data.vertexCount; i++)
-    {
-        data.positions[i].x = cosf(360.0f/sides*i*PHYSAC_DEG2RAD)*radius;
-        data.positions[i].y = sinf(360.0f/sides*i*PHYSAC_DEG2RAD)*radius;
-    }
+    float length = sqrtf(MathLenSqr(direction));
 
-    // Calculate polygon faces normals
-    for (int i = 0; i < data.vertexCount; i++)
-    {
-        int nextIndex = (((i + 1) < sides) ? (i + 1) : 0);
-        Vector2 face = Vector2Subtract(data.positions[nextIndex], data.positions[i]);
+    if ((hits == NULL) || (maxHits <= 0) || (length == 0.0f) || (physicsBodiesCount == 0))
+        return 0;
 
-        data.normals[i] = (Vector2){ face.y, -face.x };
-        MathNormalize(&data.normals[i]);
-    }
+    if (radius <= 0.0f)
+        return PhysicsRaycast(origin, direction, maxDistance, hits, maxHits);
 
-    return data;
+    direction = (Vector2){ direction.x/length, direction.y/length };
+
+    return CastPhysicsCircle(origin, radius, direction, maxDistance, hits, maxHits, PHYSAC_NO_BODY);
 }
 
-// Creates a rectangle polygon shape based on a min and max positions
-static PolygonData CreateRectanglePolygon(Vector2 pos, Vector2 size)
+// Casts a circle along a normalized direction ignoring a body (PHYSAC_NO_BODY for none), returns hits count
+static int CastPhysicsCircle(Vector2 origin, float radius, Vector2 direction, float maxDistance, PhysicsHit *hits, int maxHits, unsigned int ignored)
 {
-    PolygonData data = { 0 };
-    data.vertexCount = 4;
+    BeginBodiesQuery();
 
-    // Calculate polygon vertices positions
-    data.positions[0] = (Vector2){ pos.x + size.x/2, pos.y - size.y/2 };
-    data.positions[1] = (Vector2){ pos.x + size.x/2, pos.y + size.y/2 };
-    data.positions[2] = (Vector2){ pos.x - size.x/2, pos.y + size.y/2 };
-    data.positions[3] = (Vector2){ pos.x - size.x/2, pos.y - size.y/2 };
+    // Ignored body counts as already tested
+    if (ignored != PHYSAC_NO_BODY)
+        queryStamps[ignored] = queryStamp;
 
-    // Calculate polygon faces normals
-    for (int i = 0; i < data.vertexCount; i++)
+    Vector2 inverseDirection = { 1.0f/direction.x, 1.0f/direction.y };
+    Vector2 end = { origin.x + direction.x*maxDistance, origin.y + direction.y*maxDistance };
+    Vector2 sweptMin = { min(origin.x, end.x) - radius, min(origin.y, end.y) - radius };
+    Vector2 sweptMax = { max(origin.x, end.x) + radius, max(origin.y, end.y) + radius };
+    int hitsCount = 0;
+    PhysicsHit hit = { 0 };
+
+    for (int i = 0; i < gridLargeBodiesCount; i++)
     {
-        int nextIndex = (((i + 1) < data.vertexCount) ? (i + 1) : 0);
-        Vector2 face = Vector2Subtract(data.positions[nextIndex], data.positions[i]);
+        if (IsBodyQueried(gridLargeBodies[i]))
+            continue;
 
-        data.normals[i] = (Vector2){ face.y, -face.x };
-        MathNormalize(&data.normals[i]);
+        if (CastShape(gridLargeBodies[i], origin, direction, inverseDirection, radius, maxDistance, &hit))
+            hitsCount = AddPhysicsHit(hits, hitsCount, maxHits, hit);
     }
 
-    return data;
-}
+    // Test bodies in cells covered by swept circle bounding box
+    int minX = (int)floorf(max(sweptMin.x, gridBoundsMin.x)/gridCellSizeUsed);
+    int minY = (int)floorf(max(sweptMin.y, gridBoundsMin.y)/gridCellSizeUsed);
+    int maxX = (int)floorf(min(sweptMax.x, gridBoundsMax.x)/gridCellSizeUsed);
+    int maxY = (int)floorf(min(sweptMax.y, gridBoundsMax.y)/gridCellSizeUsed);
 
-// Physics loop thread function
-static void *PhysicsLoop(void *arg)
-{
-    #if defined(PHYSAC_DEBUG)
-        printf("[PHYSAC] physics thread created successfully\n");
-    #endif
+    for (int y = minY; y <= maxY; y++)
+    {
+        for (int x = minX; x <= maxX; x++)
+        {
+            unsigned int first = 0;
+            unsigned int last = 0;
+            GetGridCell(x, y, &first, &last);
+
+            for (unsigned int i = first; i < last; i++)
+            {
+                const unsigned int *cell = &gridSorted[i*4];
 
-    // Initialize physics loop thread values
-    physicsThreadEnabled = true;
+                if (((int)cell[1] != x) || ((int)cell[2] != y) || IsBodyQueried(cell[0]))
+                    continue;
 
-    // Physics update loop
-    while (physicsThreadEnabled)
-    {
-        RunPhysicsStep();
+                if (CastShape(cell[0], origin, direction, inverseDirection, radius, ((hitsCount == maxHits) ? hits[hitsCount - 1].distance : maxDistance), &hit))
+                    hitsCount = AddPhysicsHit(hits, hitsCount, maxHits, hit);
+            }
+        }
     }
 
-    return NULL;
+    return hitsCount;
 }
 
-// Physics steps calculations (dynamics, collisions and position corrections)
-static void PhysicsStep(void)
+// Fills bodies which bounding box overlaps a box, returns bodies count
+// NOTE: Returns -1 when called from other thread than physics one while it runs (see PhysicsStateQueryAABB())
+PHYSACDEF int PhysicsQueryAABB(Vector2 boxMin, Vector2 boxMax, PhysicsBody *results, int maxResults)
 {
-    // Update current steps count
-    stepsCount++;
+    if (!IsPhysicsBodiesOwner())
+        return -1;
+
+    if ((results == NULL) || (maxResults <= 0) || (physicsBodiesCount == 0))
+        return 0;
+
+    BeginBodiesQuery();
+
+    int count = 0;
+    int minX = (int)floorf(max(boxMin.x, gridBoundsMin.x)/gridCellSizeUsed);
+    int minY = (int)floorf(max(boxMin.y, gridBoundsMin.y)/gridCellSizeUsed);
+    int maxX = (int)floorf(min(boxMax.x, gridBoundsMax.x)/gridCellSizeUsed);
+    int maxY = (int)floorf(min(boxMax.y, gridBoundsMax.y)/gridCellSizeUsed);
 
-    // Clear previous generated collisions information
-    for (int i = physicsManifoldsCount - 1; i >= 0; i--)
+    // Big boxes cover more cells than bodies, test every body instead
+    if (((float)(maxX - minX + 1)*(float)(maxY - minY + 1)) > physicsBodiesCount)
     {
-        PhysicsManifold manifold = contacts[i];
-        
-        if (manifold != NULL)
-            DestroyPhysicsManifold(manifold);
+        for (unsigned int i = 0; (i < physicsBodiesCount) && (count < maxResults); i++)
+        {
+            if ((boundsMin[i].x <= boxMax.x) && (boundsMax[i].x >= boxMin.x) && (boundsMin[i].y <= boxMax.y) && (boundsMax[i].y >= boxMin.y))
+                results[count++] = bodies[i];
+        }
+
+        return count;
     }
 
-    // Reset physics bodies grounded state
-    for (int i = 0; i < physicsBodiesCount; i++)
+    for (int i = 0; (i < gridLargeBodiesCount) && (count < maxResults); i++)
     {
-        PhysicsBody body = bodies[i];
-        body->isGrounded = false;
+        unsigned int index = gridLargeBodies[i];
+
+        if ((boundsMin[index].x <= boxMax.x) && (boundsMax[index].x >= boxMin.x) && (boundsMin[index].y <= boxMax.y) && (boundsMax[index].y >= boxMin.y))
+            results[count++] = bodies[index];
     }
 
-    // Generate new collision information
-    for (int i = 0; i < physicsBodiesCount; i++)
+    for (int y = minY; y <= maxY; y++)
     {
-        PhysicsBody bodyA = bodies[i];
-
-        if (bodyA != NULL)
+        for (int x = minX; x <= maxX; x++)
         {
-            for (int j = i + 1; j < physicsBodiesCount; j++)
-            {
-                PhysicsBody bodyB = bodies[j];
+            unsigned int first = 0;
+            unsigned int last = 0;
+            GetGridCell(x, y, &first, &last);
 
-                if (bodyB != NULL)
-                {
-                    if ((bodyA->inverseMass == 0) && (bodyB->inverseMass == 0))
-                        continue;
+            for (unsigned int i = first; (i < last) && (count < maxResults); i++)
+            {
+                const unsigned int *cell = &gridSorted[i*4];
+                unsigned int index = cell[0];
 
-                    PhysicsManifold manifold = CreatePhysicsManifold(bodyA, bodyB);
-                    SolvePhysicsManifold(manifold);
+                if (((int)cell[1] != x) || ((int)cell[2] != y) || IsBodyQueried(index))
+                    continue;
 
-                    if (manifold->contactsCount > 0)
-                    {
-                        // Create a new manifold with same information as previously solved manifold and add it to the manifolds pool last slot
-                        PhysicsManifold newManifold = CreatePhysicsManifold(bodyA, bodyB);
-                        newManifold->penetration = manifold->penetration;
-                        newManifold->normal = manifold->normal;
-                        newManifold->contacts[0] = manifold->contacts[0];
-                        newManifold->contacts[1] = manifold->contacts[1];
-                        newManifold->contactsCount = manifold->contactsCount;
-                        newManifold->restitution = manifold->restitution;
-                        newManifold->dynamicFriction = manifold->dynamicFriction;
-                        newManifold->staticFriction = manifold->staticFriction;
-                    }
-                }
+                if ((boundsMin[index].x <= boxMax.x) && (boundsMax[index].x >= boxMin.x) && (boundsMin[index].y <= boxMax.y) && (boundsMax[index].y >= boxMin.y))
+                    results[count++] = bodies[index];
             }
         }
     }
 
-    // Integrate forces to physics bodies
-    for (int i = 0; i < physicsBodiesCount; i++)
-    {
-        PhysicsBody body = bodies[i];
-        
-        if (body != NULL)
-            IntegratePhysicsForces(body);
-    }
+    return count;
+}
 
-    // Initialize physics manifolds to solve collisions
-    for (int i = 0; i < physicsManifoldsCount; i++)
-    {
-        PhysicsManifold manifold = contacts[i];
-        
-        if (manifold != NULL)
-            InitializePhysicsManifolds(manifold);
-    }
+// Fills bodies which shape contains a point, returns bodies count
+// NOTE: Returns -1 when called from other thread than physics one while it runs (see PhysicsStateQueryPoint())
+PHYSACDEF int PhysicsQueryPoint(Vector2 point, PhysicsBody *results, int maxResults)
+{
+    if (!IsPhysicsBodiesOwner())
+        return -1;
 
-    // Integrate physics collisions impulses to solve collisions
-    for (int i = 0; i < PHYSAC_COLLISION_ITERATIONS; i++)
-    {
-        for (int j = 0; j < physicsManifoldsCount; j++)
-        {
-            PhysicsManifold manifold = contacts[i];
-            
-            if (manifold != NULL)
-                IntegratePhysicsImpulses(manifold);
-        }
-    }
+    if ((results == NULL) || (maxResults <= 0) || (physicsBodiesCount == 0))
+        return 0;
 
-    // Integrate velocity to physics bodies
-    for (int i = 0; i < physicsBodiesCount; i++)
-    {
-        PhysicsBody body = bodies[i];
-        
-        if (body != NULL)
-            IntegratePhysicsVelocity(body);
-    }
+    UpdateQueryGrid();
 
-    // Correct physics bodies positions based on manifolds collision information
-    for (int i = 0; i < physicsManifoldsCount; i++)
+    int count = 0;
+
+    for (int i = 0; (i < gridLargeBodiesCount) && (count < maxResults); i++)
     {
-        PhysicsManifold manifold = contacts[i];
-        
-        if (manifold != NULL)
-            CorrectPhysicsPositions(manifold);
+        if (BodyContainsPoint(gridLargeBodies[i], point))
+            results[count++] = bodies[gridLargeBodies[i]];
     }
 
-    // Clear physics bodies forces
-    for (int i = 0; i < physicsBodiesCount; i++)
+    // A point is only in one cell, so bodies can't be found twice
+    int x = (int)floorf(point.x/gridCellSizeUsed);
+    int y = (int)floorf(point.y/gridCellSizeUsed);
+    unsigned int first = 0;
+    unsigned int last = 0;
+    GetGridCell(x, y, &first, &last);
+
+    for (unsigned int i = first; (i < last) && (count < maxResults); i++)
     {
-        PhysicsBody body = bodies[i];
-        
-        if (body != NULL)
-        {
-            body->force = PHYSAC_VECTOR_ZERO;
-            body->torque = 0.0f;
-        }
+        const unsigned int *cell = &gridSorted[i*4];
+
+        if (((int)cell[1] == x) && ((int)cell[2] == y) && BodyContainsPoint(cell[0], point))
+            results[count++] = bodies[cell[0]];
     }
+
+    return count;
 }
 
-// Wrapper to ensure PhysicsStep is run with at a fixed time step
-PHYSACDEF void RunPhysicsStep(void)
+// Queues creation of a circle physics body, returns its handle (0 if queue is full)
+PHYSACDEF PhysicsHandle QueuePhysicsBodyCircle(Vector2 pos, float radius, float density)
 {
-    // Calculate current time
-    currentTime = CurrentTime();
+    PhysicsCommand command = { 0, PHYSICS_COMMAND_CIRCLE, NewPhysicsHandle(), pos, { radius, density, 0.0f } };
 
-    // Calculate current delta time
-    const double delta = currentTime - startTime;
+    return (QueuePhysicsCommand(command) ? command.handle : PHYSAC_NO_HANDLE);
+}
 
-    // Store the time elapsed since the last frame began
-    accumulator += delta;
+// Queues creation of a rectangle physics body, returns its handle (0 if queue is full)
+PHYSACDEF PhysicsHandle QueuePhysicsBodyRectangle(Vector2 pos, float width, float height, float density)
+{
+    PhysicsCommand command = { 0, PHYSICS_COMMAND_RECTANGLE, NewPhysicsHandle(), pos, { width, height, density } };
 
-    // Fixed time stepping loop
-    while (accumulator >= deltaTime)
-    {
-        PhysicsStep();
-        accumulator -= deltaTime;
-    }
+    return (QueuePhysicsCommand(command) ? command.handle : PHYSAC_NO_HANDLE);
+}
 
-    // Record the starting of this frame
-    startTime = currentTime;
+// Queues creation of a polygon physics body, returns its handle (0 if queue is full)
+PHYSACDEF PhysicsHandle QueuePhysicsBodyPolygon(Vector2 pos, float radius, int sides, float density)
+{
+    PhysicsCommand command = { 0, PHYSICS_COMMAND_POLYGON, NewPhysicsHandle(), pos, { radius, (float)sides, density } };
+
+    return (QueuePhysicsCommand(command) ? command.handle : PHYSAC_NO_HANDLE);
 }
 
-PHYSACDEF void SetPhysicsTimeStep(double delta)
+// Queues adding a force to a physics body, returns false if queue is full
+PHYSACDEF bool QueuePhysicsAddForce(PhysicsHandle handle, Vector2 force)
 {
-    deltaTime = delta;
+    PhysicsCommand command = { 0, PHYSICS_COMMAND_FORCE, handle, force, { 0.0f, 0.0f, 0.0f } };
+
+    return QueuePhysicsCommand(command);
 }
 
-// Finds a valid index for a new manifold initialization
-static int FindAvailableManifoldIndex()
+// Queues adding an angular force to a physics body, returns false if queue is full
+PHYSACDEF bool QueuePhysicsAddTorque(PhysicsHandle handle, float amount)
 {
-    int index = -1;
-    for (int i = 0; i < PHYSAC_MAX_MANIFOLDS; i++)
-    {
-        int currentId = i;
+    PhysicsCommand command = { 0, PHYSICS_COMMAND_TORQUE, handle, PHYSAC_VECTOR_ZERO, { amount, 0.0f, 0.0f } };
 
-        // Check if current id already exist in other physics body
-        for (int k = 0; k < physicsManifoldsCount; k++)
-        {
-            if (contacts[k]->id == currentId)
-            {
-                currentId++;
-                break;
-            }
-        }
+    return QueuePhysicsCommand(command);
+}
 
-        // If it is not used, use it as new physics body id
-        if (currentId == i)
-        {
-            index = i;
-            break;
-        }
-    }
+// Queues setting a physics body rotation, returns false if queue is full
+PHYSACDEF bool QueuePhysicsBodyRotation(PhysicsHandle handle, float radians)
+{
+    PhysicsCommand command = { 0, PHYSICS_COMMAND_ROTATION, handle, PHYSAC_VECTOR_ZERO, { radians, 0.0f, 0.0f } };
 
-    return index;
+    return QueuePhysicsCommand(command);
 }
 
-// Creates a new physics manifold to solve collision
-static PhysicsManifold CreatePhysicsManifold(PhysicsBody a, PhysicsBody b)
+// Queues setting a physics body continuous collision detection, returns false if queue is full
+PHYSACDEF bool QueuePhysicsBodyBullet(PhysicsHandle handle, bool enabled)
 {
-    PhysicsManifold newManifold = (PhysicsManifold)PHYSAC_MALLOC(sizeof(PhysicsManifoldData));
-    usedMemory += sizeof(PhysicsManifoldData);
+    PhysicsCommand command = { 0, PHYSICS_COMMAND_BULLET, handle, PHYSAC_VECTOR_ZERO, { (enabled ? 1.0f : 0.0f), 0.0f, 0.0f } };
 
-    int newId = FindAvailableManifoldIndex();
-    if (newId != -1)
-    {
-        // Initialize new manifold with generic values
-        newManifold->id = newId;
-        newManifold->bodyA = a;
-        newManifold->bodyB = b;
-        newManifold->penetration = 0;
-        newManifold->normal = PHYSAC_VECTOR_ZERO;
-        newManifold->contacts[0] = PHYSAC_VECTOR_ZERO;
-        newManifold->contacts[1] = PHYSAC_VECTOR_ZERO;
-        newManifold->contactsCount = 0;
-        newManifold->restitution = 0.0f;
-        newManifold->dynamicFriction = 0.0f;
-        newManifold->staticFriction = 0.0f;
+    return QueuePhysicsCommand(command);
+}
 
-        // Add new body to bodies pointers array and update bodies count
-        contacts[physicsManifoldsCount] = newManifold;
-        physicsManifoldsCount++;
-    }
-    #if defined(PHYSAC_DEBUG)
-        else
-            printf("[PHYSAC] new physics manifold creation failed because there is any available id to use\n");
-    #endif
+// Queues destroying a physics body, returns false if queue is full
+PHYSACDEF bool QueueDestroyPhysicsBody(PhysicsHandle handle)
+{
+    PhysicsCommand command = { 0, PHYSICS_COMMAND_DESTROY, handle, PHYSAC_VECTOR_ZERO, { 0.0f, 0.0f, 0.0f } };
 
-    return newManifold;
+    return QueuePhysicsCommand(command);
 }
 
-// Unitializes and destroys a physics manifold
-static void DestroyPhysicsManifold(PhysicsManifold manifold)
+// Queues setting physics global gravity force, returns false if queue is full
+PHYSACDEF bool QueuePhysicsGravity(float x, float y)
 {
-    if (manifold != NULL)
-    {
-        int id = manifold->id;
-        int index = -1;
+    PhysicsCommand command = { 0, PHYSICS_COMMAND_GRAVITY, PHYSAC_NO_HANDLE, (Vector2){ x, y }, { 0.0f, 0.0f, 0.0f } };
 
-        for (int i = 0; i < physicsManifoldsCount; i++)
-        {
-            if (contacts[i]->id == id)
-            {
-                index = i;
-                break;
-            }
-        }
+    return QueuePhysicsCommand(command);
+}
 
-        if (index == -1)
-        {
-            #if defined(PHYSAC_DEBUG)
-                printf("[PHYSAC] Not possible to manifold id %i in pointers array\n", id);
-            #endif
-            return;
-        }      
+// Queues setting resting islands falling asleep state, returns false if queue is full
+PHYSACDEF bool QueuePhysicsSleeping(bool enabled)
+{
+    PhysicsCommand command = { 0, PHYSICS_COMMAND_SLEEPING, PHYSAC_NO_HANDLE, PHYSAC_VECTOR_ZERO, { (enabled ? 1.0f : 0.0f), 0.0f, 0.0f } };
 
-        // Free manifold allocated memory
-        PHYSAC_FREE(manifold);
-        usedMemory -= sizeof(PhysicsManifoldData);
-        contacts[index] = NULL;
+    return QueuePhysicsCommand(command);
+}
 
-        // Reorder physics manifolds pointers array and its catched index
-        for (int i = index; i < physicsManifoldsCount; i++)
-        {
-            if ((i + 1) < physicsManifoldsCount)
-                contacts[i] = contacts[i + 1];
-        }
+// Returns last published physics state (valid until next call), NULL if none yet
+// NOTE: Only one thread must acquire states, published states are swapped with the acquired one without locks
+PHYSACDEF const PhysicsState *AcquirePhysicsState(void)
+{
+    if (PHYSAC_ATOMIC_LOAD(&statesMiddle) & PHYSAC_STATE_FRESH)
+        statesFront = PHYSAC_ATOMIC_EXCHANGE(&statesMiddle, statesFront) & ~PHYSAC_STATE_FRESH;
 
-        // Update physics manifolds count
-        physicsManifoldsCount--;
-    }
-    #if defined(PHYSAC_DEBUG)
-        else
-            printf("[PHYSAC] error trying to destroy a null referenced manifold\n");
-    #endif
+    return ((physicsStates[statesFront].stepsCount > 0) ? &physicsStates[statesFront] : NULL);
 }
 
-// Solves a created physics manifold between two physics bodies
-static void SolvePhysicsManifold(PhysicsManifold manifold)
+// Returns how far current time is between state previous and last step (0 - 1)
+PHYSACDEF float GetPhysicsStateAlpha(const PhysicsState *state)
 {
-    switch (manifold->bodyA->shape.type)
+    if (state == NULL)
+        return 1.0f;
+
+    float alpha = (float)((CurrentTime() - state->time)/deltaTime);
+
+    return min(max(alpha, 0.0f), 1.0f);
+}
+
+// Returns index of a physics body in state, -1 if not found
+PHYSACDEF int FindPhysicsBodyState(const PhysicsState *state, PhysicsHandle handle)
+{
+    if ((state == NULL) || (handle == PHYSAC_NO_HANDLE))
+        return -1;
+
+    for (unsigned int slot = (handle*2654435761u) & (state->handlesSize - 1); state->handles[slot] != PHYSAC_NO_BODY; slot = (slot + 1) & (state->handlesSize - 1))
     {
-        case PHYSICS_CIRCLE:
-        {
-            switch (manifold->bodyB->shape.type)
-            {
-                case PHYSICS_CIRCLE: SolveCircleToCircle(manifold); break;
-                case PHYSICS_POLYGON: SolveCircleToPolygon(manifold); break;
-                default: break;
-            }
-        } break;
-        case PHYSICS_POLYGON:
-        {
-            switch (manifold->bodyB->shape.type)
-            {
-                case PHYSICS_CIRCLE: SolvePolygonToCircle(manifold); break;
-                case PHYSICS_POLYGON: SolvePolygonToPolygon(manifold); break;
-                default: break;
-            }
-        } break;
-        default: break;
+        if (state->bodies[state->handles[slot]].handle == handle)
+            return (int)state->handles[slot];
     }
 
-    // Update physics body grounded state if normal direction is down and grounded state is not set yet in previous manifolds
-    if (!manifold->bodyB->isGrounded)
-        manifold->bodyB->isGrounded = (manifold->normal.y < 0);
+    return -1;
 }
 
-// Solves collision between two circle shape physics bodies
-static void SolveCircleToCircle(PhysicsManifold manifold)
+// Returns physics body position interpolated between previous and last step
+PHYSACDEF Vector2 GetPhysicsStatePosition(const PhysicsState *state, int index, float alpha)
 {
-    PhysicsBody bodyA = manifold->bodyA;
-    PhysicsBody bodyB = manifold->bodyB;
+    const PhysicsBodyState *body = &state->bodies[index];
 
-    if ((bodyA == NULL) || (bodyB == NULL))
-        return;
+    return (Vector2){ body->previousPosition.x + (body->position.x - body->previousPosition.x)*alpha,
+                      body->previousPosition.y + (body->position.y - body->previousPosition.y)*alpha };
+}
 
-    // Calculate translational vector, which is normal
-    Vector2 normal = Vector2Subtract(bodyB->position, bodyA->position);
+// Returns physics body rotation interpolated between previous and last step
+PHYSACDEF float GetPhysicsStateOrient(const PhysicsState *state, int index, float alpha)
+{
+    const PhysicsBodyState *body = &state->bodies[index];
 
-    float distSqr = MathLenSqr(normal);
-    float radius = bodyA->shape.radius + bodyB->shape.radius;
+    return body->previousOrient + (body->orient - body->previousOrient)*alpha;
+}
 
-    // Check if circles are not in contact
-    if (distSqr >= radius*radius)
+// Returns physics body shape vertex interpolated between previous and last step
+PHYSACDEF Vector2 GetPhysicsStateVertex(const PhysicsState *state, int index, int vertex, float alpha)
+{
+    const PhysicsBodyState *body = &state->bodies[index];
+    Vector2 position = GetPhysicsStatePosition(state, index, alpha);
+
+    if (body->type == PHYSICS_CIRCLE)
     {
-        manifold->contactsCount = 0;
-        return;
+        position.x += MathCos(360.0f/PHYSAC_CIRCLE_VERTICES*vertex*PHYSAC_DEG2RAD)*body->radius;
+        position.y += MathSin(360.0f/PHYSAC_CIRCLE_VERTICES*vertex*PHYSAC_DEG2RAD)*body->radius;
     }
+    else
+        position = Vector2Add(position, Mat2MultiplyVector2(Mat2Radians(GetPhysicsStateOrient(state, index, alpha)), state->vertices[body->verticesStart + vertex]));
 
-    float distance = sqrtf(distSqr);
-    manifold->contactsCount = 1;
+    return position;
+}
 
-    if (distance == 0.0f)
+// Casts a ray against bodies in state last step and fills nearest hits sorted by distance, returns hits count
+// NOTE: Any thread can use it, bodies are tested one by one (no grid), so it is meant for small worlds or few queries
+PHYSACDEF int PhysicsStateRaycast(const PhysicsState *state, Vector2 origin, Vector2 direction, float maxDistance, PhysicsStateHit *hits, int maxHits)
+{
+    return CastPhysicsState(state, origin, 0.0f, direction, maxDistance, hits, maxHits);
+}
+
+// Casts a circle against bodies in state last step and fills nearest hits sorted by distance, returns hits count
+PHYSACDEF int PhysicsStateCircleCast(const PhysicsState *state, Vector2 origin, float radius, Vector2 direction, float maxDistance, PhysicsStateHit *hits, int maxHits)
+{
+    return CastPhysicsState(state, origin, max(radius, 0.0f), direction, maxDistance, hits, maxHits);
+}
+
+// Fills state indices of bodies which bounding box in last step overlaps a box, returns bodies count
+PHYSACDEF int PhysicsStateQueryAABB(const PhysicsState *state, Vector2 boxMin, Vector2 boxMax, int *results, int maxResults)
+{
+    if ((state == NULL) || (results == NULL) || (maxResults <= 0))
+        return 0;
+
+    int count = 0;
+
+    for (int i = 0; (i < state->bodiesCount) && (count < maxResults); i++)
     {
-        manifold->penetration = bodyA->shape.radius;
-        manifold->normal = (Vector2){ 1.0f, 0.0f };
-        manifold->contacts[0] = bodyA->position;
+        Vector2 boundMin = { 0.0f, 0.0f };
+        Vector2 boundMax = { 0.0f, 0.0f };
+        GetPhysicsStateBounds(state, i, &boundMin, &boundMax);
+
+        if ((boundMin.x <= boxMax.x) && (boundMax.x >= boxMin.x) && (boundMin.y <= boxMax.y) && (boundMax.y >= boxMin.y))
+            results[count++] = i;
+    }
+
+    return count;
+}
+
+// Fills state indices of bodies which shape in last step contains a point, returns bodies count
+PHYSACDEF int PhysicsStateQueryPoint(const PhysicsState *state, Vector2 point, int *results, int maxResults)
+{
+    if ((state == NULL) || (results == NULL) || (maxResults <= 0))
+        return 0;
+
+    int count = 0;
+    PhysicsShape shape = { 0 };
+
+    for (int i = 0; (i < state->bodiesCount) && (count < maxResults); i++)
+    {
+        Vector2 boundMin = { 0.0f, 0.0f };
+        Vector2 boundMax = { 0.0f, 0.0f };
+        GetPhysicsStateBounds(state, i, &boundMin, &boundMax);
+
+        if ((point.x < boundMin.x) || (point.x > boundMax.x) || (point.y < boundMin.y) || (point.y > boundMax.y))
+            continue;
+
+        GetPhysicsStateShape(state, i, &shape);
+
+        if (ShapeContainsPoint(&shape, state->bodies[i].position, point))
+            results[count++] = i;
+    }
+
+    return count;
+}
+
+// Returns the handle of a physics body
+PHYSACDEF PhysicsHandle GetPhysicsBodyHandle(PhysicsBody body)
+{
+    return (((body != NULL) && IsPhysicsBodiesOwner()) ? bodiesHandles[body->id] : PHYSAC_NO_HANDLE);
+}
+
+// Returns the physics body of a handle, NULL if destroyed or not created yet
+PHYSACDEF PhysicsBody GetPhysicsBodyByHandle(PhysicsHandle handle)
+{
+    if (!IsPhysicsBodiesOwner() || (handle == PHYSAC_NO_HANDLE) || (handlesTable == NULL))
+        return NULL;
+
+    // Entries of destroyed bodies are kept, body id must still have the handle
+    for (unsigned int slot = (handle*2654435761u) & (handlesTableSize - 1); handlesTable[slot] != PHYSAC_NO_BODY; slot = (slot + 1) & (handlesTableSize - 1))
+    {
+        unsigned int id = handlesTable[slot];
+
+        if (bodiesHandles[id] == handle)
+            return &bodiesChunks[id/PHYSAC_BODIES_CHUNK][id%PHYSAC_BODIES_CHUNK];
+    }
+
+    return NULL;
+}
+
+// Returns the current amount of created physics bodies
+PHYSACDEF int GetPhysicsBodiesCount(void)
+{
+    return physicsBodiesCount;
+}
+
+// Returns a physics body of the bodies pool at a specific index
+PHYSACDEF PhysicsBody GetPhysicsBody(int index)
+{
+    if ((index >= 0) && ((unsigned int)index < physicsBodiesCount))
+    {
+        if (bodies[index] == NULL)
+        {
+            #if defined(PHYSAC_DEBUG)
+                printf("[PHYSAC] error when trying to get a null reference physics body");
+            #endif
+        }
+    }
+    #if defined(PHYSAC_DEBUG)
+        else
+            printf("[PHYSAC] physics body index is out of bounds");
+    #endif
+
+    return bodies[index];
+}
+
+// Returns the physics body shape type (PHYSICS_CIRCLE or PHYSICS_POLYGON)
+PHYSACDEF int GetPhysicsShapeType(int index)
+{
+    int result = -1;
+
+    if ((index >= 0) && ((unsigned int)index < physicsBodiesCount))
+    {
+        if (bodies[index] != NULL) 
+            result = bodies[index]->shape.type;
+
+        #if defined(PHYSAC_DEBUG)
+            else
+                printf("[PHYSAC] error when trying to get a null reference physics body");
+        #endif
+    }
+    #if defined(PHYSAC_DEBUG)
+        else
+            printf("[PHYSAC] physics body index is out of bounds");
+    #endif
+
+    return result;
+}
+
+// Returns the amount of vertices of a physics body shape
+PHYSACDEF int GetPhysicsShapeVerticesCount(int index)
+{
+    int result = 0;
+
+    if ((index >= 0) && ((unsigned int)index < physicsBodiesCount))
+    {
+        if (bodies[index] != NULL)
+        {
+            switch (bodies[index]->shape.type)
+            {
+                case PHYSICS_CIRCLE: result = PHYSAC_CIRCLE_VERTICES; break;
+                case PHYSICS_POLYGON: result = bodies[index]->shape.vertexData.vertexCount; break;
+                default: break;
+            }
+        }
+        #if defined(PHYSAC_DEBUG)
+            else
+                printf("[PHYSAC] error when trying to get a null reference physics body");
+        #endif
+    }
+    #if defined(PHYSAC_DEBUG)
+        else
+            printf("[PHYSAC] physics body index is out of bounds");
+    #endif
+
+    return result;
+}
+
+// Returns transformed position of a body shape (body position + vertex transformed position)
+PHYSACDEF Vector2 GetPhysicsShapeVertex(PhysicsBody body, int vertex)
+{
+    Vector2 position = { 0.0f, 0.0f };
+
+    if (body != NULL)
+    {
+        switch (body->shape.type)
+        {
+            case PHYSICS_CIRCLE:
+            {
+                position.x = body->position.x + MathCos(360.0f/PHYSAC_CIRCLE_VERTICES*vertex*PHYSAC_DEG2RAD)*body->shape.radius;
+                position.y = body->position.y + MathSin(360.0f/PHYSAC_CIRCLE_VERTICES*vertex*PHYSAC_DEG2RAD)*body->shape.radius;
+            } break;
+            case PHYSICS_POLYGON:
+            {
+                PolygonData vertexData = body->shape.vertexData;
+                position = Vector2Add(body->position, Mat2MultiplyVector2(body->shape.transform, vertexData.positions[vertex]));
+            } break;
+            default: break;
+        }
+    }
+    #if defined(PHYSAC_DEBUG)
+        else
+            printf("[PHYSAC] error when trying to get a null reference physics body");
+    #endif
+
+    return position;
+}
+
+// Sets physics body shape transform based on radians parameter
+PHYSACDEF void SetPhysicsBodyRotation(PhysicsBody body, float radians)
+{
+    if (body != NULL)
+    {
+        PhysicsWakeBody(body);
+        body->orient = radians;
+        queryGridValid = false;
+
+        if (body->shape.type == PHYSICS_POLYGON)
+            body->shape.transform = Mat2Radians(radians);
+    }
+}
+
+// Unitializes and destroys a physics body
+PHYSACDEF void DestroyPhysicsBody(PhysicsBody body)
+{
+    if (body != NULL)
+    {
+        unsigned int id = body->id;
+        int index = -1;
+
+        if ((id < bodiesIdsCount) && (bodiesIndex[id] < physicsBodiesCount) && (bodies[bodiesIndex[id]] == body))
+            index = bodiesIndex[id];
+
+        if (index == -1)
+        {
+            #if defined(PHYSAC_DEBUG)
+                printf("[PHYSAC] Not possible to find body id %i in pointers array\n", id);
+            #endif
+            return;
+        }
+
+        // Bodies that fell asleep resting on destroyed body must fall again
+        PhysicsWakeBody(body);
+        queryGridValid = false;
+
+        // Manifolds of destroyed body must not warm start a new body taking its id
+        unsigned int keptManifolds = 0;
+
+        for (unsigned int i = 0; i < physicsManifoldsCount; i++)
+        {
+            if ((contacts[i].bodyA != body) && (contacts[i].bodyB != body))
+                contacts[keptManifolds++] = contacts[i];
+        }
+
+        physicsManifoldsCount = keptManifolds;
+
+        // Release body memory chunk slot
+        bodiesHandles[id] = PHYSAC_NO_HANDLE;
+        bodiesFreeIds[bodiesFreeIdsCount] = id;
+        bodiesFreeIdsCount++;
+        usedMemory -= sizeof(PhysicsBodyData);
+
+        // Move last physics body to destroyed body index and update physics bodies count
+        physicsBodiesCount--;
+        bodies[index] = bodies[physicsBodiesCount];
+        bodiesIndex[bodies[index]->id] = index;
+        bodies[physicsBodiesCount] = NULL;
+
+        #if defined(PHYSAC_DEBUG)
+            printf("[PHYSAC] destroyed physics body id %i\n", id);
+        #endif
+    }
+    #if defined(PHYSAC_DEBUG)
+        else
+            printf("[PHYSAC] error trying to destroy a null referenced body\n");
+    #endif
+}
+
+// Unitializes physics pointers and exits physics loop thread
+PHYSACDEF void ClosePhysics(void)
+{
+    // Exit physics loop thread
+    #if !defined(PHYSAC_NO_THREADS) && !defined(PHYSAC_NO_LOOP_THREAD)
+        if (physicsThreadEnabled)
+        {
+            PHYSAC_ATOMIC_STORE(&physicsThreadEnabled, false);
+            pthread_join(physicsThreadId, NULL);
+        }
+    #endif
+
+    physicsThreadEnabled = false;
+
+    #if !defined(PHYSAC_NO_THREADS)
+        StopPhysicsWorkers();
+    #endif
+
+    // Unitialize physics manifolds pools
+    PHYSAC_FREE(contacts);
+    PHYSAC_FREE(previousContacts);
+    PHYSAC_FREE(contactsCache);
+    contacts = NULL;
+    previousContacts = NULL;
+    contactsCache = NULL;
+    physicsManifoldsCount = 0;
+    physicsManifoldsCapacity = 0;
+    previousManifoldsCount = 0;
+    previousManifoldsCapacity = 0;
+    contactsCacheSize = 0;
+
+    // Every body is destroyed, so none of them needs to be woken up
+    for (unsigned int i = 0; i < bodiesIdsCount; i++)
+        sleepNext[i] = PHYSAC_NO_ISLAND;
+
+    physicsSleepingCount = 0;
+
+    // Unitialize physics bodies dynamic memory allocations
+    for (int i = physicsBodiesCount - 1; i >= 0; i--)
+        DestroyPhysicsBody(bodies[i]);
+
+    for (unsigned int i = 0; i < bodiesChunksCount; i++)
+        PHYSAC_FREE(bodiesChunks[i]);
+
+    float **hotData[] = { &bodiesData.positionX, &bodiesData.positionY, &bodiesData.velocityX, &bodiesData.velocityY, &bodiesData.forceX, &bodiesData.forceY,
+                          &bodiesData.angularVelocity, &bodiesData.torque, &bodiesData.orient, &bodiesData.inverseMass, &bodiesData.inverseInertia,
+                          &bodiesData.enabled, &bodiesData.dynamic, &bodiesData.useGravity, &bodiesData.rotation };
+
+    for (unsigned int i = 0; i < sizeof(hotData)/sizeof(hotData[0]); i++)
+    {
+        PHYSAC_FREE(*hotData[i]);
+        *hotData[i] = NULL;
+    }
+
+    PHYSAC_FREE(bodies);
+    PHYSAC_FREE(bodiesChunks);
+    PHYSAC_FREE(bodiesIndex);
+    PHYSAC_FREE(bodiesFreeIds);
+    PHYSAC_FREE(bodiesHandles);
+    PHYSAC_FREE(lastStates);
+    PHYSAC_FREE(handlesTable);
+    PHYSAC_FREE(sleepNext);
+    PHYSAC_FREE(boundsMin);
+    PHYSAC_FREE(boundsMax);
+    PHYSAC_FREE(gridLarge);
+    PHYSAC_FREE(gridLargeBodies);
+    PHYSAC_FREE(queryStamps);
+    PHYSAC_FREE(sapOrder);
+    PHYSAC_FREE(bullets);
+    PHYSAC_FREE(bulletsStart);
+    bodies = NULL;
+    bodiesChunks = NULL;
+    bodiesIndex = NULL;
+    bodiesFreeIds = NULL;
+    bodiesHandles = NULL;
+    lastStates = NULL;
+    handlesTable = NULL;
+    handlesTableSize = 0;
+    handlesTableCount = 0;
+    sleepNext = NULL;
+    boundsMin = NULL;
+    boundsMax = NULL;
+    gridLarge = NULL;
+    gridLargeBodies = NULL;
+    queryStamps = NULL;
+    gridLargeBodiesCount = 0;
+    queryGridValid = false;
+    sapOrder = NULL;
+    bullets = NULL;
+    bulletsStart = NULL;
+    bulletsCount = 0;
+    bulletsCapacity = 0;
+    bulletsStartCapacity = 0;
+    physicsBodiesCapacity = 0;
+    bodiesChunksCount = 0;
+    bodiesChunksCapacity = 0;
+    bodiesIdsCount = 0;
+    bodiesFreeIdsCount = 0;
+
+    // Unitialize broadphase dynamic memory allocations
+    PHYSAC_FREE(broadphasePairs);
+    PHYSAC_FREE(gridEntries);
+    PHYSAC_FREE(gridSorted);
+    PHYSAC_FREE(gridBuckets);
+    broadphasePairs = NULL;
+    gridEntries = NULL;
+    gridSorted = NULL;
+    gridBuckets = NULL;
+    broadphasePairsCapacity = 0;
+    gridEntriesCapacity = 0;
+    gridSortedCapacity = 0;
+    gridBucketsCapacity = 0;
+    sapCount = 0;
+
+    // Unitialize islands dynamic memory allocations
+    PHYSAC_FREE(islandParent);
+    PHYSAC_FREE(islandIds);
+    PHYSAC_FREE(islands);
+    PHYSAC_FREE(islandManifolds);
+    PHYSAC_FREE(islandSleepTime);
+    PHYSAC_FREE(islandSleepHead);
+    PHYSAC_FREE(sleepingPairs);
+    islandParent = NULL;
+    islandIds = NULL;
+    islands = NULL;
+    islandManifolds = NULL;
+    islandSleepTime = NULL;
+    islandSleepHead = NULL;
+    sleepingPairs = NULL;
+    islandsCount = 0;
+    islandsCapacity = 0;
+    islandManifoldsCapacity = 0;
+    sleepingPairsCapacity = 0;
+    physicsSleepingCount = 0;
+    physicsAwakeCount = 0;
+
+    // Unitialize commands queue and published states
+    PHYSAC_FREE(physicsCommands);
+    physicsCommands = NULL;
+
+    for (int i = 0; i < 3; i++)
+    {
+        PHYSAC_FREE(physicsStates[i].bodies);
+        PHYSAC_FREE(physicsStates[i].vertices);
+        PHYSAC_FREE(physicsStates[i].handles);
+        memset(&physicsStates[i], 0, sizeof(PhysicsState));
+    }
+
+    statesBack = 0;
+    statesMiddle = 1;
+    statesFront = 2;
+
+    #if defined(PHYSAC_DEBUG)
+        if (physicsBodiesCount > 0 || usedMemory != 0)
+            printf("[PHYSAC] physics module closed with %i still allocated bodies [MEMORY: %i bytes]\n", physicsBodiesCount, usedMemory);
+        else if (physicsManifoldsCount > 0 || usedMemory != 0)
+            printf("[PHYSAC] physics module closed with %i still allocated manifolds [MEMORY: %i bytes]\n", physicsManifoldsCount, usedMemory);
+        else
+            printf("[PHYSAC] physics module closed successfully\n");
+    #endif
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+// Allocates a physics body from bodies chunks with a free id
+// NOTE: Body is not added to bodies pointers array, but there is room for it
+static PhysicsBody AllocatePhysicsBody(void)
+{
+    unsigned int id = 0;
+
+    if (bodiesFreeIdsCount > 0)
+    {
+        bodiesFreeIdsCount--;
+        id = bodiesFreeIds[bodiesFreeIdsCount];
     }
     else
     {
-        manifold->penetration = radius - distance;
-        manifold->normal = (Vector2){ normal.x/distance, normal.y/distance }; // Faster than using MathNormalize() due to sqrt is already performed
-        manifold->contacts[0] = (Vector2){ manifold->normal.x*bodyA->shape.radius + bodyA->position.x, manifold->normal.y*bodyA->shape.radius + bodyA->position.y };
+        // All chunks slots are used, allocate a new chunk
+        if (bodiesIdsCount == bodiesChunksCount*PHYSAC_BODIES_CHUNK)
+        {
+            PhysicsBodyData *chunk = (PhysicsBodyData *)PHYSAC_MALLOC(sizeof(PhysicsBodyData)*PHYSAC_BODIES_CHUNK);
+
+            if (chunk == NULL)
+                return NULL;
+
+            bodiesChunks = (PhysicsBodyData **)GrowArray(bodiesChunks, &bodiesChunksCapacity, bodiesChunksCount + 1, sizeof(PhysicsBodyData *));
+            bodiesChunks[bodiesChunksCount] = chunk;
+            bodiesChunksCount++;
+
+            bodiesIndex = (unsigned int *)ResizeArray(bodiesIndex, bodiesIdsCount, bodiesIdsCount + PHYSAC_BODIES_CHUNK, sizeof(unsigned int));
+            sleepNext = (unsigned int *)ResizeArray(sleepNext, bodiesIdsCount, bodiesIdsCount + PHYSAC_BODIES_CHUNK, sizeof(unsigned int));
+            bodiesHandles = (PhysicsHandle *)ResizeArray(bodiesHandles, bodiesIdsCount, bodiesIdsCount + PHYSAC_BODIES_CHUNK, sizeof(PhysicsHandle));
+            lastStates = (PhysicsBodyState *)ResizeArray(lastStates, bodiesIdsCount, bodiesIdsCount + PHYSAC_BODIES_CHUNK, sizeof(PhysicsBodyState));
+            bodiesFreeIds = (unsigned int *)ResizeArray(bodiesFreeIds, bodiesFreeIdsCount, bodiesIdsCount + PHYSAC_BODIES_CHUNK, sizeof(unsigned int));
+        }
+
+        id = bodiesIdsCount;
+        bodiesIdsCount++;
+    }
+
+    ReservePhysicsBodies(physicsBodiesCount + 1);
+    queryGridValid = false;
+
+    PhysicsBody body = &bodiesChunks[id/PHYSAC_BODIES_CHUNK][id%PHYSAC_BODIES_CHUNK];
+    memset(body, 0, sizeof(PhysicsBodyData));
+    body->id = id;
+    sleepNext[id] = PHYSAC_NO_ISLAND;
+    bodiesHandles[id] = ((queuedHandle != PHYSAC_NO_HANDLE) ? queuedHandle : NewPhysicsHandle());
+    lastStates[id].handle = PHYSAC_NO_HANDLE;
+    AddPhysicsHandle(id);
+    usedMemory += sizeof(PhysicsBodyData);
+
+    return body;
+}
+
+// Grows physics bodies arrays to fit count bodies
+static void ReservePhysicsBodies(unsigned int count)
+{
+    if (count <= physicsBodiesCapacity)
+        return;
+
+    unsigned int capacity = max(max(physicsBodiesCapacity*2, count), 64);
+
+    // Bounds, grid, islands and hot data are filled every step, they don't need to be copied
+    bodies = (PhysicsBody *)ResizeArray(bodies, physicsBodiesCount, capacity, sizeof(PhysicsBody));
+    boundsMin = (Vector2 *)ResizeArray(boundsMin, 0, capacity, sizeof(Vector2));
+    boundsMax = (Vector2 *)ResizeArray(boundsMax, 0, capacity, sizeof(Vector2));
+    gridLarge = (bool *)ResizeArray(gridLarge, 0, capacity, sizeof(bool));
+    gridLargeBodies = (unsigned int *)ResizeArray(gridLargeBodies, 0, capacity, sizeof(unsigned int));
+    queryStamps = (unsigned int *)ResizeArray(queryStamps, 0, capacity, sizeof(unsigned int));
+    memset(queryStamps, 0, capacity*sizeof(unsigned int));
+    queryStamp = 0;
+    sapOrder = (unsigned int *)ResizeArray(sapOrder, 0, capacity, sizeof(unsigned int));
+    sapCount = 0;
+    islandParent = (unsigned int *)ResizeArray(islandParent, 0, capacity, sizeof(unsigned int));
+    islandIds = (unsigned int *)ResizeArray(islandIds, 0, capacity, sizeof(unsigned int));
+    islandSleepTime = (float *)ResizeArray(islandSleepTime, 0, capacity, sizeof(float));
+    islandSleepHead = (unsigned int *)ResizeArray(islandSleepHead, 0, capacity, sizeof(unsigned int));
+
+    float **hotData[] = { &bodiesData.positionX, &bodiesData.positionY, &bodiesData.velocityX, &bodiesData.velocityY, &bodiesData.forceX, &bodiesData.forceY,
+                          &bodiesData.angularVelocity, &bodiesData.torque, &bodiesData.orient, &bodiesData.inverseMass, &bodiesData.inverseInertia,
+                          &bodiesData.enabled, &bodiesData.dynamic, &bodiesData.useGravity, &bodiesData.rotation };
+
+    for (unsigned int i = 0; i < sizeof(hotData)/sizeof(hotData[0]); i++)
+        *hotData[i] = (float *)ResizeArray(*hotData[i], 0, capacity, sizeof(float));
+
+    physicsBodiesCapacity = capacity;
+}
+
+// Copies physics bodies hot data to contiguous arrays
+static void GatherPhysicsBodies(void)
+{
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
+    {
+        PhysicsBody body = bodies[i];
+
+        bodiesData.positionX[i] = body->position.x;
+        bodiesData.positionY[i] = body->position.y;
+        bodiesData.velocityX[i] = body->velocity.x;
+        bodiesData.velocityY[i] = body->velocity.y;
+        bodiesData.forceX[i] = body->force.x;
+        bodiesData.forceY[i] = body->force.y;
+        bodiesData.angularVelocity[i] = body->angularVelocity;
+        bodiesData.torque[i] = body->torque;
+        bodiesData.orient[i] = body->orient;
+        bodiesData.inverseMass[i] = body->inverseMass;
+        bodiesData.inverseInertia[i] = body->inverseInertia;
+        bodiesData.enabled[i] = ((body->enabled && body->isAwake) ? 1.0f : 0.0f);
+        bodiesData.dynamic[i] = ((body->enabled && body->isAwake && (body->inverseMass != 0.0f)) ? 1.0f : 0.0f);
+        bodiesData.useGravity[i] = (body->useGravity ? 1.0f : 0.0f);
+        bodiesData.rotation[i] = (body->freezeOrient ? 0.0f : 1.0f);
+    }
+}
+
+// Copies physics bodies hot data back to bodies and clears forces
+static void ScatterPhysicsBodies(void)
+{
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
+    {
+        PhysicsBody body = bodies[i];
+
+        body->position = (Vector2){ bodiesData.positionX[i], bodiesData.positionY[i] };
+        body->velocity = (Vector2){ bodiesData.velocityX[i], bodiesData.velocityY[i] };
+        body->angularVelocity = bodiesData.angularVelocity[i];
+        body->orient = bodiesData.orient[i];
+
+        if (body->enabled && body->isAwake)
+            Mat2Set(&body->shape.transform, body->orient);
+
+        body->force = PHYSAC_VECTOR_ZERO;
+        body->torque = 0.0f;
+    }
+}
+
+// Creates a random polygon shape with max vertex distance from polygon pivot
+static PolygonData CreateRandomPolygon(float radius, int sides)
+{
+    PolygonData data = { 0 };
+    data.vertexCount = sides;
+
+    // Calculate polygon vertices positions
+    for (unsigned int i = 0; i < data.vertexCount; i++)
+    {
+        data.positions[i].x = MathCos(360.0f/sides*i*PHYSAC_DEG2RAD)*radius;
+        data.positions[i].y = MathSin(360.0f/sides*i*PHYSAC_DEG2RAD)*radius;
+    }
+
+    // Calculate polygon faces normals
+    for (unsigned int i = 0; i < data.vertexCount; i++)
+    {
+        unsigned int nextIndex = (((i + 1) < data.vertexCount) ? (i + 1) : 0);
+        Vector2 face = Vector2Subtract(data.positions[nextIndex], data.positions[i]);
+
+        data.normals[i] = (Vector2){ face.y, -face.x };
+        MathNormalize(&data.normals[i]);
+    }
+
+    return data;
+}
+
+// Creates a rectangle polygon shape based on a min and max positions
+static PolygonData CreateRectanglePolygon(Vector2 pos, Vector2 size)
+{
+    PolygonData data = { 0 };
+    data.vertexCount = 4;
+
+    // Calculate polygon vertices positions
+    data.positions[0] = (Vector2){ pos.x + size.x/2, pos.y - size.y/2 };
+    data.positions[1] = (Vector2){ pos.x + size.x/2, pos.y + size.y/2 };
+    data.positions[2] = (Vector2){ pos.x - size.x/2, pos.y + size.y/2 };
+    data.positions[3] = (Vector2){ pos.x - size.x/2, pos.y - size.y/2 };
+
+    // Calculate polygon faces normals
+    for (unsigned int i = 0; i < data.vertexCount; i++)
+    {
+        int nextIndex = (((i + 1) < data.vertexCount) ? (i + 1) : 0);
+        Vector2 face = Vector2Subtract(data.positions[nextIndex], data.positions[i]);
+
+        data.normals[i] = (Vector2){ face.y, -face.x };
+        MathNormalize(&data.normals[i]);
+    }
+
+    return data;
+}
+
+#if !defined(PHYSAC_NO_THREADS) && !defined(PHYSAC_NO_LOOP_THREAD)
+// Physics loop thread function
+static void *PhysicsLoop(void *arg)
+{
+    (void)arg;
+
+    #if defined(PHYSAC_DEBUG)
+        printf("[PHYSAC] physics thread created successfully\n");
+    #endif
+
+    double stepTime = CurrentTime();
+
+    // Physics update loop, steps are done every deltaTime and thread sleeps in between
+    while (PHYSAC_ATOMIC_LOAD(&physicsThreadEnabled))
+    {
+        RunPhysicsCommands();
+        PhysicsStep();
+        stepTime += deltaTime;
+        PublishPhysicsState(stepTime);
+
+        // Steps are done one after another until physics catches up, unless it is too behind to
+        double now = CurrentTime();
+
+        if ((now - stepTime) > PHYSAC_MAX_STEPS_DELAY)
+            stepTime = now;
+        else if (stepTime > now)
+        {
+            // Nothing moves while no body is awake, so skipped steps are done in a row after waking up
+            if ((physicsAwakeCount == 0) && (PHYSAC_ATOMIC_LOAD(&commandsTail) == commandsHead))
+                WaitPhysicsTime(max(stepTime - now, PHYSAC_IDLE_WAIT));
+            else
+                WaitPhysicsTime(stepTime - now);
+        }
+    }
+
+    return NULL;
+}
+
+// Sleeps physics thread for some time
+// NOTE: On Windows sleeping lasts at least the system timer resolution
+static void WaitPhysicsTime(double milliseconds)
+{
+    #if defined(_WIN32)
+        Sleep((unsigned long)milliseconds);
+    #else
+        struct timespec wait = { (time_t)(milliseconds/1000.0), (long)(fmod(milliseconds, 1000.0)*1000000.0) };
+        nanosleep(&wait, NULL);
+    #endif
+}
+#endif
+
+// Adds a command to commands queue, returns false if queue is full
+// NOTE: Any thread can queue commands, a slot is taken by moving queue tail and is marked written with its sequence
+static bool QueuePhysicsCommand(PhysicsCommand command)
+{
+    if (physicsCommands == NULL)
+        return false;
+
+    unsigned int position = PHYSAC_ATOMIC_LOAD(&commandsTail);
+
+    while (true)
+    {
+        PhysicsCommand *slot = &physicsCommands[position & (PHYSAC_MAX_COMMANDS - 1)];
+        int difference = (int)(PHYSAC_ATOMIC_LOAD(&slot->sequence) - position);
+
+        if (difference == 0)
+        {
+            // Slot is free, take it unless another thread did
+            if (PHYSAC_ATOMIC_COMPARE_EXCHANGE(&commandsTail, position, position + 1))
+            {
+                slot->type = command.type;
+                slot->handle = command.handle;
+                slot->vector = command.vector;
+                memcpy(slot->values, command.values, sizeof(command.values));
+                PHYSAC_ATOMIC_STORE(&slot->sequence, position + 1);
+
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            // Physics thread didn't read slot command from previous lap
+            #if defined(PHYSAC_DEBUG)
+                printf("[PHYSAC] physics commands queue is full\n");
+            #endif
+            return false;
+        }
+
+        position = PHYSAC_ATOMIC_LOAD(&commandsTail);
+    }
+}
+
+// Does commands queued by other threads
+static void RunPhysicsCommands(void)
+{
+    if (physicsCommands == NULL)
+        return;
+
+    while (true)
+    {
+        PhysicsCommand *command = &physicsCommands[commandsHead & (PHYSAC_MAX_COMMANDS - 1)];
+
+        if (PHYSAC_ATOMIC_LOAD(&command->sequence) != (commandsHead + 1))
+            break;
+
+        PhysicsBody body = GetPhysicsBodyByHandle(command->handle);
+        queuedHandle = command->handle;
+
+        switch (command->type)
+        {
+            case PHYSICS_COMMAND_CIRCLE: CreatePhysicsBodyCircle(command->vector, command->values[0], command->values[1]); break;
+            case PHYSICS_COMMAND_RECTANGLE: CreatePhysicsBodyRectangle(command->vector, command->values[0], command->values[1], command->values[2]); break;
+            case PHYSICS_COMMAND_POLYGON: CreatePhysicsBodyPolygon(command->vector, command->values[0], (int)command->values[1], command->values[2]); break;
+            case PHYSICS_COMMAND_FORCE: PhysicsAddForce(body, command->vector); break;
+            case PHYSICS_COMMAND_TORQUE: PhysicsAddTorque(body, command->values[0]); break;
+            case PHYSICS_COMMAND_ROTATION: SetPhysicsBodyRotation(body, command->values[0]); break;
+            case PHYSICS_COMMAND_BULLET: if (body != NULL) body->isBullet = (command->values[0] != 0.0f); break;
+            case PHYSICS_COMMAND_DESTROY: DestroyPhysicsBody(body); break;
+            case PHYSICS_COMMAND_GRAVITY: SetPhysicsGravity(command->vector.x, command->vector.y); break;
+            case PHYSICS_COMMAND_SLEEPING: SetPhysicsSleeping(command->values[0] != 0.0f); break;
+            default: break;
+        }
+
+        queuedHandle = PHYSAC_NO_HANDLE;
+
+        // Slot can be written again in next queue lap
+        PHYSAC_ATOMIC_STORE(&command->sequence, commandsHead + PHYSAC_MAX_COMMANDS);
+        commandsHead++;
+    }
+}
+
+// Returns an unused physics body handle
+static PhysicsHandle NewPhysicsHandle(void)
+{
+    PhysicsHandle handle = PHYSAC_ATOMIC_INCREMENT(&physicsHandlesNext);
+
+    // Handles wrapped around, 0 is no body
+    if (handle == PHYSAC_NO_HANDLE)
+        handle = PHYSAC_ATOMIC_INCREMENT(&physicsHandlesNext);
+
+    return handle;
+}
+
+// Adds a physics body to handles hash table
+// NOTE: Entries of destroyed bodies are not removed, table is built again from current bodies when half full
+static void AddPhysicsHandle(unsigned int id)
+{
+    if ((handlesTableCount + 1)*2 > handlesTableSize)
+    {
+        handlesTableSize = 64;
+        while (handlesTableSize < (physicsBodiesCount + 1)*4) handlesTableSize *= 2;
+
+        PHYSAC_FREE(handlesTable);
+        handlesTable = (unsigned int *)PHYSAC_MALLOC(sizeof(unsigned int)*handlesTableSize);
+        memset(handlesTable, 0xFF, sizeof(unsigned int)*handlesTableSize);
+        handlesTableCount = 0;
+
+        for (unsigned int i = 0; i < physicsBodiesCount; i++)
+            AddPhysicsHandle(bodies[i]->id);
+    }
+
+    unsigned int slot = (bodiesHandles[id]*2654435761u) & (handlesTableSize - 1);
+
+    while (handlesTable[slot] != PHYSAC_NO_BODY)
+        slot = (slot + 1) & (handlesTableSize - 1);
+
+    handlesTable[slot] = id;
+    handlesTableCount++;
+}
+
+// Copies bodies state to triple buffer and makes it the last published one
+// NOTE: Previous step state of each body is kept by id, bodies created in last step have no previous state
+static void PublishPhysicsState(double time)
+{
+    PhysicsState *state = &physicsStates[statesBack];
+    unsigned int verticesCount = 0;
+
+    state->stepsCount = stepsCount;
+    state->time = time;
+
+    #if defined(PHYSAC_DETERMINISTIC)
+        state->hash = GetPhysicsHash();
+    #endif
+
+    state->bodiesCount = physicsBodiesCount;
+    state->bodies = (PhysicsBodyState *)GrowArray(state->bodies, &state->bodiesCapacity, physicsBodiesCount, sizeof(PhysicsBodyState));
+
+    // Handles hash table is kept at most half full
+    unsigned int handlesSize = 64;
+    while (handlesSize < physicsBodiesCount*2) handlesSize *= 2;
+
+    if (handlesSize > state->handlesSize)
+    {
+        PHYSAC_FREE(state->handles);
+        state->handles = (unsigned int *)PHYSAC_MALLOC(sizeof(unsigned int)*handlesSize);
+        state->handlesSize = handlesSize;
+    }
+
+    memset(state->handles, 0xFF, sizeof(unsigned int)*state->handlesSize);
+
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
+    {
+        PhysicsBody body = bodies[i];
+        PhysicsBodyState *bodyState = &state->bodies[i];
+        PhysicsBodyState *last = &lastStates[body->id];
+
+        bodyState->handle = bodiesHandles[body->id];
+        bodyState->type = body->shape.type;
+        bodyState->enabled = body->enabled;
+        bodyState->position = body->position;
+        bodyState->orient = body->orient;
+        bodyState->radius = body->shape.radius;
+        bodyState->verticesStart = verticesCount;
+        bodyState->verticesCount = 0;
+
+        if (last->handle == bodyState->handle)
+        {
+            bodyState->previousPosition = last->position;
+            bodyState->previousOrient = last->orient;
+        }
+        else
+        {
+            bodyState->previousPosition = body->position;
+            bodyState->previousOrient = body->orient;
+        }
+
+        *last = *bodyState;
+
+        if (body->shape.type == PHYSICS_POLYGON)
+        {
+            bodyState->verticesCount = body->shape.vertexData.vertexCount;
+            state->vertices = (Vector2 *)GrowArray(state->vertices, &state->verticesCapacity, verticesCount + bodyState->verticesCount, sizeof(Vector2));
+            memcpy(&state->vertices[verticesCount], body->shape.vertexData.positions, sizeof(Vector2)*bodyState->verticesCount);
+            verticesCount += bodyState->verticesCount;
+        }
+
+        unsigned int slot = (bodyState->handle*2654435761u) & (state->handlesSize - 1);
+
+        while (state->handles[slot] != PHYSAC_NO_BODY)
+            slot = (slot + 1) & (state->handlesSize - 1);
+
+        state->handles[slot] = i;
+    }
+
+    statesBack = PHYSAC_ATOMIC_EXCHANGE(&statesMiddle, statesBack | PHYSAC_STATE_FRESH) & ~PHYSAC_STATE_FRESH;
+}
+
+// Physics steps calculations (dynamics, collisions and position corrections)
+static void PhysicsStep(void)
+{
+    // Update current steps count
+    stepsCount++;
+
+    // Keep previous generated collisions information to carry impulses over
+    CachePhysicsContacts();
+
+    // Reset physics bodies grounded state (sleeping bodies keep it) and keep bullets start position
+    bulletsCount = 0;
+
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
+    {
+        PhysicsBody body = bodies[i];
+
+        if (body->isAwake)
+            body->isGrounded = false;
+
+        if (body->isBullet && body->isAwake && body->enabled && (body->inverseMass != 0.0f))
+        {
+            bullets = (unsigned int *)GrowArray(bullets, &bulletsCapacity, bulletsCount + 1, sizeof(unsigned int));
+            bulletsStart = (Vector2 *)GrowArray(bulletsStart, &bulletsStartCapacity, bulletsCount + 1, sizeof(Vector2));
+            bullets[bulletsCount] = i;
+            bulletsStart[bulletsCount] = body->position;
+            bulletsCount++;
+        }
+    }
+
+    // Copy physics bodies hot data to contiguous arrays
+    GatherPhysicsBodies();
+
+    // Find pairs of bodies which can be colliding
+    UpdatePhysicsBounds();
+    FindBroadphasePairs();
+
+    // Generate new collision information
+    // NOTE: Pairs without awake bodies are set aside, so they are only solved if a contact wakes one of their bodies up
+    sleepingPairsCount = 0;
+    physicsBodiesWoken = false;
+    bool manifoldsFull = false;
+
+    for (unsigned int i = 0; (i < broadphasePairsCount) && !manifoldsFull; i++)
+    {
+        unsigned int a = broadphasePairs[i*2];
+        unsigned int b = broadphasePairs[i*2 + 1];
+
+        if ((bodiesData.enabled[a] == 0.0f) && (bodiesData.enabled[b] == 0.0f))
+        {
+            sleepingPairs = (unsigned int *)GrowArray(sleepingPairs, &sleepingPairsCapacity, sleepingPairsCount + 1, sizeof(unsigned int)*2);
+            sleepingPairs[sleepingPairsCount*2] = a;
+            sleepingPairs[sleepingPairsCount*2 + 1] = b;
+            sleepingPairsCount++;
+        }
+        else
+            manifoldsFull = !AddPhysicsContact(a, b);
+    }
+
+    // Solve pairs set aside whose bodies were woken up, until no more bodies wake up
+    while (physicsBodiesWoken && !manifoldsFull)
+    {
+        unsigned int count = 0;
+        physicsBodiesWoken = false;
+
+        for (unsigned int i = 0; (i < sleepingPairsCount) && !manifoldsFull; i++)
+        {
+            unsigned int a = sleepingPairs[i*2];
+            unsigned int b = sleepingPairs[i*2 + 1];
+
+            if ((bodiesData.enabled[a] == 0.0f) && (bodiesData.enabled[b] == 0.0f))
+            {
+                sleepingPairs[count*2] = a;
+                sleepingPairs[count*2 + 1] = b;
+                count++;
+            }
+            else
+                manifoldsFull = !AddPhysicsContact(a, b);
+        }
+
+        sleepingPairsCount = count;
+    }
+
+    // Integrate forces to physics bodies
+    IntegratePhysicsForces();
+
+    // Group manifolds in islands that can be solved in parallel
+    BuildPhysicsIslands();
+
+    // Initialize physics manifolds and integrate physics collisions impulses to solve collisions
+    SolvePhysicsIslands(PHYSICS_JOB_IMPULSES);
+
+    // Integrate velocity to physics bodies
+    IntegratePhysicsVelocity();
+
+    // Correct physics bodies positions based on manifolds collision information
+    SolvePhysicsIslands(PHYSICS_JOB_CORRECTION);
+
+    // Put islands resting long enough to sleep
+    UpdatePhysicsSleeping();
+
+    // Copy physics bodies hot data back to bodies and clear physics bodies forces
+    ScatterPhysicsBodies();
+    queryGridValid = false;
+
+    // Move bullets that went through other bodies back to where they hit them
+    if (bulletsCount > 0)
+        SolvePhysicsBullets();
+}
+
+// Moves bullet bodies back to their first time of impact in last step
+// NOTE: Bullets moving less than their core radius can't go through bodies without overlapping them at step end
+static void SolvePhysicsBullets(void)
+{
+    bool moved = false;
+
+    for (unsigned int i = 0; i < bulletsCount; i++)
+    {
+        PhysicsBody body = bodies[bullets[i]];
+        Vector2 motion = Vector2Subtract(body->position, bulletsStart[i]);
+        float distance = sqrtf(MathLenSqr(motion));
+        float radius = body->shape.radius;
+
+        // Polygons are cast as their inner circle
+        if (body->shape.type == PHYSICS_POLYGON)
+        {
+            radius = PHYSAC_FLT_MAX;
+
+            for (unsigned int j = 0; j < body->shape.vertexData.vertexCount; j++)
+                radius = min(radius, MathDot(body->shape.vertexData.normals[j], body->shape.vertexData.positions[j]));
+        }
+
+        if ((radius <= 0.0f) || (distance < radius))
+            continue;
+
+        PhysicsHit hit = { 0 };
+        Vector2 direction = { motion.x/distance, motion.y/distance };
+
+        // Grid is built again from bodies position at step end the first time
+        if (CastPhysicsCircle(bulletsStart[i], radius, direction, distance, &hit, 1, bullets[i]) > 0)
+        {
+            // Bullet is left slightly overlapping hit body, so next step solves the collision
+            float impact = min(hit.distance + PHYSAC_PENETRATION_ALLOWANCE, distance);
+
+            // Polygon corners reach hit body before its inner circle, find first overlap between start and inner circle impact
+            // NOTE: Bullet rotation at step end is used along all the motion
+            if (body->shape.type == PHYSICS_POLYGON)
+            {
+                float separated = 0.0f;
+
+                for (int j = 0; j < PHYSAC_CCD_ITERATIONS; j++)
+                {
+                    float middle = (separated + impact)*0.5f;
+                    body->position = (Vector2){ bulletsStart[i].x + direction.x*middle, bulletsStart[i].y + direction.y*middle };
+
+                    if (PolygonOverlapsBody(body, hit.body))
+                        impact = middle;
+                    else
+                        separated = middle;
+                }
+            }
+
+            body->position = (Vector2){ bulletsStart[i].x + direction.x*impact, bulletsStart[i].y + direction.y*impact };
+            moved = true;
+        }
+    }
+
+    if (moved)
+        queryGridValid = false;
+}
+
+// Returns true if a polygon shape body overlaps another body shape
+static bool PolygonOverlapsBody(PhysicsBody polygon, PhysicsBody body)
+{
+    int faceIndex = 0;
+
+    if (body->shape.type == PHYSICS_POLYGON)
+        return ((FindAxisLeastPenetration(&faceIndex, &polygon->shape, &body->shape) < 0.0f) && (FindAxisLeastPenetration(&faceIndex, &body->shape, &polygon->shape) < 0.0f));
+
+    // Circle center in polygon model space, find face it is farthest from
+    const PolygonData *data = &polygon->shape.vertexData;
+    Vector2 center = Mat2MultiplyVector2(Mat2Transpose(polygon->shape.transform), Vector2Subtract(body->position, polygon->position));
+    float separation = -PHYSAC_FLT_MAX;
+
+    for (unsigned int i = 0; i < data->vertexCount; i++)
+    {
+        float faceSeparation = MathDot(data->normals[i], Vector2Subtract(center, data->positions[i]));
+
+        if (faceSeparation > separation)
+        {
+            separation = faceSeparation;
+            faceIndex = i;
+        }
+    }
+
+    if (separation > body->shape.radius)
+        return false;
+
+    if (separation <= 0.0f)
+        return true;
+
+    // Circle center is outside face, check face vertices regions
+    Vector2 v1 = data->positions[faceIndex];
+    Vector2 v2 = data->positions[((faceIndex + 1) < (int)data->vertexCount) ? (faceIndex + 1) : 0];
+
+    if (MathDot(Vector2Subtract(center, v1), Vector2Subtract(v2, v1)) < 0.0f)
+        return (DistSqr(center, v1) < body->shape.radius*body->shape.radius);
+
+    if (MathDot(Vector2Subtract(center, v2), Vector2Subtract(v1, v2)) < 0.0f)
+        return (DistSqr(center, v2) < body->shape.radius*body->shape.radius);
+
+    return true;
+}
+
+// Wrapper to ensure PhysicsStep is run with at a fixed time step
+PHYSACDEF void RunPhysicsStep(void)
+{
+    // Calculate current time
+    currentTime = CurrentTime();
+
+    // Calculate current delta time
+    const double delta = currentTime - startTime;
+
+    // Store the time elapsed since the last frame began
+    accumulator += delta;
+
+    // Commands queued by other threads are done before stepping
+    RunPhysicsCommands();
+
+    // Fixed time stepping loop
+    while (accumulator >= deltaTime)
+    {
+        PhysicsStep();
+        accumulator -= deltaTime;
+        PublishPhysicsState(currentTime - accumulator);
+    }
+
+    // Record the starting of this frame
+    startTime = currentTime;
+}
+
+// Runs queued commands and exactly one physics step
+// NOTE: Published state time is current time, so drawing interpolation follows how often it is called
+PHYSACDEF void StepPhysics(void)
+{
+    RunPhysicsCommands();
+    PhysicsStep();
+    PublishPhysicsState(CurrentTime());
+}
+
+// Returns a hash of bodies state after last step (FNV-1a of bodies handle, position, velocity and rotation bits)
+// NOTE: Only equal between builds and platforms if PHYSAC_DETERMINISTIC is defined
+PHYSACDEF unsigned int GetPhysicsHash(void)
+{
+    unsigned int hash = 2166136261u;
+
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
+    {
+        PhysicsBody body = bodies[i];
+        float values[6] = { body->position.x, body->position.y, body->velocity.x, body->velocity.y, body->angularVelocity, body->orient };
+        unsigned int words[8] = { bodiesHandles[body->id], (unsigned int)body->enabled };
+
+        memcpy(&words[2], values, sizeof(values));
+
+        for (int j = 0; j < 8; j++)
+        {
+            for (int k = 0; k < 4; k++)
+                hash = (hash ^ ((words[j] >> (k*8)) & 0xFF))*16777619u;
+        }
+    }
+
+    return hash;
+}
+
+PHYSACDEF void SetPhysicsTimeStep(double delta)
+{
+    deltaTime = delta;
+}
+
+// Creates a new physics manifold to solve collision in manifolds pool next slot
+// NOTE: Manifold is not counted until physicsManifoldsCount is increased, so next created manifold uses the same slot otherwise
+static PhysicsManifold CreatePhysicsManifold(unsigned int a, unsigned int b)
+{
+    if (physicsManifoldsCount >= PHYSAC_MAX_MANIFOLDS)
+    {
+        #if defined(PHYSAC_DEBUG)
+            printf("[PHYSAC] new physics manifold creation failed because manifolds pool is full\n");
+        #endif
+        return NULL;
+    }
+
+    contacts = (PhysicsManifoldData *)GrowArray(contacts, &physicsManifoldsCapacity, physicsManifoldsCount + 1, sizeof(PhysicsManifoldData));
+
+    // Initialize new manifold with generic values
+    PhysicsManifold newManifold = &contacts[physicsManifoldsCount];
+    newManifold->id = physicsManifoldsCount;
+    newManifold->bodyA = bodies[a];
+    newManifold->bodyB = bodies[b];
+    newManifold->indexA = a;
+    newManifold->indexB = b;
+    newManifold->penetration = 0;
+    newManifold->normal = PHYSAC_VECTOR_ZERO;
+    newManifold->contacts[0] = PHYSAC_VECTOR_ZERO;
+    newManifold->contacts[1] = PHYSAC_VECTOR_ZERO;
+    newManifold->contactsCount = 0;
+    newManifold->features[0] = 0;
+    newManifold->features[1] = 0;
+    newManifold->normalImpulses[0] = 0.0f;
+    newManifold->normalImpulses[1] = 0.0f;
+    newManifold->tangentImpulses[0] = 0.0f;
+    newManifold->tangentImpulses[1] = 0.0f;
+    newManifold->velocityBias[0] = 0.0f;
+    newManifold->velocityBias[1] = 0.0f;
+    newManifold->restitution = 0.0f;
+    newManifold->dynamicFriction = 0.0f;
+    newManifold->staticFriction = 0.0f;
+
+    return newManifold;
+}
+
+// Keeps manifold of a pair of bodies if colliding, returns false if manifolds pool is full
+// NOTE: Sleeping bodies touched by an awake enabled body are woken up
+static bool AddPhysicsContact(unsigned int a, unsigned int b)
+{
+    PhysicsManifold manifold = CreatePhysicsManifold(a, b);
+
+    if (manifold == NULL)
+        return false;
+
+    SolvePhysicsManifold(manifold);
+
+    // Keep manifold only if bodies are colliding, otherwise its slot is used by next pair
+    if (manifold->contactsCount > 0)
+    {
+        physicsManifoldsCount++;
+
+        if (warmStarting)
+            ReusePhysicsImpulses(manifold);
+
+        if (!manifold->bodyA->isAwake && (bodiesData.enabled[b] != 0.0f))
+        {
+            PhysicsWakeBody(manifold->bodyA);
+            physicsBodiesWoken = true;
+        }
+        else if (!manifold->bodyB->isAwake && (bodiesData.enabled[a] != 0.0f))
+        {
+            PhysicsWakeBody(manifold->bodyB);
+            physicsBodiesWoken = true;
+        }
+    }
+
+    return true;
+}
+
+// Keeps last step manifolds and indexes them by bodies ids pair
+static void CachePhysicsContacts(void)
+{
+    // Swap manifolds pools, so new manifolds don't overwrite last step ones
+    PhysicsManifoldData *pool = previousContacts;
+    unsigned int capacity = previousManifoldsCapacity;
+
+    previousContacts = contacts;
+    previousManifoldsCount = physicsManifoldsCount;
+    previousManifoldsCapacity = physicsManifoldsCapacity;
+    contacts = pool;
+    physicsManifoldsCount = 0;
+    physicsManifoldsCapacity = capacity;
+
+    // Hash table is kept at most half full
+    unsigned int size = 64;
+
+    while (size < previousManifoldsCount*2)
+        size *= 2;
+
+    if (size > contactsCacheSize)
+    {
+        contactsCache = (unsigned int *)ResizeArray(contactsCache, 0, size, sizeof(unsigned int));
+        contactsCacheSize = size;
+    }
+
+    memset(contactsCache, 0xff, sizeof(unsigned int)*contactsCacheSize);
+
+    for (unsigned int i = 0; i < previousManifoldsCount; i++)
+    {
+        unsigned int slot = ContactsCacheSlot(previousContacts[i].bodyA->id, previousContacts[i].bodyB->id);
+
+        while (contactsCache[slot] != PHYSAC_NO_MANIFOLD)
+            slot = (slot + 1) & (contactsCacheSize - 1);
+
+        contactsCache[slot] = i;
+    }
+}
+
+// Returns first contacts cache slot to look for a bodies ids pair
+static unsigned int ContactsCacheSlot(unsigned int idA, unsigned int idB)
+{
+    return ((idA*73856093u) ^ (idB*19349663u)) & (contactsCacheSize - 1);
+}
+
+// Copies impulses accumulated in previous step by matching contact points
+// NOTE: Bodies pair must be in the same order, contact points must be made by the same shapes features
+static void ReusePhysicsImpulses(PhysicsManifold manifold)
+{
+    unsigned int idA = manifold->bodyA->id;
+    unsigned int idB = manifold->bodyB->id;
+
+    for (unsigned int slot = ContactsCacheSlot(idA, idB); contactsCache[slot] != PHYSAC_NO_MANIFOLD; slot = (slot + 1) & (contactsCacheSize - 1))
+    {
+        PhysicsManifold previous = &previousContacts[contactsCache[slot]];
+
+        if ((previous->bodyA->id != idA) || (previous->bodyB->id != idB))
+            continue;
+
+        for (unsigned int i = 0; i < manifold->contactsCount; i++)
+        {
+            for (unsigned int j = 0; j < previous->contactsCount; j++)
+            {
+                if (manifold->features[i] == previous->features[j])
+                {
+                    manifold->normalImpulses[i] = previous->normalImpulses[j];
+                    manifold->tangentImpulses[i] = previous->tangentImpulses[j];
+                }
+            }
+        }
+
+        return;
+    }
+}
+
+// Solves a created physics manifold between two physics bodies
+static void SolvePhysicsManifold(PhysicsManifold manifold)
+{
+    switch (manifold->bodyA->shape.type)
+    {
+        case PHYSICS_CIRCLE:
+        {
+            switch (manifold->bodyB->shape.type)
+            {
+                case PHYSICS_CIRCLE: SolveCircleToCircle(manifold); break;
+                case PHYSICS_POLYGON: SolveCircleToPolygon(manifold); break;
+                default: break;
+            }
+        } break;
+        case PHYSICS_POLYGON:
+        {
+            switch (manifold->bodyB->shape.type)
+            {
+                case PHYSICS_CIRCLE: SolvePolygonToCircle(manifold); break;
+                case PHYSICS_POLYGON: SolvePolygonToPolygon(manifold); break;
+                default: break;
+            }
+        } break;
+        default: break;
+    }
+
+    // Update physics body grounded state if normal direction is down and grounded state is not set yet in previous manifolds
+    if (!manifold->bodyB->isGrounded)
+        manifold->bodyB->isGrounded = (manifold->normal.y < 0);
+}
+
+// Solves collision between two circle shape physics bodies
+static void SolveCircleToCircle(PhysicsManifold manifold)
+{
+    PhysicsBody bodyA = manifold->bodyA;
+    PhysicsBody bodyB = manifold->bodyB;
+
+    if ((bodyA == NULL) || (bodyB == NULL))
+        return;
+
+    // Calculate translational vector, which is normal
+    Vector2 normal = Vector2Subtract(bodyB->position, bodyA->position);
+
+    float distSqr = MathLenSqr(normal);
+    float radius = bodyA->shape.radius + bodyB->shape.radius;
+
+    // Check if circles are not in contact
+    if (distSqr >= radius*radius)
+    {
+        manifold->contactsCount = 0;
+        return;
+    }
+
+    float distance = sqrtf(distSqr);
+    manifold->contactsCount = 1;
+    manifold->features[0] = 0;
+
+    if (distance == 0.0f)
+    {
+        manifold->penetration = bodyA->shape.radius;
+        manifold->normal = (Vector2){ 1.0f, 0.0f };
+        manifold->contacts[0] = bodyA->position;
+    }
+    else
+    {
+        manifold->penetration = radius - distance;
+        manifold->normal = (Vector2){ normal.x/distance, normal.y/distance }; // Faster than using MathNormalize() due to sqrt is already performed
+        manifold->contacts[0] = (Vector2){ manifold->normal.x*bodyA->shape.radius + bodyA->position.x, manifold->normal.y*bodyA->shape.radius + bodyA->position.y };
+    }
+
+    // Update physics body grounded state if normal direction is down
+    if (!bodyA->isGrounded)
+        bodyA->isGrounded = (manifold->normal.y < 0);
+}
+
+// Solves collision between a circle to a polygon shape physics bodies
+static void SolveCircleToPolygon(PhysicsManifold manifold)
+{
+    PhysicsBody bodyA = manifold->bodyA;
+    PhysicsBody bodyB = manifold->bodyB;
+
+    if ((bodyA == NULL) || (bodyB == NULL))
+        return;
+
+    SolveDifferentShapes(manifold, bodyA, bodyB);
+}
+
+// Solves collision between a circle to a polygon shape physics bodies
+static void SolvePolygonToCircle(PhysicsManifold manifold)
+{
+    PhysicsBody bodyA = manifold->bodyA;
+    PhysicsBody bodyB = manifold->bodyB;
+
+    if ((bodyA == NULL) || (bodyB == NULL))
+        return;
+
+    SolveDifferentShapes(manifold, bodyB, bodyA);
+    
+    manifold->normal.x *= -1.0f;
+    manifold->normal.y *= -1.0f;
+}
+
+// Solve collision between two different types of shapes
+static void SolveDifferentShapes(PhysicsManifold manifold, PhysicsBody bodyA, PhysicsBody bodyB)
+{
+    manifold->contactsCount = 0;
+
+    // Transform circle center to polygon transform space
+    Vector2 center = bodyA->position;
+    center = Mat2MultiplyVector2(Mat2Transpose(bodyB->shape.transform), Vector2Subtract(center, bodyB->position));
+
+    // Find edge with minimum penetration
+    // It is the same concept as using support points in SolvePolygonToPolygon
+    float separation = -PHYSAC_FLT_MAX;
+    int faceNormal = 0;
+    PolygonData vertexData = bodyB->shape.vertexData;
+
+    for (unsigned int i = 0; i < vertexData.vertexCount; i++)
+    {
+        float currentSeparation = MathDot(vertexData.normals[i], Vector2Subtract(center, vertexData.positions[i]));
+
+        if (currentSeparation > bodyA->shape.radius)
+            return;
+
+        if (currentSeparation > separation)
+        {
+            separation = currentSeparation;
+            faceNormal = i;
+        }
+    }
+
+    // Grab face's vertices
+    Vector2 v1 = vertexData.positions[faceNormal];
+    int nextIndex = (((faceNormal + 1) < (int)vertexData.vertexCount) ? (faceNormal + 1) : 0);
+    Vector2 v2 = vertexData.positions[nextIndex];
+
+    // Check to see if center is within polygon
+    if (separation < PHYSAC_EPSILON)
+    {
+        manifold->contactsCount = 1;
+        manifold->features[0] = faceNormal*3;
+        Vector2 normal = Mat2MultiplyVector2(bodyB->shape.transform, vertexData.normals[faceNormal]);
+        manifold->normal = (Vector2){ -normal.x, -normal.y };
+        manifold->contacts[0] = (Vector2){ manifold->normal.x*bodyA->shape.radius + bodyA->position.x, manifold->normal.y*bodyA->shape.radius + bodyA->position.y };
+        manifold->penetration = bodyA->shape.radius;
+        return;
+    }
+
+    // Determine which voronoi region of the edge center of circle lies within
+    float dot1 = MathDot(Vector2Subtract(center, v1), Vector2Subtract(v2, v1));
+    float dot2 = MathDot(Vector2Subtract(center, v2), Vector2Subtract(v1, v2));
+    manifold->penetration = bodyA->shape.radius - separation;
+
+    if (dot1 <= 0.0f) // Closest to v1
+    {
+        if (DistSqr(center, v1) > bodyA->shape.radius*bodyA->shape.radius)
+            return;
+
+        manifold->contactsCount = 1;
+        manifold->features[0] = faceNormal*3 + 1;
+        Vector2 normal = Vector2Subtract(v1, center);
+        normal = Mat2MultiplyVector2(bodyB->shape.transform, normal);
+        MathNormalize(&normal);
+        manifold->normal = normal;
+        v1 = Mat2MultiplyVector2(bodyB->shape.transform, v1);
+        v1 = Vector2Add(v1, bodyB->position);
+        manifold->contacts[0] = v1;
+    }
+    else if (dot2 <= 0.0f) // Closest to v2
+    {
+        if (DistSqr(center, v2) > bodyA->shape.radius*bodyA->shape.radius)
+            return;
+
+        manifold->contactsCount = 1;
+        manifold->features[0] = faceNormal*3 + 2;
+        Vector2 normal = Vector2Subtract(v2, center);
+        v2 = Mat2MultiplyVector2(bodyB->shape.transform, v2);
+        v2 = Vector2Add(v2, bodyB->position);
+        manifold->contacts[0] = v2;
+        normal = Mat2MultiplyVector2(bodyB->shape.transform, normal);
+        MathNormalize(&normal);
+        manifold->normal = normal;
+    }
+    else // Closest to face
+    {
+        Vector2 normal = vertexData.normals[faceNormal];
+
+        if (MathDot(Vector2Subtract(center, v1), normal) > bodyA->shape.radius)
+            return;
+
+        normal = Mat2MultiplyVector2(bodyB->shape.transform, normal);
+        manifold->normal = (Vector2){ -normal.x, -normal.y };
+        manifold->contacts[0] = (Vector2){ manifold->normal.x*bodyA->shape.radius + bodyA->position.x, manifold->normal.y*bodyA->shape.radius + bodyA->position.y };
+        manifold->contactsCount = 1;
+        manifold->features[0] = faceNormal*3;
+    }
+}
+
+// Solves collision between two polygons shape physics bodies
+static void SolvePolygonToPolygon(PhysicsManifold manifold)
+{
+    if ((manifold->bodyA == NULL) || (manifold->bodyB == NULL))
+        return;
+
+    PhysicsShape bodyA = manifold->bodyA->shape;
+    PhysicsShape bodyB = manifold->bodyB->shape;
+    manifold->contactsCount = 0;
+
+    // Check for separating axis with A shape's face planes
+    int faceA = 0;
+    float penetrationA = FindAxisLeastPenetration(&faceA, &manifold->bodyA->shape, &manifold->bodyB->shape);
+    
+    if (penetrationA >= 0.0f)
+        return;
+
+    // Check for separating axis with B shape's face planes
+    int faceB = 0;
+    float penetrationB = FindAxisLeastPenetration(&faceB, &manifold->bodyB->shape, &manifold->bodyA->shape);
+    
+    if (penetrationB >= 0.0f)
+        return;
+
+    int referenceIndex = 0;
+    bool flip = false;  // Always point from A shape to B shape
+
+    PhysicsShape refPoly; // Reference
+    PhysicsShape incPoly; // Incident
+
+    // Determine which shape contains reference face
+    if (BiasGreaterThan(penetrationA, penetrationB))
+    {
+        refPoly = bodyA;
+        incPoly = bodyB;
+        referenceIndex = faceA;
+    }
+    else
+    {
+        refPoly = bodyB;
+        incPoly = bodyA;
+        referenceIndex = faceB;
+        flip = true;
+    }
+
+    // World space incident face
+    Vector2 incidentFace[2];
+    int incidentIndex = FindIncidentFace(&incidentFace[0], &incidentFace[1], refPoly, incPoly, referenceIndex);
+
+    // Contact points are identified by reference face, incident face and clipped incident face point
+    unsigned int feature = ((referenceIndex*PHYSAC_MAX_VERTICES + incidentIndex)*2 + (flip ? 1 : 0))*2;
+
+    // Setup reference face vertices
+    PolygonData refData = refPoly.vertexData;
+    Vector2 v1 = refData.positions[referenceIndex];
+    referenceIndex = (((referenceIndex + 1) < (int)refData.vertexCount) ? (referenceIndex + 1) : 0);
+    Vector2 v2 = refData.positions[referenceIndex];
+
+    // Transform vertices to world space
+    v1 = Mat2MultiplyVector2(refPoly.transform, v1);
+    v1 = Vector2Add(v1, refPoly.body->position);
+    v2 = Mat2MultiplyVector2(refPoly.transform, v2);
+    v2 = Vector2Add(v2, refPoly.body->position);
+
+    // Calculate reference face side normal in world space
+    Vector2 sidePlaneNormal = Vector2Subtract(v2, v1);
+    MathNormalize(&sidePlaneNormal);
+
+    // Orthogonalize
+    Vector2 refFaceNormal = { sidePlaneNormal.y, -sidePlaneNormal.x };
+    float refC = MathDot(refFaceNormal, v1);
+    float negSide = MathDot(sidePlaneNormal, v1)*-1;
+    float posSide = MathDot(sidePlaneNormal, v2);
+
+    // Clip incident face to reference face side planes (due to floating point error, possible to not have required points
+    if (Clip((Vector2){ -sidePlaneNormal.x, -sidePlaneNormal.y }, negSide, &incidentFace[0], &incidentFace[1]) < 2)
+        return;
+
+    if (Clip(sidePlaneNormal, posSide, &incidentFace[0], &incidentFace[1]) < 2)
+        return;
+
+    // Flip normal if required
+    manifold->normal = (flip ? (Vector2){ -refFaceNormal.x, -refFaceNormal.y } : refFaceNormal);
+
+    // Keep points behind reference face
+    int currentPoint = 0; // Clipped points behind reference face
+    float separation = MathDot(refFaceNormal, incidentFace[0]) - refC;
+    
+    if (separation <= 0.0f)
+    {
+        manifold->contacts[currentPoint] = incidentFace[0];
+        manifold->features[currentPoint] = feature;
+        manifold->penetration = -separation;
+        currentPoint++;
+    }
+    else
+        manifold->penetration = 0.0f;
+
+    separation = MathDot(refFaceNormal, incidentFace[1]) - refC;
+
+    if (separation <= 0.0f)
+    {
+        manifold->contacts[currentPoint] = incidentFace[1];
+        manifold->features[currentPoint] = feature + 1;
+        manifold->penetration += -separation;
+        currentPoint++;
+
+        // Calculate total penetration average
+        manifold->penetration /= currentPoint;
+    }
+
+    manifold->contactsCount = currentPoint;
+}
+
+// Integrates physics forces into velocity
+static void IntegratePhysicsForces(void)
+{
+    const float halfStep = (float)(deltaTime/2.0);
+    const float gravityX = (float)(gravityForce.x*(deltaTime/1000/2.0));
+    const float gravityY = (float)(gravityForce.y*(deltaTime/1000/2.0));
+    int start = 0;
+
+    // Integrate as many bodies as possible with SIMD kernels, remaining bodies one at a time
+    switch (physicsSimd)
+    {
+    #if defined(PHYSAC_SIMD_AVX2)
+        case PHYSICS_SIMD_AVX2: start = IntegrateForcesAVX2(halfStep, gravityX, gravityY); break;
+    #endif
+    #if defined(PHYSAC_SIMD_SSE2)
+        case PHYSICS_SIMD_SSE2: start = IntegrateForcesSSE2(halfStep, gravityX, gravityY); break;
+    #endif
+        default: break;
+    }
+
+    IntegrateForcesScalar(start, halfStep, gravityX, gravityY);
+}
+
+// Initializes physics manifolds to solve collisions
+static void InitializePhysicsManifolds(PhysicsManifold manifold)
+{
+    PhysicsBody bodyA = manifold->bodyA;
+    PhysicsBody bodyB = manifold->bodyB;
+    unsigned int a = manifold->indexA;
+    unsigned int b = manifold->indexB;
+
+    // Calculate average restitution, static and dynamic friction
+    manifold->restitution = sqrtf(bodyA->restitution*bodyB->restitution);
+    manifold->staticFriction = sqrtf(bodyA->staticFriction*bodyB->staticFriction);
+    manifold->dynamicFriction = sqrtf(bodyA->dynamicFriction*bodyB->dynamicFriction);
+
+    Vector2 radiusA[2] = { 0 };
+    Vector2 radiusB[2] = { 0 };
+    float contactVelocity[2] = { 0 };
+
+    for (unsigned int i = 0; i < manifold->contactsCount; i++)
+    {
+        // Caculate radius from center of mass to contact
+        radiusA[i] = (Vector2){ manifold->contacts[i].x - bodiesData.positionX[a], manifold->contacts[i].y - bodiesData.positionY[a] };
+        radiusB[i] = (Vector2){ manifold->contacts[i].x - bodiesData.positionX[b], manifold->contacts[i].y - bodiesData.positionY[b] };
+
+        Vector2 crossA = MathCross(bodiesData.angularVelocity[a], radiusA[i]);
+        Vector2 crossB = MathCross(bodiesData.angularVelocity[b], radiusB[i]);
+
+        Vector2 radiusV = { 0.0f, 0.0f };
+        radiusV.x = bodiesData.velocityX[b] + crossB.x - bodiesData.velocityX[a] - crossA.x;
+        radiusV.y = bodiesData.velocityY[b] + crossB.y - bodiesData.velocityY[a] - crossA.y;
+        contactVelocity[i] = MathDot(radiusV, manifold->normal);
+
+        // Determine if we should perform a resting collision or not;
+        // The idea is if the only thing moving this object is gravity, then the collision should be performed without any restitution
+        if (MathLenSqr(radiusV) < (MathLenSqr((Vector2){ gravityForce.x*deltaTime/1000, gravityForce.y*deltaTime/1000 }) + PHYSAC_EPSILON))
+            manifold->restitution = 0;
+    }
+
+    Vector2 tangent = { manifold->normal.y, -manifold->normal.x };
+
+    for (unsigned int i = 0; i < manifold->contactsCount; i++)
+    {
+        // Approaching contact points must bounce back with restitution
+        manifold->velocityBias[i] = ((contactVelocity[i] < 0.0f) ? -manifold->restitution*contactVelocity[i] : 0.0f);
+
+        // Apply impulses accumulated in previous step (zero if warm starting is disabled or contact point is new)
+        Vector2 impulse = { manifold->normal.x*manifold->normalImpulses[i] + tangent.x*manifold->tangentImpulses[i],
+                            manifold->normal.y*manifold->normalImpulses[i] + tangent.y*manifold->tangentImpulses[i] };
+        ApplyPhysicsImpulse(a, b, radiusA[i], radiusB[i], impulse);
+    }
+}
+
+// Integrates physics collisions impulses to solve collisions
+// NOTE: Impulses are accumulated by each contact point, only their change is applied to bodies
+static void IntegratePhysicsImpulses(PhysicsManifold manifold)
+{
+    unsigned int a = manifold->indexA;
+    unsigned int b = manifold->indexB;
+
+    float *velocityX = bodiesData.velocityX;
+    float *velocityY = bodiesData.velocityY;
+    float *angularVelocity = bodiesData.angularVelocity;
+    const float inverseMassA = bodiesData.inverseMass[a];
+    const float inverseMassB = bodiesData.inverseMass[b];
+    const float inverseInertiaA = bodiesData.inverseInertia[a];
+    const float inverseInertiaB = bodiesData.inverseInertia[b];
+
+    // Early out and positional correct if both objects have infinite mass
+    if (fabs(inverseMassA + inverseMassB) <= PHYSAC_EPSILON)
+    {
+        velocityX[a] = 0.0f;
+        velocityY[a] = 0.0f;
+        velocityX[b] = 0.0f;
+        velocityY[b] = 0.0f;
+        return;
+    }
+
+    Vector2 normal = manifold->normal;
+    Vector2 tangent = { normal.y, -normal.x };
+
+    for (unsigned int i = 0; i < manifold->contactsCount; i++)
+    {
+        // Calculate radius from center of mass to contact
+        Vector2 radiusA = { manifold->contacts[i].x - bodiesData.positionX[a], manifold->contacts[i].y - bodiesData.positionY[a] };
+        Vector2 radiusB = { manifold->contacts[i].x - bodiesData.positionX[b], manifold->contacts[i].y - bodiesData.positionY[b] };
+
+        // Calculate relative velocity
+        Vector2 radiusV = { 0.0f, 0.0f };
+        radiusV.x = velocityX[b] + MathCross(angularVelocity[b], radiusB).x - velocityX[a] - MathCross(angularVelocity[a], radiusA).x;
+        radiusV.y = velocityY[b] + MathCross(angularVelocity[b], radiusB).y - velocityY[a] - MathCross(angularVelocity[a], radiusA).y;
+
+        float raCrossN = MathCrossVector2(radiusA, normal);
+        float rbCrossN = MathCrossVector2(radiusB, normal);
+        float inverseMassSum = inverseMassA + inverseMassB + (raCrossN*raCrossN)*inverseInertiaA + (rbCrossN*rbCrossN)*inverseInertiaB;
+
+        // Calculate impulse scalar value, accumulated impulse can only push bodies apart
+        float impulse = -(MathDot(radiusV, normal) - manifold->velocityBias[i])/inverseMassSum;
+        float accumulated = max(manifold->normalImpulses[i] + impulse, 0.0f);
+        impulse = accumulated - manifold->normalImpulses[i];
+        manifold->normalImpulses[i] = accumulated;
+
+        // Apply impulse to each physics body
+        ApplyPhysicsImpulse(a, b, radiusA, radiusB, (Vector2){ normal.x*impulse, normal.y*impulse });
+
+        // Calculate relative velocity after normal impulse
+        radiusV.x = velocityX[b] + MathCross(angularVelocity[b], radiusB).x - velocityX[a] - MathCross(angularVelocity[a], radiusA).x;
+        radiusV.y = velocityY[b] + MathCross(angularVelocity[b], radiusB).y - velocityY[a] - MathCross(angularVelocity[a], radiusA).y;
+
+        float raCrossT = MathCrossVector2(radiusA, tangent);
+        float rbCrossT = MathCrossVector2(radiusB, tangent);
+        float inverseMassSumTangent = inverseMassA + inverseMassB + (raCrossT*raCrossT)*inverseInertiaA + (rbCrossT*rbCrossT)*inverseInertiaB;
+
+        // Calculate impulse tangent magnitude
+        float impulseTangent = -MathDot(radiusV, tangent)/inverseMassSumTangent;
+
+        // Apply coulumb's law, accumulated impulse keeps static friction while it is small enough, dynamic friction otherwise
+        accumulated = manifold->tangentImpulses[i] + impulseTangent;
+
+        if (fabs(accumulated) > manifold->normalImpulses[i]*manifold->staticFriction)
+        {
+            float maxFriction = manifold->normalImpulses[i]*manifold->dynamicFriction;
+            accumulated = min(max(accumulated, -maxFriction), maxFriction);
+        }
+
+        impulseTangent = accumulated - manifold->tangentImpulses[i];
+        manifold->tangentImpulses[i] = accumulated;
+
+        // Apply friction impulse
+        ApplyPhysicsImpulse(a, b, radiusA, radiusB, (Vector2){ tangent.x*impulseTangent, tangent.y*impulseTangent });
+    }
+}
+
+// Applies an impulse from body a to body b at a contact point
+static void ApplyPhysicsImpulse(unsigned int a, unsigned int b, Vector2 radiusA, Vector2 radiusB, Vector2 impulse)
+{
+    if (bodiesData.enabled[a] != 0.0f)
+    {
+        bodiesData.velocityX[a] += bodiesData.inverseMass[a]*(-impulse.x);
+        bodiesData.velocityY[a] += bodiesData.inverseMass[a]*(-impulse.y);
+
+        if (bodiesData.rotation[a] != 0.0f)
+            bodiesData.angularVelocity[a] += bodiesData.inverseInertia[a]*MathCrossVector2(radiusA, (Vector2){ -impulse.x, -impulse.y });
+    }
+
+    if (bodiesData.enabled[b] != 0.0f)
+    {
+        bodiesData.velocityX[b] += bodiesData.inverseMass[b]*(impulse.x);
+        bodiesData.velocityY[b] += bodiesData.inverseMass[b]*(impulse.y);
+
+        if (bodiesData.rotation[b] != 0.0f)
+            bodiesData.angularVelocity[b] += bodiesData.inverseInertia[b]*MathCrossVector2(radiusB, impulse);
+    }
+}
+
+// Integrates physics velocity into position and forces
+static void IntegratePhysicsVelocity(void)
+{
+    const float step = (float)deltaTime;
+    int start = 0;
+
+    // Integrate as many bodies as possible with SIMD kernels, remaining bodies one at a time
+    switch (physicsSimd)
+    {
+    #if defined(PHYSAC_SIMD_AVX2)
+        case PHYSICS_SIMD_AVX2: start = IntegrateVelocityAVX2(step); break;
+    #endif
+    #if defined(PHYSAC_SIMD_SSE2)
+        case PHYSICS_SIMD_SSE2: start = IntegrateVelocitySSE2(step); break;
+    #endif
+        default: break;
+    }
+
+    IntegrateVelocityScalar(start, step);
+
+    IntegratePhysicsForces();
+}
+
+// Integrates bodies forces from start index, one body at a time
+// NOTE: SIMD kernels must do the same operations in the same order, so results don't depend on the kernel used
+// (implementation isn't fused into FMA while they are compiled, see PHYSAC_NO_FP_CONTRACT)
+static void IntegrateForcesScalar(int start, float halfStep, float gravityX, float gravityY)
+{
+    float *velocityX = bodiesData.velocityX;
+    float *velocityY = bodiesData.velocityY;
+    float *angularVelocity = bodiesData.angularVelocity;
+    const float *forceX = bodiesData.forceX;
+    const float *forceY = bodiesData.forceY;
+    const float *torque = bodiesData.torque;
+    const float *inverseMass = bodiesData.inverseMass;
+    const float *inverseInertia = bodiesData.inverseInertia;
+    const float *dynamic = bodiesData.dynamic;
+    const float *useGravity = bodiesData.useGravity;
+    const float *rotation = bodiesData.rotation;
+
+    // NOTE: Each loop writes a single array, so compilers can vectorize them without many aliasing checks
+    for (unsigned int i = start; i < physicsBodiesCount; i++)
+        velocityX[i] += (forceX[i]*inverseMass[i]*halfStep + gravityX*useGravity[i])*dynamic[i];
+
+    for (unsigned int i = start; i < physicsBodiesCount; i++)
+        velocityY[i] += (forceY[i]*inverseMass[i]*halfStep + gravityY*useGravity[i])*dynamic[i];
+
+    for (unsigned int i = start; i < physicsBodiesCount; i++)
+        angularVelocity[i] += torque[i]*inverseInertia[i]*halfStep*dynamic[i]*rotation[i];
+}
+
+// Integrates bodies velocity from start index, one body at a time
+static void IntegrateVelocityScalar(int start, float step)
+{
+    float *positionX = bodiesData.positionX;
+    float *positionY = bodiesData.positionY;
+    float *orient = bodiesData.orient;
+    const float *velocityX = bodiesData.velocityX;
+    const float *velocityY = bodiesData.velocityY;
+    const float *angularVelocity = bodiesData.angularVelocity;
+    const float *enabled = bodiesData.enabled;
+    const float *rotation = bodiesData.rotation;
+
+    for (unsigned int i = start; i < physicsBodiesCount; i++)
+        positionX[i] += velocityX[i]*step*enabled[i];
+
+    for (unsigned int i = start; i < physicsBodiesCount; i++)
+        positionY[i] += velocityY[i]*step*enabled[i];
+
+    for (unsigned int i = start; i < physicsBodiesCount; i++)
+        orient[i] += angularVelocity[i]*step*enabled[i]*rotation[i];
+}
+
+#if defined(PHYSAC_SIMD_SSE2)
+// Integrates bodies forces 4 at a time, returns bodies integrated
+static int IntegrateForcesSSE2(float halfStep, float gravityX, float gravityY)
+{
+    const int count = physicsBodiesCount & ~3;
+    const __m128 step = _mm_set1_ps(halfStep);
+    const __m128 gravityStepX = _mm_set1_ps(gravityX);
+    const __m128 gravityStepY = _mm_set1_ps(gravityY);
+
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128 inverseMass = _mm_loadu_ps(&bodiesData.inverseMass[i]);
+        __m128 dynamic = _mm_loadu_ps(&bodiesData.dynamic[i]);
+        __m128 useGravity = _mm_loadu_ps(&bodiesData.useGravity[i]);
+
+        __m128 accelerationX = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&bodiesData.forceX[i]), inverseMass), step), _mm_mul_ps(gravityStepX, useGravity));
+        __m128 accelerationY = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&bodiesData.forceY[i]), inverseMass), step), _mm_mul_ps(gravityStepY, useGravity));
+        __m128 angularAcceleration = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&bodiesData.torque[i]), _mm_loadu_ps(&bodiesData.inverseInertia[i])), step), dynamic);
+
+        _mm_storeu_ps(&bodiesData.velocityX[i], _mm_add_ps(_mm_loadu_ps(&bodiesData.velocityX[i]), _mm_mul_ps(accelerationX, dynamic)));
+        _mm_storeu_ps(&bodiesData.velocityY[i], _mm_add_ps(_mm_loadu_ps(&bodiesData.velocityY[i]), _mm_mul_ps(accelerationY, dynamic)));
+        _mm_storeu_ps(&bodiesData.angularVelocity[i], _mm_add_ps(_mm_loadu_ps(&bodiesData.angularVelocity[i]), _mm_mul_ps(angularAcceleration, _mm_loadu_ps(&bodiesData.rotation[i]))));
+    }
+
+    return count;
+}
+
+// Integrates bodies velocity 4 at a time, returns bodies integrated
+static int IntegrateVelocitySSE2(float step)
+{
+    const int count = physicsBodiesCount & ~3;
+    const __m128 stepV = _mm_set1_ps(step);
+
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128 enabled = _mm_loadu_ps(&bodiesData.enabled[i]);
+        __m128 angularStep = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&bodiesData.angularVelocity[i]), stepV), enabled), _mm_loadu_ps(&bodiesData.rotation[i]));
+
+        _mm_storeu_ps(&bodiesData.positionX[i], _mm_add_ps(_mm_loadu_ps(&bodiesData.positionX[i]), _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&bodiesData.velocityX[i]), stepV), enabled)));
+        _mm_storeu_ps(&bodiesData.positionY[i], _mm_add_ps(_mm_loadu_ps(&bodiesData.positionY[i]), _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&bodiesData.velocityY[i]), stepV), enabled)));
+        _mm_storeu_ps(&bodiesData.orient[i], _mm_add_ps(_mm_loadu_ps(&bodiesData.orient[i]), angularStep));
+    }
+
+    return count;
+}
+#endif
+
+#if defined(PHYSAC_SIMD_AVX2)
+// Integrates bodies forces 8 at a time, returns bodies integrated
+PHYSAC_TARGET_AVX2 static int IntegrateForcesAVX2(float halfStep, float gravityX, float gravityY)
+{
+    const int count = physicsBodiesCount & ~7;
+    const __m256 step = _mm256_set1_ps(halfStep);
+    const __m256 gravityStepX = _mm256_set1_ps(gravityX);
+    const __m256 gravityStepY = _mm256_set1_ps(gravityY);
+
+    for (int i = 0; i < count; i += 8)
+    {
+        __m256 inverseMass = _mm256_loadu_ps(&bodiesData.inverseMass[i]);
+        __m256 dynamic = _mm256_loadu_ps(&bodiesData.dynamic[i]);
+        __m256 useGravity = _mm256_loadu_ps(&bodiesData.useGravity[i]);
+
+        __m256 accelerationX = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(&bodiesData.forceX[i]), inverseMass), step), _mm256_mul_ps(gravityStepX, useGravity));
+        __m256 accelerationY = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(&bodiesData.forceY[i]), inverseMass), step), _mm256_mul_ps(gravityStepY, useGravity));
+        __m256 angularAcceleration = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(&bodiesData.torque[i]), _mm256_loadu_ps(&bodiesData.inverseInertia[i])), step), dynamic);
+
+        _mm256_storeu_ps(&bodiesData.velocityX[i], _mm256_add_ps(_mm256_loadu_ps(&bodiesData.velocityX[i]), _mm256_mul_ps(accelerationX, dynamic)));
+        _mm256_storeu_ps(&bodiesData.velocityY[i], _mm256_add_ps(_mm256_loadu_ps(&bodiesData.velocityY[i]), _mm256_mul_ps(accelerationY, dynamic)));
+        _mm256_storeu_ps(&bodiesData.angularVelocity[i], _mm256_add_ps(_mm256_loadu_ps(&bodiesData.angularVelocity[i]), _mm256_mul_ps(angularAcceleration, _mm256_loadu_ps(&bodiesData.rotation[i]))));
+    }
+
+    return count;
+}
+
+// Integrates bodies velocity 8 at a time, returns bodies integrated
+PHYSAC_TARGET_AVX2 static int IntegrateVelocityAVX2(float step)
+{
+    const int count = physicsBodiesCount & ~7;
+    const __m256 stepV = _mm256_set1_ps(step);
+
+    for (int i = 0; i < count; i += 8)
+    {
+        __m256 enabled = _mm256_loadu_ps(&bodiesData.enabled[i]);
+        __m256 angularStep = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(&bodiesData.angularVelocity[i]), stepV), enabled), _mm256_loadu_ps(&bodiesData.rotation[i]));
+
+        _mm256_storeu_ps(&bodiesData.positionX[i], _mm256_add_ps(_mm256_loadu_ps(&bodiesData.positionX[i]), _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(&bodiesData.velocityX[i]), stepV), enabled)));
+        _mm256_storeu_ps(&bodiesData.positionY[i], _mm256_add_ps(_mm256_loadu_ps(&bodiesData.positionY[i]), _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(&bodiesData.velocityY[i]), stepV), enabled)));
+        _mm256_storeu_ps(&bodiesData.orient[i], _mm256_add_ps(_mm256_loadu_ps(&bodiesData.orient[i]), angularStep));
+    }
+
+    return count;
+}
+#endif
+
+// Corrects physics bodies positions based on manifolds collision information
+static void CorrectPhysicsPositions(PhysicsManifold manifold)
+{
+    unsigned int a = manifold->indexA;
+    unsigned int b = manifold->indexB;
+    const float inverseMassA = bodiesData.inverseMass[a];
+    const float inverseMassB = bodiesData.inverseMass[b];
+
+    Vector2 correction = { 0.0f, 0.0f };
+    correction.x = (max(manifold->penetration - PHYSAC_PENETRATION_ALLOWANCE, 0.0f)/(inverseMassA + inverseMassB))*manifold->normal.x*PHYSAC_PENETRATION_CORRECTION;
+    correction.y = (max(manifold->penetration - PHYSAC_PENETRATION_ALLOWANCE, 0.0f)/(inverseMassA + inverseMassB))*manifold->normal.y*PHYSAC_PENETRATION_CORRECTION;
+
+    if (bodiesData.enabled[a] != 0.0f)
+    {
+        bodiesData.positionX[a] -= correction.x*inverseMassA;
+        bodiesData.positionY[a] -= correction.y*inverseMassA;
+    }
+
+    if (bodiesData.enabled[b] != 0.0f)
+    {
+        bodiesData.positionX[b] += correction.x*inverseMassB;
+        bodiesData.positionY[b] += correction.y*inverseMassB;
+    }
+}
+
+// Groups manifolds in islands that share no dynamic bodies
+// NOTE: Islands are numbered in order of their first manifold, so they don't depend on threads count
+static void BuildPhysicsIslands(void)
+{
+    // Every body starts in its own island
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
+    {
+        islandParent[i] = i;
+        islandIds[i] = PHYSAC_NO_ISLAND;
+    }
+
+    // Join islands of bodies written when solving the same manifold
+    // NOTE: Disabled bodies are only read, so bodies resting on the same ground don't share island,
+    // unless both bodies have infinite mass (manifold clears both bodies velocity)
+    for (unsigned int i = 0; i < physicsManifoldsCount; i++)
+    {
+        unsigned int a = contacts[i].indexA;
+        unsigned int b = contacts[i].indexB;
+
+        if (((bodiesData.enabled[a] != 0.0f) && (bodiesData.enabled[b] != 0.0f)) || (fabs(bodiesData.inverseMass[a] + bodiesData.inverseMass[b]) <= PHYSAC_EPSILON))
+        {
+            unsigned int rootA = FindIslandRoot(a);
+            unsigned int rootB = FindIslandRoot(b);
+
+            if (rootA < rootB)
+                islandParent[rootB] = rootA;
+            else
+                islandParent[rootA] = rootB;
+        }
+    }
+
+    islands = (PhysicsIsland *)GrowArray(islands, &islandsCapacity, physicsManifoldsCount, sizeof(PhysicsIsland));
+    islandManifolds = (unsigned int *)GrowArray(islandManifolds, &islandManifoldsCapacity, physicsManifoldsCount, sizeof(unsigned int));
+    islandsCount = 0;
+
+    // Count manifolds of each island
+    for (unsigned int i = 0; i < physicsManifoldsCount; i++)
+    {
+        unsigned int root = FindIslandRoot((bodiesData.enabled[contacts[i].indexA] != 0.0f) ? contacts[i].indexA : contacts[i].indexB);
+
+        if (islandIds[root] == PHYSAC_NO_ISLAND)
+        {
+            islandIds[root] = islandsCount;
+            islands[islandsCount].count = 0;
+            islandsCount++;
+        }
+
+        islands[islandIds[root]].count++;
+    }
+
+    unsigned int start = 0;
+
+    for (unsigned int i = 0; i < islandsCount; i++)
+    {
+        islands[i].start = start;
+        start += islands[i].count;
+        islands[i].count = 0;
+    }
+
+    // Store manifolds indices grouped by island, keeping manifolds order
+    for (unsigned int i = 0; i < physicsManifoldsCount; i++)
+    {
+        unsigned int root = FindIslandRoot((bodiesData.enabled[contacts[i].indexA] != 0.0f) ? contacts[i].indexA : contacts[i].indexB);
+        PhysicsIsland *island = &islands[islandIds[root]];
+
+        islandManifolds[island->start + island->count] = i;
+        island->count++;
+    }
+}
+
+// Returns union-find root body of a physics body island
+static unsigned int FindIslandRoot(unsigned int index)
+{
+    // Point every visited body to its grandparent, so next searches are shorter
+    while (islandParent[index] != index)
+    {
+        islandParent[index] = islandParent[islandParent[index]];
+        index = islandParent[index];
+    }
+
+    return index;
+}
+
+// Does a job on every island, in parallel on solver threads
+static void SolvePhysicsIslands(PhysicsIslandsJob job)
+{
+    islandsJob = job;
+    islandsNext = 0;
+
+    #if !defined(PHYSAC_NO_THREADS)
+        if ((physicsWorkersCount > 0) && (islandsCount > 1))
+        {
+            // Wake workers and take islands with them
+            pthread_mutex_lock(&physicsWorkersLock);
+            physicsWorkersBusy = physicsWorkersCount;
+            physicsWorkersJob++;
+            pthread_cond_broadcast(&physicsWorkersWake);
+            pthread_mutex_unlock(&physicsWorkersLock);
+
+            RunIslandsJob();
+
+            // Wait for islands still being solved by workers
+            pthread_mutex_lock(&physicsWorkersLock);
+
+            while (physicsWorkersBusy > 0)
+                pthread_cond_wait(&physicsWorkersDone, &physicsWorkersLock);
+
+            pthread_mutex_unlock(&physicsWorkersLock);
+            return;
+        }
+    #endif
+
+    RunIslandsJob();
+}
+
+// Takes islands and does current job on them until none is left
+// NOTE: Islands don't share written bodies, so the thread solving each island doesn't change results
+static void RunIslandsJob(void)
+{
+    while (true)
+    {
+        unsigned int index = PHYSAC_ATOMIC_FETCH_ADD(&islandsNext, 1);
+
+        if (index >= islandsCount)
+            break;
+
+        const unsigned int *manifolds = &islandManifolds[islands[index].start];
+        const unsigned int count = islands[index].count;
+
+        if (islandsJob == PHYSICS_JOB_IMPULSES)
+        {
+            for (unsigned int i = 0; i < count; i++)
+                InitializePhysicsManifolds(&contacts[manifolds[i]]);
+
+            for (int i = 0; i < collisionIterations; i++)
+            {
+                for (unsigned int j = 0; j < count; j++)
+                    IntegratePhysicsImpulses(&contacts[manifolds[j]]);
+            }
+        }
+        else
+        {
+            for (unsigned int i = 0; i < count; i++)
+                CorrectPhysicsPositions(&contacts[manifolds[i]]);
+        }
+    }
+}
+
+// Puts islands resting long enough to sleep
+// NOTE: Bodies not touching other enabled bodies are islands by themselves
+static void UpdatePhysicsSleeping(void)
+{
+    const float step = (float)deltaTime;
+    const float gravityVelocity = (float)(MathLenSqr(gravityForce)*(deltaTime/1000)*(deltaTime/1000));
+    const float maxVelocity = gravityVelocity + PHYSAC_SLEEP_VELOCITY*PHYSAC_SLEEP_VELOCITY;
+    const float maxAngularVelocity = PHYSAC_SLEEP_ANGULAR_VELOCITY*PHYSAC_SLEEP_ANGULAR_VELOCITY;
+
+    physicsAwakeCount = 0;
+
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
+    {
+        islandSleepTime[i] = PHYSAC_FLT_MAX;
+        islandSleepHead[i] = PHYSAC_NO_ISLAND;
+    }
+
+    // Update bodies resting time and keep shortest one of each island
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
+    {
+        if (bodiesData.enabled[i] == 0.0f)
+            continue;
+
+        PhysicsBody body = bodies[i];
+        float velocity = bodiesData.velocityX[i]*bodiesData.velocityX[i] + bodiesData.velocityY[i]*bodiesData.velocityY[i];
+        float angularVelocity = bodiesData.angularVelocity[i]*bodiesData.angularVelocity[i];
+
+        if ((velocity <= maxVelocity) && (angularVelocity <= maxAngularVelocity))
+            body->sleepTime += step;
+        else
+            body->sleepTime = 0.0f;
+
+        unsigned int root = FindIslandRoot(i);
+        islandSleepTime[root] = min(islandSleepTime[root], body->sleepTime);
+        physicsAwakeCount++;
+    }
+
+    if (!sleepingEnabled)
+        return;
+
+    // Put every body of resting islands to sleep, linking them so they wake up together
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
+    {
+        if (bodiesData.enabled[i] == 0.0f)
+            continue;
+
+        unsigned int root = FindIslandRoot(i);
+
+        if (islandSleepTime[root] < PHYSAC_SLEEP_TIME)
+            continue;
+
+        PhysicsBody body = bodies[i];
+        unsigned int head = islandSleepHead[root];
+
+        if (head == PHYSAC_NO_ISLAND)
+        {
+            islandSleepHead[root] = body->id;
+            sleepNext[body->id] = body->id;
+        }
+        else
+        {
+            sleepNext[body->id] = sleepNext[head];
+            sleepNext[head] = body->id;
+        }
+
+        body->isAwake = false;
+        bodiesData.velocityX[i] = 0.0f;
+        bodiesData.velocityY[i] = 0.0f;
+        bodiesData.angularVelocity[i] = 0.0f;
+        physicsSleepingCount++;
+        physicsAwakeCount--;
+    }
+}
+
+// Wakes up sleeping bodies touching a disabled body, they don't share its sleep list
+// NOTE: Bodies asleep for more than a step have no manifold with it, so bounding boxes overlap is checked too
+static void WakePhysicsBodyNeighbours(PhysicsBody body)
+{
+    for (unsigned int i = 0; (i < physicsManifoldsCount) && (physicsSleepingCount > 0); i++)
+    {
+        if (contacts[i].bodyA == body)
+            PhysicsWakeBody(contacts[i].bodyB);
+        else if (contacts[i].bodyB == body)
+            PhysicsWakeBody(contacts[i].bodyA);
+    }
+
+    if (physicsSleepingCount == 0)
+        return;
+
+    Vector2 boxMin = { 0.0f, 0.0f };
+    Vector2 boxMax = { 0.0f, 0.0f };
+    GetPhysicsBodyBounds(body, &boxMin, &boxMax);
+
+    // Resting bodies can be separated up to penetration allowance
+    boxMin = (Vector2){ boxMin.x - PHYSAC_PENETRATION_ALLOWANCE, boxMin.y - PHYSAC_PENETRATION_ALLOWANCE };
+    boxMax = (Vector2){ boxMax.x + PHYSAC_PENETRATION_ALLOWANCE, boxMax.y + PHYSAC_PENETRATION_ALLOWANCE };
+
+    for (unsigned int i = 0; (i < physicsBodiesCount) && (physicsSleepingCount > 0); i++)
+    {
+        if (sleepNext[bodies[i]->id] == PHYSAC_NO_ISLAND)
+            continue;
+
+        Vector2 bodyMin = { 0.0f, 0.0f };
+        Vector2 bodyMax = { 0.0f, 0.0f };
+        GetPhysicsBodyBounds(bodies[i], &bodyMin, &bodyMax);
+
+        if ((bodyMin.x <= boxMax.x) && (bodyMax.x >= boxMin.x) && (bodyMin.y <= boxMax.y) && (bodyMax.y >= boxMin.y))
+            PhysicsWakeBody(bodies[i]);
+    }
+}
+
+#if !defined(PHYSAC_NO_THREADS)
+// Solver worker thread function
+static void *PhysicsWorker(void *arg)
+{
+    unsigned int job = (unsigned int)(uintptr_t)arg;
+
+    pthread_mutex_lock(&physicsWorkersLock);
+
+    while (true)
+    {
+        // Wait for a new job or exit request
+        while ((physicsWorkersJob == job) && !physicsWorkersExit)
+            pthread_cond_wait(&physicsWorkersWake, &physicsWorkersLock);
+
+        if (physicsWorkersExit)
+            break;
+
+        job = physicsWorkersJob;
+        pthread_mutex_unlock(&physicsWorkersLock);
+
+        RunIslandsJob();
+
+        pthread_mutex_lock(&physicsWorkersLock);
+        physicsWorkersBusy--;
+
+        if (physicsWorkersBusy == 0)
+            pthread_cond_signal(&physicsWorkersDone);
+    }
+
+    pthread_mutex_unlock(&physicsWorkersLock);
+
+    return NULL;
+}
+
+// Exits and joins solver worker threads
+static void StopPhysicsWorkers(void)
+{
+    pthread_mutex_lock(&physicsWorkersLock);
+    physicsWorkersExit = true;
+    pthread_cond_broadcast(&physicsWorkersWake);
+    pthread_mutex_unlock(&physicsWorkersLock);
+
+    for (int i = 0; i < physicsWorkersCount; i++)
+        pthread_join(physicsWorkers[i], NULL);
+
+    physicsWorkersCount = 0;
+    physicsWorkersExit = false;
+}
+#endif
+
+// Returns the extreme point along a direction within a polygon
+static Vector2 GetSupport(const PhysicsShape *shape, Vector2 dir)
+{
+    float bestProjection = -PHYSAC_FLT_MAX;
+    Vector2 bestVertex = { 0.0f, 0.0f };
+    const PolygonData *data = &shape->vertexData;
+
+    for (unsigned int i = 0; i < data->vertexCount; i++)
+    {
+        Vector2 vertex = data->positions[i];
+        float projection = MathDot(vertex, dir);
+
+        if (projection > bestProjection)
+        {
+            bestVertex = vertex;
+            bestProjection = projection;
+        }
+    }
+
+    return bestVertex;
+}
+
+// Finds polygon shapes axis least penetration
+static float FindAxisLeastPenetration(int *faceIndex, const PhysicsShape *shapeA, const PhysicsShape *shapeB)
+{
+    float bestDistance = -PHYSAC_FLT_MAX;
+    int bestIndex = 0;
+
+    const PolygonData *dataA = &shapeA->vertexData;
+    Mat2 buT = Mat2Transpose(shapeB->transform);
+
+    float distances[PHYSAC_MAX_VERTICES];
+    int start = 0;
+
+    // Compute faces penetration distances 4 at a time, remaining faces one at a time
+#if defined(PHYSAC_SIMD_SSE2)
+    if (physicsSimd != PHYSICS_SIMD_NONE)
+        start = FindFacesDistanceSSE2(distances, shapeA, shapeB);
+#endif
+
+    for (unsigned int i = start; i < dataA->vertexCount; i++)
+    {
+        // Retrieve a face normal from A shape
+        Vector2 normal = dataA->normals[i];
+        Vector2 transNormal = Mat2MultiplyVector2(shapeA->transform, normal);
+
+        // Transform face normal into B shape's model space
+        normal = Mat2MultiplyVector2(buT, transNormal);
+
+        // Retrieve support point from B shape along -n
+        Vector2 support = GetSupport(shapeB, (Vector2){ -normal.x, -normal.y });
+
+        // Retrieve vertex on face from A shape, transform into B shape's model space
+        Vector2 vertex = dataA->positions[i];
+        vertex = Mat2MultiplyVector2(shapeA->transform, vertex);
+        vertex = Vector2Add(vertex, shapeA->body->position);
+        vertex = Vector2Subtract(vertex, shapeB->body->position);
+        vertex = Mat2MultiplyVector2(buT, vertex);
+
+        // Compute penetration distance in B shape's model space
+        distances[i] = MathDot(normal, Vector2Subtract(support, vertex));
+    }
+
+    // Store greatest distance
+    for (unsigned int i = 0; i < dataA->vertexCount; i++)
+    {
+        if (distances[i] > bestDistance)
+        {
+            bestDistance = distances[i];
+            bestIndex = i;
+        }
+    }
+
+    *faceIndex = bestIndex;
+    return bestDistance;
+}
+
+#if defined(PHYSAC_SIMD_SSE2)
+// Computes A shape faces penetration distances into B shape 4 faces at a time, returns faces computed
+// NOTE: Same operations as FindAxisLeastPenetration() are done for each face (support points of 4 faces are found
+// in a single pass over B shape vertices), so distances don't depend on SIMD being used
+static int FindFacesDistanceSSE2(float *distances, const PhysicsShape *shapeA, const PhysicsShape *shapeB)
+{
+    const PolygonData *dataA = &shapeA->vertexData;
+    const PolygonData *dataB = &shapeB->vertexData;
+    const int count = dataA->vertexCount & ~3;
+
+    const Mat2 ta = shapeA->transform;
+    const Mat2 tb = Mat2Transpose(shapeB->transform);
+    const __m128 a00 = _mm_set1_ps(ta.m00), a01 = _mm_set1_ps(ta.m01), a10 = _mm_set1_ps(ta.m10), a11 = _mm_set1_ps(ta.m11);
+    const __m128 b00 = _mm_set1_ps(tb.m00), b01 = _mm_set1_ps(tb.m01), b10 = _mm_set1_ps(tb.m10), b11 = _mm_set1_ps(tb.m11);
+    const __m128 positionAX = _mm_set1_ps(shapeA->body->position.x), positionAY = _mm_set1_ps(shapeA->body->position.y);
+    const __m128 positionBX = _mm_set1_ps(shapeB->body->position.x), positionBY = _mm_set1_ps(shapeB->body->position.y);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    for (int i = 0; i < count; i += 4)
+    {
+        // Retrieve 4 faces normals from A shape and transform them into B shape's model space
+        __m128 normalsA = _mm_loadu_ps(&dataA->normals[i].x);
+        __m128 normalsB = _mm_loadu_ps(&dataA->normals[i + 2].x);
+        __m128 normalX = _mm_shuffle_ps(normalsA, normalsB, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 normalY = _mm_shuffle_ps(normalsA, normalsB, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m128 transNormalX = _mm_add_ps(_mm_mul_ps(a00, normalX), _mm_mul_ps(a01, normalY));
+        __m128 transNormalY = _mm_add_ps(_mm_mul_ps(a10, normalX), _mm_mul_ps(a11, normalY));
+        normalX = _mm_add_ps(_mm_mul_ps(b00, transNormalX), _mm_mul_ps(b01, transNormalY));
+        normalY = _mm_add_ps(_mm_mul_ps(b10, transNormalX), _mm_mul_ps(b11, transNormalY));
+
+        __m128 directionX = _mm_xor_ps(normalX, signMask);
+        __m128 directionY = _mm_xor_ps(normalY, signMask);
+
+        // Retrieve support points from B shape along -n of each face
+        __m128 bestProjection = _mm_set1_ps(-PHYSAC_FLT_MAX);
+        __m128 supportX = _mm_setzero_ps();
+        __m128 supportY = _mm_setzero_ps();
+
+        for (unsigned int j = 0; j < dataB->vertexCount; j++)
+        {
+            __m128 vertexX = _mm_set1_ps(dataB->positions[j].x);
+            __m128 vertexY = _mm_set1_ps(dataB->positions[j].y);
+            __m128 projection = _mm_add_ps(_mm_mul_ps(vertexX, directionX), _mm_mul_ps(vertexY, directionY));
+            __m128 greater = _mm_cmpgt_ps(projection, bestProjection);
+
+            bestProjection = _mm_or_ps(_mm_and_ps(greater, projection), _mm_andnot_ps(greater, bestProjection));
+            supportX = _mm_or_ps(_mm_and_ps(greater, vertexX), _mm_andnot_ps(greater, supportX));
+            supportY = _mm_or_ps(_mm_and_ps(greater, vertexY), _mm_andnot_ps(greater, supportY));
+        }
+
+        // Retrieve vertices on faces from A shape, transform into B shape's model space
+        __m128 verticesA = _mm_loadu_ps(&dataA->positions[i].x);
+        __m128 verticesB = _mm_loadu_ps(&dataA->positions[i + 2].x);
+        __m128 positionX = _mm_shuffle_ps(verticesA, verticesB, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 positionY = _mm_shuffle_ps(verticesA, verticesB, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m128 vertexX = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a00, positionX), _mm_mul_ps(a01, positionY)), positionAX), positionBX);
+        __m128 vertexY = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a10, positionX), _mm_mul_ps(a11, positionY)), positionAY), positionBY);
+        positionX = _mm_add_ps(_mm_mul_ps(b00, vertexX), _mm_mul_ps(b01, vertexY));
+        positionY = _mm_add_ps(_mm_mul_ps(b10, vertexX), _mm_mul_ps(b11, vertexY));
+
+        // Compute penetration distances in B shape's model space
+        __m128 distance = _mm_add_ps(_mm_mul_ps(normalX, _mm_sub_ps(supportX, positionX)), _mm_mul_ps(normalY, _mm_sub_ps(supportY, positionY)));
+        _mm_storeu_ps(&distances[i], distance);
+    }
+
+    return count;
+}
+#endif
+
+// Finds two polygon shapes incident face
+static int FindIncidentFace(Vector2 *v0, Vector2 *v1, PhysicsShape ref, PhysicsShape inc, int index)
+{
+    PolygonData refData = ref.vertexData;
+    PolygonData incData = inc.vertexData;
+
+    Vector2 referenceNormal = refData.normals[index];
+
+    // Calculate normal in incident's frame of reference
+    referenceNormal = Mat2MultiplyVector2(ref.transform, referenceNormal); // To world space
+    referenceNormal = Mat2MultiplyVector2(Mat2Transpose(inc.transform), referenceNormal); // To incident's model space
+
+    // Find most anti-normal face on polygon
+    int incidentFace = 0;
+    float minDot = PHYSAC_FLT_MAX;
+
+    for (unsigned int i = 0; i < incData.vertexCount; i++)
+    {
+        float dot = MathDot(referenceNormal, incData.normals[i]);
+
+        if (dot < minDot)
+        {
+            minDot = dot;
+            incidentFace = i;
+        }
     }
 
-    // Update physics body grounded state if normal direction is down
-    if (!bodyA->isGrounded)
-        bodyA->isGrounded = (manifold->normal.y < 0);
+    // Assign face vertices for incident face
+    *v0 = Mat2MultiplyVector2(inc.transform, incData.positions[incidentFace]);
+    *v0 = Vector2Add(*v0, inc.body->position);
+    int nextIndex = (((incidentFace + 1) < (int)incData.vertexCount) ? (incidentFace + 1) : 0);
+    *v1 = Mat2MultiplyVector2(inc.transform, incData.positions[nextIndex]);
+    *v1 = Vector2Add(*v1, inc.body->position);
+
+    return incidentFace;
 }
 
-// Solves collision between a circle to a polygon shape physics bodies
-static void SolveCircleToPolygon(PhysicsManifold manifold)
+// Calculates clipping based on a normal and two faces
+static int Clip(Vector2 normal, float clip, Vector2 *faceA, Vector2 *faceB)
 {
-    PhysicsBody bodyA = manifold->bodyA;
-    PhysicsBody bodyB = manifold->bodyB;
+    int sp = 0;
+    Vector2 out[2] = { *faceA, *faceB };
 
-    if ((bodyA == NULL) || (bodyB == NULL))
-        return;
+    // Retrieve distances from each endpoint to the line
+    float distanceA = MathDot(normal, *faceA) - clip;
+    float distanceB = MathDot(normal, *faceB) - clip;
 
-    SolveDifferentShapes(manifold, bodyA, bodyB);
-}
+    // If negative (behind plane)
+    if (distanceA <= 0.0f)
+        out[sp++] = *faceA;
 
-// Solves collision between a circle to a polygon shape physics bodies
-static void SolvePolygonToCircle(PhysicsManifold manifold)
-{
-    PhysicsBody bodyA = manifold->bodyA;
-    PhysicsBody bodyB = manifold->bodyB;
+    if (distanceB <= 0.0f)
+        out[sp++] = *faceB;
 
-    if ((bodyA == NULL) || (bodyB == NULL))
-        return;
+    // If the points are on different sides of the plane
+    if ((distanceA*distanceB) < 0.0f)
+    {
+        // Push intersection point
+        float alpha = distanceA/(distanceA - distanceB);
+        out[sp] = *faceA;
+        Vector2 delta = Vector2Subtract(*faceB, *faceA);
+        delta.x *= alpha;
+        delta.y *= alpha;
+        out[sp] = Vector2Add(out[sp], delta);
+        sp++;
+    }
 
-    SolveDifferentShapes(manifold, bodyB, bodyA);
-    
-    manifold->normal.x *= -1.0f;
-    manifold->normal.y *= -1.0f;
+    // Assign the new converted values
+    *faceA = out[0];
+    *faceB = out[1];
+
+    return sp;
 }
 
-// Solve collision between two different types of shapes
-static void SolveDifferentShapes(PhysicsManifold manifold, PhysicsBody bodyA, PhysicsBody bodyB)
+// Check if values are between bias range
+static bool BiasGreaterThan(float valueA, float valueB)
 {
-    manifold->contactsCount = 0;
-
-    // Transform circle center to polygon transform space
-    Vector2 center = bodyA->position;
-    center = Mat2MultiplyVector2(Mat2Transpose(bodyB->shape.transform), Vector2Subtract(center, bodyB->position));
+    return (valueA >= (valueB*0.95f + valueA*0.01f));
+}
 
-    // Find edge with minimum penetration
-    // It is the same concept as using support points in SolvePolygonToPolygon
-    float separation = -PHYSAC_FLT_MAX;
-    int faceNormal = 0;
-    PolygonData vertexData = bodyB->shape.vertexData;
+// Calculates physics bodies axis aligned bounding boxes
+static void UpdatePhysicsBounds(void)
+{
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
+        GetPhysicsBodyBounds(bodies[i], &boundsMin[i], &boundsMax[i]);
+}
 
-    for (int i = 0; i < vertexData.vertexCount; i++)
+// Calculates a physics body axis aligned bounding box
+static void GetPhysicsBodyBounds(PhysicsBody body, Vector2 *boundMin, Vector2 *boundMax)
+{
+    if (body->shape.type == PHYSICS_CIRCLE)
     {
-        float currentSeparation = MathDot(vertexData.normals[i], Vector2Subtract(center, vertexData.positions[i]));
-
-        if (currentSeparation > bodyA->shape.radius)
-            return;
+        *boundMin = (Vector2){ body->position.x - body->shape.radius, body->position.y - body->shape.radius };
+        *boundMax = (Vector2){ body->position.x + body->shape.radius, body->position.y + body->shape.radius };
+    }
+    else
+    {
+        *boundMin = (Vector2){ PHYSAC_FLT_MAX, PHYSAC_FLT_MAX };
+        *boundMax = (Vector2){ -PHYSAC_FLT_MAX, -PHYSAC_FLT_MAX };
 
-        if (currentSeparation > separation)
+        for (unsigned int i = 0; i < body->shape.vertexData.vertexCount; i++)
         {
-            separation = currentSeparation;
-            faceNormal = i;
+            Vector2 vertex = Vector2Add(body->position, Mat2MultiplyVector2(body->shape.transform, body->shape.vertexData.positions[i]));
+
+            boundMin->x = min(boundMin->x, vertex.x);
+            boundMin->y = min(boundMin->y, vertex.y);
+            boundMax->x = max(boundMax->x, vertex.x);
+            boundMax->y = max(boundMax->y, vertex.y);
         }
     }
+}
 
-    // Grab face's vertices
-    Vector2 v1 = vertexData.positions[faceNormal];
-    int nextIndex = (((faceNormal + 1) < vertexData.vertexCount) ? (faceNormal + 1) : 0);
-    Vector2 v2 = vertexData.positions[nextIndex];
+// Finds pairs of bodies which bounding boxes overlap
+static void FindBroadphasePairs(void)
+{
+    broadphasePairsCount = 0;
 
-    // Check to see if center is within polygon
-    if (separation < PHYSAC_EPSILON)
+    switch (broadphaseType)
     {
-        manifold->contactsCount = 1;
-        Vector2 normal = Mat2MultiplyVector2(bodyB->shape.transform, vertexData.normals[faceNormal]);
-        manifold->normal = (Vector2){ -normal.x, -normal.y };
-        manifold->contacts[0] = (Vector2){ manifold->normal.x*bodyA->shape.radius + bodyA->position.x, manifold->normal.y*bodyA->shape.radius + bodyA->position.y };
-        manifold->penetration = bodyA->shape.radius;
-        return;
+        case PHYSICS_BROADPHASE_GRID: FindPairsGrid(); break;
+        case PHYSICS_BROADPHASE_SAP: FindPairsSweepAndPrune(); break;
+        default: FindPairsBruteForce(); break;
     }
+}
 
-    // Determine which voronoi region of the edge center of circle lies within
-    float dot1 = MathDot(Vector2Subtract(center, v1), Vector2Subtract(v2, v1));
-    float dot2 = MathDot(Vector2Subtract(center, v2), Vector2Subtract(v1, v2));
-    manifold->penetration = bodyA->shape.radius - separation;
-
-    if (dot1 <= 0.0f) // Closest to v1
+// Adds every pair of bodies
+static void FindPairsBruteForce(void)
+{
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
     {
-        if (DistSqr(center, v1) > bodyA->shape.radius*bodyA->shape.radius)
-            return;
-
-        manifold->contactsCount = 1;
-        Vector2 normal = Vector2Subtract(v1, center);
-        normal = Mat2MultiplyVector2(bodyB->shape.transform, normal);
-        MathNormalize(&normal);
-        manifold->normal = normal;
-        v1 = Mat2MultiplyVector2(bodyB->shape.transform, v1);
-        v1 = Vector2Add(v1, bodyB->position);
-        manifold->contacts[0] = v1;
+        for (unsigned int j = i + 1; j < physicsBodiesCount; j++)
+            AddBroadphasePair(i, j);
     }
-    else if (dot2 <= 0.0f) // Closest to v2
+}
+
+// Finds overlapping pairs with uniform grid spatial hash
+// NOTE: Bodies are added to every cell their bounding box covers, a pair is only added by the
+// cell containing the minimum corner of both bounding boxes overlap so it is never added twice
+static void FindPairsGrid(void)
+{
+    BuildPhysicsGrid();
+
+    const float inverseCellSize = 1.0f/gridCellSizeUsed;
+    const unsigned int entriesCount = gridBuckets[gridBucketsCount - 1];
+    const unsigned int bucketsCount = gridBucketsCount;
+
+    // Test bodies sharing a cell (after sorting each bucket start points to the next bucket)
+    for (unsigned int i = 0; i < entriesCount; i++)
     {
-        if (DistSqr(center, v2) > bodyA->shape.radius*bodyA->shape.radius)
-            return;
+        unsigned int *entryA = &gridSorted[i*4];
+        unsigned int bucketEnd = gridBuckets[entryA[3] & (bucketsCount - 1)];
 
-        manifold->contactsCount = 1;
-        Vector2 normal = Vector2Subtract(v2, center);
-        v2 = Mat2MultiplyVector2(bodyB->shape.transform, v2);
-        v2 = Vector2Add(v2, bodyB->position);
-        manifold->contacts[0] = v2;
-        normal = Mat2MultiplyVector2(bodyB->shape.transform, normal);
-        MathNormalize(&normal);
-        manifold->normal = normal;
+        for (unsigned int j = i + 1; j < bucketEnd; j++)
+        {
+            unsigned int *entryB = &gridSorted[j*4];
+
+            if ((entryA[1] != entryB[1]) || (entryA[2] != entryB[2]))
+                continue;
+
+            unsigned int a = min(entryA[0], entryB[0]);
+            unsigned int b = max(entryA[0], entryB[0]);
+
+            if ((boundsMin[a].x > boundsMax[b].x) || (boundsMin[b].x > boundsMax[a].x) || (boundsMin[a].y > boundsMax[b].y) || (boundsMin[b].y > boundsMax[a].y))
+                continue;
+
+            // Only the cell containing the bounding boxes overlap minimum corner adds the pair
+            if (((int)floorf(max(boundsMin[a].x, boundsMin[b].x)*inverseCellSize) == (int)entryA[1]) &&
+                ((int)floorf(max(boundsMin[a].y, boundsMin[b].y)*inverseCellSize) == (int)entryA[2]))
+                AddBroadphasePair(a, b);
+        }
     }
-    else // Closest to face
+
+    // Test bodies covering too many cells against all bodies
+    for (int k = 0; k < gridLargeBodiesCount; k++)
     {
-        Vector2 normal = vertexData.normals[faceNormal];
+        unsigned int i = gridLargeBodies[k];
 
-        if (MathDot(Vector2Subtract(center, v1), normal) > bodyA->shape.radius)
-            return;
+        for (unsigned int j = 0; j < physicsBodiesCount; j++)
+        {
+            // Pairs of two large bodies are added once
+            if ((j == i) || (gridLarge[j] && (j < i)))
+                continue;
 
-        normal = Mat2MultiplyVector2(bodyB->shape.transform, normal);
-        manifold->normal = (Vector2){ -normal.x, -normal.y };
-        manifold->contacts[0] = (Vector2){ manifold->normal.x*bodyA->shape.radius + bodyA->position.x, manifold->normal.y*bodyA->shape.radius + bodyA->position.y };
-        manifold->contactsCount = 1;
+            if ((boundsMin[i].x > boundsMax[j].x) || (boundsMin[j].x > boundsMax[i].x) || (boundsMin[i].y > boundsMax[j].y) || (boundsMin[j].y > boundsMax[i].y))
+                continue;
+
+            AddBroadphasePair(min(i, j), max(i, j));
+        }
     }
 }
 
-// Solves collision between two polygons shape physics bodies
-static void SolvePolygonToPolygon(PhysicsManifold manifold)
+// Adds bodies to uniform grid spatial hash cells their bounding box covers
+// NOTE: Entries are sorted by hash bucket, after sorting each bucket start points to the next bucket
+static void BuildPhysicsGrid(void)
 {
-    if ((manifold->bodyA == NULL) || (manifold->bodyB == NULL))
-        return;
+    float cellSize = gridCellSize;
 
-    PhysicsShape bodyA = manifold->bodyA->shape;
-    PhysicsShape bodyB = manifold->bodyB->shape;
-    manifold->contactsCount = 0;
+    // Choose cell size twice the average bodies size
+    if (cellSize <= 0.0f)
+    {
+        cellSize = 0.0f;
 
-    // Check for separating axis with A shape's face planes
-    int faceA = 0;
-    float penetrationA = FindAxisLeastPenetration(&faceA, bodyA, bodyB);
-    
-    if (penetrationA >= 0.0f)
-        return;
+        for (unsigned int i = 0; i < physicsBodiesCount; i++)
+            cellSize += max(boundsMax[i].x - boundsMin[i].x, boundsMax[i].y - boundsMin[i].y);
 
-    // Check for separating axis with B shape's face planes
-    int faceB = 0;
-    float penetrationB = FindAxisLeastPenetration(&faceB, bodyB, bodyA);
-    
-    if (penetrationB >= 0.0f)
-        return;
+        if (physicsBodiesCount > 0) cellSize = cellSize*2.0f/physicsBodiesCount;
+        if (cellSize <= 0.0f) cellSize = 1.0f;
+    }
 
-    int referenceIndex = 0;
-    bool flip = false;  // Always point from A shape to B shape
+    float inverseCellSize = 1.0f/cellSize;
+    unsigned int entriesCount = 0;
 
-    PhysicsShape refPoly; // Reference
-    PhysicsShape incPoly; // Incident
+    gridCellSizeUsed = cellSize;
+    gridLargeBodiesCount = 0;
+    gridBoundsMin = (Vector2){ PHYSAC_FLT_MAX, PHYSAC_FLT_MAX };
+    gridBoundsMax = (Vector2){ -PHYSAC_FLT_MAX, -PHYSAC_FLT_MAX };
 
-    // Determine which shape contains reference face
-    if (BiasGreaterThan(penetrationA, penetrationB))
-    {
-        refPoly = bodyA;
-        incPoly = bodyB;
-        referenceIndex = faceA;
-    }
-    else
+    // Add each body to grid cells it covers
+    for (unsigned int i = 0; i < physicsBodiesCount; i++)
     {
-        refPoly = bodyB;
-        incPoly = bodyA;
-        referenceIndex = faceB;
-        flip = true;
-    }
+        int minX = (int)floorf(boundsMin[i].x*inverseCellSize);
+        int minY = (int)floorf(boundsMin[i].y*inverseCellSize);
+        int maxX = (int)floorf(boundsMax[i].x*inverseCellSize);
+        int maxY = (int)floorf(boundsMax[i].y*inverseCellSize);
 
-    // World space incident face
-    Vector2 incidentFace[2];
-    FindIncidentFace(&incidentFace[0], &incidentFace[1], refPoly, incPoly, referenceIndex);
+        gridBoundsMin.x = min(gridBoundsMin.x, boundsMin[i].x);
+        gridBoundsMin.y = min(gridBoundsMin.y, boundsMin[i].y);
+        gridBoundsMax.x = max(gridBoundsMax.x, boundsMax[i].x);
+        gridBoundsMax.y = max(gridBoundsMax.y, boundsMax[i].y);
 
-    // Setup reference face vertices
-    PolygonData refData = refPoly.vertexData;
-    Vector2 v1 = refData.positions[referenceIndex];
-    referenceIndex = (((referenceIndex + 1) < refData.vertexCount) ? (referenceIndex + 1) : 0);
-    Vector2 v2 = refData.positions[referenceIndex];
+        gridLarge[i] = (((float)(maxX - minX + 1)*(float)(maxY - minY + 1)) > PHYSAC_GRID_MAX_CELLS);
 
-    // Transform vertices to world space
-    v1 = Mat2MultiplyVector2(refPoly.transform, v1);
-    v1 = Vector2Add(v1, refPoly.body->position);
-    v2 = Mat2MultiplyVector2(refPoly.transform, v2);
-    v2 = Vector2Add(v2, refPoly.body->position);
+        if (gridLarge[i])
+        {
+            gridLargeBodies[gridLargeBodiesCount] = i;
+            gridLargeBodiesCount++;
+            continue;
+        }
 
-    // Calculate reference face side normal in world space
-    Vector2 sidePlaneNormal = Vector2Subtract(v2, v1);
-    MathNormalize(&sidePlaneNormal);
+        gridEntries = (unsigned int *)GrowArray(gridEntries, &gridEntriesCapacity, entriesCount + (maxX - minX + 1)*(maxY - minY + 1), sizeof(unsigned int)*4);
 
-    // Orthogonalize
-    Vector2 refFaceNormal = { sidePlaneNormal.y, -sidePlaneNormal.x };
-    float refC = MathDot(refFaceNormal, v1);
-    float negSide = MathDot(sidePlaneNormal, v1)*-1;
-    float posSide = MathDot(sidePlaneNormal, v2);
+        for (int y = minY; y <= maxY; y++)
+        {
+            for (int x = minX; x <= maxX; x++)
+            {
+                unsigned int *entry = &gridEntries[entriesCount*4];
+                entry[0] = i;
+                entry[1] = (unsigned int)x;
+                entry[2] = (unsigned int)y;
+                entry[3] = ((unsigned int)x*73856093u) ^ ((unsigned int)y*19349663u);
+                entriesCount++;
+            }
+        }
+    }
 
-    // Clip incident face to reference face side planes (due to floating point error, possible to not have required points
-    if (Clip((Vector2){ -sidePlaneNormal.x, -sidePlaneNormal.y }, negSide, &incidentFace[0], &incidentFace[1]) < 2)
-        return;
+    // Sort entries by hash bucket (counting sort), so entries of same cell are next to each other
+    unsigned int bucketsCount = 1;
+    while (bucketsCount < entriesCount) bucketsCount *= 2;
 
-    if (Clip(sidePlaneNormal, posSide, &incidentFace[0], &incidentFace[1]) < 2)
-        return;
+    gridBuckets = (unsigned int *)GrowArray(gridBuckets, &gridBucketsCapacity, bucketsCount + 1, sizeof(unsigned int));
+    gridSorted = (unsigned int *)GrowArray(gridSorted, &gridSortedCapacity, entriesCount, sizeof(unsigned int)*4);
+    memset(gridBuckets, 0, sizeof(unsigned int)*(bucketsCount + 1));
 
-    // Flip normal if required
-    manifold->normal = (flip ? (Vector2){ -refFaceNormal.x, -refFaceNormal.y } : refFaceNormal);
+    for (unsigned int i = 0; i < entriesCount; i++)
+        gridBuckets[(gridEntries[i*4 + 3] & (bucketsCount - 1)) + 1]++;
 
-    // Keep points behind reference face
-    int currentPoint = 0; // Clipped points behind reference face
-    float separation = MathDot(refFaceNormal, incidentFace[0]) - refC;
-    
-    if (separation <= 0.0f)
+    for (unsigned int i = 0; i < bucketsCount; i++)
+        gridBuckets[i + 1] += gridBuckets[i];
+
+    for (unsigned int i = 0; i < entriesCount; i++)
     {
-        manifold->contacts[currentPoint] = incidentFace[0];
-        manifold->penetration = -separation;
-        currentPoint++;
+        unsigned int index = gridBuckets[gridEntries[i*4 + 3] & (bucketsCount - 1)]++;
+        memcpy(&gridSorted[index*4], &gridEntries[i*4], sizeof(unsigned int)*4);
     }
-    else
-        manifold->penetration = 0.0f;
 
-    separation = MathDot(refFaceNormal, incidentFace[1]) - refC;
+    gridBucketsCount = bucketsCount;
+}
 
-    if (separation <= 0.0f)
-    {
-        manifold->contacts[currentPoint] = incidentFace[1];
-        manifold->penetration += -separation;
-        currentPoint++;
+// Returns sorted grid entries range of the bucket containing a cell
+// NOTE: Buckets can contain entries of other cells, entries cell must be checked
+static void GetGridCell(int x, int y, unsigned int *start, unsigned int *end)
+{
+    unsigned int bucket = (((unsigned int)x*73856093u) ^ ((unsigned int)y*19349663u)) & (gridBucketsCount - 1);
 
-        // Calculate total penetration average
-        manifold->penetration /= currentPoint;
-    }
+    *start = ((bucket > 0) ? gridBuckets[bucket - 1] : 0);
+    *end = gridBuckets[bucket];
+}
+
+// Builds bounds and grid again if bodies moved since last built
+static void UpdateQueryGrid(void)
+{
+    if (queryGridValid)
+        return;
+
+    UpdatePhysicsBounds();
+    BuildPhysicsGrid();
+    queryGridValid = true;
+}
+
+// Returns true if calling thread may use bodies (physics thread, or any while it doesn't run)
+static bool IsPhysicsBodiesOwner(void)
+{
+    #if !defined(PHYSAC_NO_THREADS) && !defined(PHYSAC_NO_LOOP_THREAD)
+        return (!PHYSAC_ATOMIC_LOAD(&physicsThreadEnabled) || pthread_equal(pthread_self(), physicsThreadId));
+    #else
+        return true;
+    #endif
+}
+
+// Starts a query which tests each physics body once
+static void BeginBodiesQuery(void)
+{
+    UpdateQueryGrid();
+    queryStamp++;
 
-    manifold->contactsCount = currentPoint;
+    // Query number wrapped around, bodies stamps of old queries could match it
+    if (queryStamp == 0)
+    {
+        memset(queryStamps, 0, physicsBodiesCount*sizeof(unsigned int));
+        queryStamp = 1;
+    }
 }
 
-// Integrates physics forces into velocity
-static void IntegratePhysicsForces(PhysicsBody body)
+// Returns true if body was already tested by current query, marks it tested otherwise
+static bool IsBodyQueried(unsigned int index)
 {
-    if ((body == NULL) || (body->inverseMass == 0.0f) || !body->enabled)
-        return;
+    if (queryStamps[index] == queryStamp)
+        return true;
+
+    queryStamps[index] = queryStamp;
+
+    return false;
+}
 
-    body->velocity.x += (body->force.x*body->inverseMass)*(deltaTime/2.0);
-    body->velocity.y += (body->force.y*body->inverseMass)*(deltaTime/2.0);
+// Clips a ray between enter and exit distances to a box, returns false if it doesn't cross it
+static bool ClipRayToBox(Vector2 origin, Vector2 direction, Vector2 inverseDirection, Vector2 boxMin, Vector2 boxMax, float *enter, float *exit)
+{
+    float start[2] = { origin.x, origin.y };
+    float dir[2] = { direction.x, direction.y };
+    float inverse[2] = { inverseDirection.x, inverseDirection.y };
+    float minimum[2] = { boxMin.x, boxMin.y };
+    float maximum[2] = { boxMax.x, boxMax.y };
 
-    if (body->useGravity)
+    for (int axis = 0; axis < 2; axis++)
     {
-        body->velocity.x += gravityForce.x*(deltaTime/1000/2.0);
-        body->velocity.y += gravityForce.y*(deltaTime/1000/2.0);
+        if (dir[axis] == 0.0f)
+        {
+            if ((start[axis] < minimum[axis]) || (start[axis] > maximum[axis]))
+                return false;
+        }
+        else
+        {
+            float t1 = (minimum[axis] - start[axis])*inverse[axis];
+            float t2 = (maximum[axis] - start[axis])*inverse[axis];
+            *enter = max(*enter, min(t1, t2));
+            *exit = min(*exit, max(t1, t2));
+        }
     }
 
-    if (!body->freezeOrient)
-        body->angularVelocity += body->torque*body->inverseInertia*(deltaTime/2.0);
+    return (*enter <= *exit);
 }
 
-// Initializes physics manifolds to solve collisions
-static void InitializePhysicsManifolds(PhysicsManifold manifold)
+// Casts a ray (radius 0) or circle against a body shape, returns true if hit
+// NOTE: Shapes already overlapping cast origin are not hit
+static bool CastShape(unsigned int index, Vector2 origin, Vector2 direction, Vector2 inverseDirection, float radius, float maxDistance, PhysicsHit *hit)
 {
-    PhysicsBody bodyA = manifold->bodyA;
-    PhysicsBody bodyB = manifold->bodyB;
-
-    if ((bodyA == NULL) || (bodyB == NULL))
-        return;
+    // Reject bodies which bounding box is not crossed first, it doesn't need body data
+    float enter = 0.0f;
+    float exit = maxDistance;
+    Vector2 boxMin = { boundsMin[index].x - radius, boundsMin[index].y - radius };
+    Vector2 boxMax = { boundsMax[index].x + radius, boundsMax[index].y + radius };
 
-    // Calculate average restitution, static and dynamic friction
-    manifold->restitution = sqrtf(bodyA->restitution*bodyB->restitution);
-    manifold->staticFriction = sqrtf(bodyA->staticFriction*bodyB->staticFriction);
-    manifold->dynamicFriction = sqrtf(bodyA->dynamicFriction*bodyB->dynamicFriction);
+    if (!ClipRayToBox(origin, direction, inverseDirection, boxMin, boxMax, &enter, &exit))
+        return false;
 
-    for (int i = 0; i < manifold->contactsCount; i++)
-    {
-        // Caculate radius from center of mass to contact
-        Vector2 radiusA = Vector2Subtract(manifold->contacts[i], bodyA->position);
-        Vector2 radiusB = Vector2Subtract(manifold->contacts[i], bodyB->position);
+    PhysicsBody body = bodies[index];
+    float distance = PHYSAC_FLT_MAX;
+    Vector2 normal = { 0.0f, 0.0f };
 
-        Vector2 crossA = MathCross(bodyA->angularVelocity, radiusA);
-        Vector2 crossB = MathCross(bodyB->angularVelocity, radiusB);
+    if (!CastShapeData(&body->shape, body->position, origin, direction, radius, &distance, &normal) || (distance > maxDistance))
+        return false;
 
-        Vector2 radiusV = { 0.0f, 0.0f };
-        radiusV.x = bodyB->velocity.x + crossB.x - bodyA->velocity.x - crossA.x;
-        radiusV.y = bodyB->velocity.y + crossB.y - bodyA->velocity.y - crossA.y;
+    hit->body = body;
+    hit->distance = distance;
+    hit->normal = normal;
+    hit->point = (Vector2){ origin.x + direction.x*distance - normal.x*radius, origin.y + direction.y*distance - normal.y*radius };
 
-        // Determine if we should perform a resting collision or not;
-        // The idea is if the only thing moving this object is gravity, then the collision should be performed without any restitution
-        if (MathLenSqr(radiusV) < (MathLenSqr((Vector2){ gravityForce.x*deltaTime/1000, gravityForce.y*deltaTime/1000 }) + PHYSAC_EPSILON))
-            manifold->restitution = 0;
-    }
+    return true;
 }
 
-// Integrates physics collisions impulses to solve collisions
-static void IntegratePhysicsImpulses(PhysicsManifold manifold)
+// Casts a ray (radius 0) or circle against a shape at a position, returns true if hit
+// NOTE: Shapes already overlapping cast origin are not hit
+static bool CastShapeData(const PhysicsShape *shape, Vector2 position, Vector2 origin, Vector2 direction, float radius, float *hitDistance, Vector2 *hitNormal)
 {
-    PhysicsBody bodyA = manifold->bodyA;
-    PhysicsBody bodyB = manifold->bodyB;
-
-    if ((bodyA == NULL) || (bodyB == NULL))
-        return;
+    float distance = PHYSAC_FLT_MAX;
+    Vector2 normal = { 0.0f, 0.0f };
 
-    // Early out and positional correct if both objects have infinite mass
-    if (fabs(bodyA->inverseMass + bodyB->inverseMass) <= PHYSAC_EPSILON)
+    if (shape->type == PHYSICS_CIRCLE)
     {
-        bodyA->velocity = PHYSAC_VECTOR_ZERO;
-        bodyB->velocity = PHYSAC_VECTOR_ZERO;
-        return;
+        // Ray against circle grown by cast radius
+        Vector2 offset = Vector2Subtract(origin, position);
+        float totalRadius = shape->radius + radius;
+        float b = MathDot(offset, direction);
+        float c = MathDot(offset, offset) - totalRadius*totalRadius;
+        float discriminant = b*b - c;
+
+        if ((c <= 0.0f) || (b > 0.0f) || (discriminant < 0.0f))
+            return false;
+
+        distance = -b - sqrtf(discriminant);
+        normal = (Vector2){ (offset.x + direction.x*distance)/totalRadius, (offset.y + direction.y*distance)/totalRadius };
     }
-
-    for (int i = 0; i < manifold->contactsCount; i++)
+    else
     {
-        // Calculate radius from center of mass to contact
-        Vector2 radiusA = Vector2Subtract(manifold->contacts[i], bodyA->position);
-        Vector2 radiusB = Vector2Subtract(manifold->contacts[i], bodyB->position);
+        // Cast in polygon model space
+        const PolygonData *data = &shape->vertexData;
+        Mat2 transposed = Mat2Transpose(shape->transform);
+        Vector2 start = Mat2MultiplyVector2(transposed, Vector2Subtract(origin, position));
+        Vector2 dir = Mat2MultiplyVector2(transposed, direction);
+        int face = -1;
+
+        if (radius == 0.0f)
+        {
+            // Clip ray against faces planes, last plane entered is the one hit
+            float enter = -PHYSAC_FLT_MAX;
+            float exit = PHYSAC_FLT_MAX;
 
-        // Calculate relative velocity
-        Vector2 radiusV = { 0.0f, 0.0f };
-        radiusV.x = bodyB->velocity.x + MathCross(bodyB->angularVelocity, radiusB).x - bodyA->velocity.x - MathCross(bodyA->angularVelocity, radiusA).x;
-        radiusV.y = bodyB->velocity.y + MathCross(bodyB->angularVelocity, radiusB).y - bodyA->velocity.y - MathCross(bodyA->angularVelocity, radiusA).y;
+            for (unsigned int i = 0; i < data->vertexCount; i++)
+            {
+                float numerator = MathDot(data->normals[i], Vector2Subtract(data->positions[i], start));
+                float denominator = MathDot(data->normals[i], dir);
 
-        // Relative velocity along the normal
-        float contactVelocity = MathDot(radiusV, manifold->normal);
+                if (denominator == 0.0f)
+                {
+                    if (numerator < 0.0f)
+                        return false;
+                }
+                else if (denominator < 0.0f)
+                {
+                    if (numerator/denominator > enter)
+                    {
+                        enter = numerator/denominator;
+                        face = i;
+                    }
+                }
+                else
+                    exit = min(exit, numerator/denominator);
 
-        // Do not resolve if velocities are separating
-        if (contactVelocity > 0.0f)
-            return;
+                if (exit < enter)
+                    return false;
+            }
 
-        float raCrossN = MathCrossVector2(radiusA, manifold->normal);
-        float rbCrossN = MathCrossVector2(radiusB, manifold->normal);
+            if ((face == -1) || (enter < 0.0f))
+                return false;
 
-        float inverseMassSum = bodyA->inverseMass + bodyB->inverseMass + (raCrossN*raCrossN)*bodyA->inverseInertia + (rbCrossN*rbCrossN)*bodyB->inverseInertia;
+            distance = enter;
+            normal = data->normals[face];
+        }
+        else
+        {
+            // Circle against polygon grown by cast radius: first faces moved out by radius or vertices circles reached
+            bool inside = true;
 
-        // Calculate impulse scalar value
-        float impulse = -(1.0f + manifold->restitution)*contactVelocity;
-        impulse /= inverseMassSum;
-        impulse /= (float)manifold->contactsCount;
+            for (unsigned int i = 0; i < data->vertexCount; i++)
+            {
+                Vector2 v1 = data->positions[i];
+                Vector2 v2 = data->positions[((i + 1) < data->vertexCount) ? (i + 1) : 0];
+                Vector2 n = data->normals[i];
+                float separation = MathDot(n, Vector2Subtract(start, v1));
 
-        // Apply impulse to each physics body
-        Vector2 impulseV = { manifold->normal.x*impulse, manifold->normal.y*impulse };
+                if (separation > 0.0f)
+                {
+                    inside = false;
 
-        if (bodyA->enabled)
-        {
-            bodyA->velocity.x += bodyA->inverseMass*(-impulseV.x);
-            bodyA->velocity.y += bodyA->inverseMass*(-impulseV.y);
-            
-            if (!bodyA->freezeOrient)
-                bodyA->angularVelocity += bodyA->inverseInertia*MathCrossVector2(radiusA, (Vector2){ -impulseV.x, -impulseV.y });
-        }
+                    // Origin already overlapping face region
+                    Vector2 edge = Vector2Subtract(v2, v1);
+                    float along = MathDot(Vector2Subtract(start, v1), edge);
 
-        if (bodyB->enabled)
-        {
-            bodyB->velocity.x += bodyB->inverseMass*(impulseV.x);
-            bodyB->velocity.y += bodyB->inverseMass*(impulseV.y);
-            
-            if (!bodyB->freezeOrient)
-                bodyB->angularVelocity += bodyB->inverseInertia*MathCrossVector2(radiusB, impulseV);
-        }
+                    if ((separation <= radius) && (along >= 0.0f) && (along <= MathLenSqr(edge)))
+                        return false;
+                }
 
-        // Apply friction impulse to each physics body
-        radiusV.x = bodyB->velocity.x + MathCross(bodyB->angularVelocity, radiusB).x - bodyA->velocity.x - MathCross(bodyA->angularVelocity, radiusA).x;
-        radiusV.y = bodyB->velocity.y + MathCross(bodyB->angularVelocity, radiusB).y - bodyA->velocity.y - MathCross(bodyA->angularVelocity, radiusA).y;
+                if (DistSqr(start, v1) <= radius*radius)
+                    return false;
 
-        Vector2 tangent = { radiusV.x - (manifold->normal.x*MathDot(radiusV, manifold->normal)), radiusV.y - (manifold->normal.y*MathDot(radiusV, manifold->normal)) };
-        MathNormalize(&tangent);
+                float denominator = MathDot(n, dir);
 
-        // Calculate impulse tangent magnitude
-        float impulseTangent = -MathDot(radiusV, tangent);
-        impulseTangent /= inverseMassSum;
-        impulseTangent /= (float)manifold->contactsCount;
+                if ((separation > radius) && (denominator < 0.0f))
+                {
+                    float t = (radius - separation)/denominator;
+                    Vector2 point = { start.x + dir.x*t - n.x*radius, start.y + dir.y*t - n.y*radius };
+                    Vector2 edge = Vector2Subtract(v2, v1);
+                    float along = MathDot(Vector2Subtract(point, v1), edge);
 
-        float absImpulseTangent = fabs(impulseTangent);
+                    if ((along >= 0.0f) && (along <= MathLenSqr(edge)) && (t < distance))
+                    {
+                        distance = t;
+                        normal = n;
+                    }
+                }
 
-        // Don't apply tiny friction impulses
-        if (absImpulseTangent <= PHYSAC_EPSILON)
-            return;
+                // Vertex circle
+                Vector2 offset = Vector2Subtract(start, v1);
+                float b = MathDot(offset, dir);
+                float c = MathDot(offset, offset) - radius*radius;
+                float discriminant = b*b - c;
 
-        // Apply coulumb's law
-        Vector2 tangentImpulse = { 0.0f, 0.0f };
-        if (absImpulseTangent < impulse*manifold->staticFriction)
-            tangentImpulse = (Vector2){ tangent.x*impulseTangent, tangent.y*impulseTangent };
-        else
-            tangentImpulse = (Vector2){ tangent.x*-impulse*manifold->dynamicFriction, tangent.y*-impulse*manifold->dynamicFriction };
+                if ((b <= 0.0f) && (discriminant >= 0.0f))
+                {
+                    float t = -b - sqrtf(discriminant);
 
-        // Apply friction impulse
-        if (bodyA->enabled)
-        {
-            bodyA->velocity.x += bodyA->inverseMass*(-tangentImpulse.x);
-            bodyA->velocity.y += bodyA->inverseMass*(-tangentImpulse.y);
+                    if (t < distance)
+                    {
+                        distance = t;
+                        normal = (Vector2){ (offset.x + dir.x*t)/radius, (offset.y + dir.y*t)/radius };
+                    }
+                }
+            }
 
-            if (!bodyA->freezeOrient)
-                bodyA->angularVelocity += bodyA->inverseInertia*MathCrossVector2(radiusA, (Vector2){ -tangentImpulse.x, -tangentImpulse.y });
+            if (inside || (distance == PHYSAC_FLT_MAX))
+                return false;
         }
 
-        if (bodyB->enabled)
-        {
-            bodyB->velocity.x += bodyB->inverseMass*(tangentImpulse.x);
-            bodyB->velocity.y += bodyB->inverseMass*(tangentImpulse.y);
+        normal = Mat2MultiplyVector2(shape->transform, normal);
+    }
 
-            if (!bodyB->freezeOrient)
-                bodyB->angularVelocity += bodyB->inverseInertia*MathCrossVector2(radiusB, tangentImpulse);
-        }
+    *hitDistance = distance;
+    *hitNormal = normal;
+
+    return true;
+}
+
+// Inserts a hit keeping hits sorted by distance, returns hits count
+// NOTE: When hits array is full, farthest hit is dropped
+static int AddPhysicsHit(PhysicsHit *hits, int hitsCount, int maxHits, PhysicsHit hit)
+{
+    if ((hitsCount == maxHits) && (hits[hitsCount - 1].distance <= hit.distance))
+        return hitsCount;
+
+    int i = ((hitsCount < maxHits) ? hitsCount : (maxHits - 1));
+
+    while ((i > 0) && (hits[i - 1].distance > hit.distance))
+    {
+        hits[i] = hits[i - 1];
+        i--;
     }
+
+    hits[i] = hit;
+
+    return ((hitsCount < maxHits) ? (hitsCount + 1) : hitsCount);
 }
 
-// Integrates physics velocity into position and forces
-static void IntegratePhysicsVelocity(PhysicsBody body)
+// Inserts a state hit keeping hits sorted by distance, returns hits count
+// NOTE: When hits array is full, farthest hit is dropped
+static int AddPhysicsStateHit(PhysicsStateHit *hits, int hitsCount, int maxHits, PhysicsStateHit hit)
 {
-    if ((body == NULL) ||!body->enabled)
-        return;
+    if ((hitsCount == maxHits) && (hits[hitsCount - 1].distance <= hit.distance))
+        return hitsCount;
 
-    body->position.x += body->velocity.x*deltaTime;
-    body->position.y += body->velocity.y*deltaTime;
+    int i = ((hitsCount < maxHits) ? hitsCount : (maxHits - 1));
 
-    if (!body->freezeOrient)
-        body->orient += body->angularVelocity*deltaTime;
+    while ((i > 0) && (hits[i - 1].distance > hit.distance))
+    {
+        hits[i] = hits[i - 1];
+        i--;
+    }
 
-    Mat2Set(&body->shape.transform, body->orient);
+    hits[i] = hit;
 
-    IntegratePhysicsForces(body);
+    return ((hitsCount < maxHits) ? (hitsCount + 1) : hitsCount);
 }
 
-// Corrects physics bodies positions based on manifolds collision information
-static void CorrectPhysicsPositions(PhysicsManifold manifold)
+// Casts a ray (radius 0) or circle against bodies in a state last step, returns hits count
+static int CastPhysicsState(const PhysicsState *state, Vector2 origin, float radius, Vector2 direction, float maxDistance, PhysicsStateHit *hits, int maxHits)
 {
-    PhysicsBody bodyA = manifold->bodyA;
-    PhysicsBody bodyB = manifold->bodyB;
+    float length = sqrtf(MathLenSqr(direction));
 
-    if ((bodyA == NULL) || (bodyB == NULL))
-        return;
+    if ((state == NULL) || (hits == NULL) || (maxHits <= 0) || (length == 0.0f))
+        return 0;
 
-    Vector2 correction = { 0.0f, 0.0f };
-    correction.x = (max(manifold->penetration - PHYSAC_PENETRATION_ALLOWANCE, 0.0f)/(bodyA->inverseMass + bodyB->inverseMass))*manifold->normal.x*PHYSAC_PENETRATION_CORRECTION;
-    correction.y = (max(manifold->penetration - PHYSAC_PENETRATION_ALLOWANCE, 0.0f)/(bodyA->inverseMass + bodyB->inverseMass))*manifold->normal.y*PHYSAC_PENETRATION_CORRECTION;
+    direction = (Vector2){ direction.x/length, direction.y/length };
+    Vector2 inverseDirection = { 1.0f/direction.x, 1.0f/direction.y };
+    int hitsCount = 0;
+    PhysicsShape shape = { 0 };
 
-    if (bodyA->enabled)
+    for (int i = 0; i < state->bodiesCount; i++)
     {
-        bodyA->position.x -= correction.x*bodyA->inverseMass;
-        bodyA->position.y -= correction.y*bodyA->inverseMass;
+        // Reject bodies which bounding box is not crossed first, it doesn't need polygon normals
+        float enter = 0.0f;
+        float exit = ((hitsCount == maxHits) ? hits[hitsCount - 1].distance : maxDistance);
+        Vector2 boxMin = { 0.0f, 0.0f };
+        Vector2 boxMax = { 0.0f, 0.0f };
+        GetPhysicsStateBounds(state, i, &boxMin, &boxMax);
+        boxMin = (Vector2){ boxMin.x - radius, boxMin.y - radius };
+        boxMax = (Vector2){ boxMax.x + radius, boxMax.y + radius };
+
+        if (!ClipRayToBox(origin, direction, inverseDirection, boxMin, boxMax, &enter, &exit))
+            continue;
+
+        float distance = PHYSAC_FLT_MAX;
+        Vector2 normal = { 0.0f, 0.0f };
+        GetPhysicsStateShape(state, i, &shape);
+
+        if (!CastShapeData(&shape, state->bodies[i].position, origin, direction, radius, &distance, &normal) || (distance > maxDistance))
+            continue;
+
+        PhysicsStateHit hit = { i, { origin.x + direction.x*distance - normal.x*radius, origin.y + direction.y*distance - normal.y*radius }, normal, distance };
+        hitsCount = AddPhysicsStateHit(hits, hitsCount, maxHits, hit);
     }
 
-    if (bodyB->enabled)
+    return hitsCount;
+}
+
+// Builds a physics body shape from its state in last step (polygon normals are calculated again from vertices)
+static void GetPhysicsStateShape(const PhysicsState *state, int index, PhysicsShape *shape)
+{
+    const PhysicsBodyState *body = &state->bodies[index];
+
+    shape->type = body->type;
+    shape->body = NULL;
+    shape->radius = body->radius;
+    shape->transform = Mat2Radians(body->orient);
+    shape->vertexData.vertexCount = body->verticesCount;
+
+    for (unsigned int i = 0; i < body->verticesCount; i++)
     {
-        bodyB->position.x += correction.x*bodyB->inverseMass;
-        bodyB->position.y += correction.y*bodyB->inverseMass;
+        unsigned int nextIndex = (((i + 1) < body->verticesCount) ? (i + 1) : 0);
+        Vector2 face = Vector2Subtract(state->vertices[body->verticesStart + nextIndex], state->vertices[body->verticesStart + i]);
+
+        shape->vertexData.positions[i] = state->vertices[body->verticesStart + i];
+        shape->vertexData.normals[i] = (Vector2){ face.y, -face.x };
+        MathNormalize(&shape->vertexData.normals[i]);
     }
 }
 
-// Returns the extreme point along a direction within a polygon
-static Vector2 GetSupport(PhysicsShape shape, Vector2 dir)
+// Calculates a physics body axis aligned bounding box from its state in last step
+static void GetPhysicsStateBounds(const PhysicsState *state, int index, Vector2 *boundMin, Vector2 *boundMax)
 {
-    float bestProjection = -PHYSAC_FLT_MAX;
-    Vector2 bestVertex = { 0.0f, 0.0f };
-    PolygonData data = shape.vertexData;
+    const PhysicsBodyState *body = &state->bodies[index];
 
-    for (int i = 0; i < data.vertexCount; i++)
+    if (body->type == PHYSICS_CIRCLE)
     {
-        Vector2 vertex = data.positions[i];
-        float projection = MathDot(vertex, dir);
+        *boundMin = (Vector2){ body->position.x - body->radius, body->position.y - body->radius };
+        *boundMax = (Vector2){ body->position.x + body->radius, body->position.y + body->radius };
+    }
+    else
+    {
+        Mat2 transform = Mat2Radians(body->orient);
+        *boundMin = (Vector2){ PHYSAC_FLT_MAX, PHYSAC_FLT_MAX };
+        *boundMax = (Vector2){ -PHYSAC_FLT_MAX, -PHYSAC_FLT_MAX };
 
-        if (projection > bestProjection)
+        for (unsigned int i = 0; i < body->verticesCount; i++)
         {
-            bestVertex = vertex;
-            bestProjection = projection;
+            Vector2 vertex = Vector2Add(body->position, Mat2MultiplyVector2(transform, state->vertices[body->verticesStart + i]));
+
+            boundMin->x = min(boundMin->x, vertex.x);
+            boundMin->y = min(boundMin->y, vertex.y);
+            boundMax->x = max(boundMax->x, vertex.x);
+            boundMax->y = max(boundMax->y, vertex.y);
         }
     }
+}
 
-    return bestVertex;
+// Returns true if a body shape contains a point
+static bool BodyContainsPoint(unsigned int index, Vector2 point)
+{
+    PhysicsBody body = bodies[index];
+
+    return ShapeContainsPoint(&body->shape, body->position, point);
 }
 
-// Finds polygon shapes axis least penetration
-static float FindAxisLeastPenetration(int *faceIndex, PhysicsShape shapeA, PhysicsShape shapeB)
+// Returns true if a shape at a position contains a point
+static bool ShapeContainsPoint(const PhysicsShape *shape, Vector2 position, Vector2 point)
 {
-    float bestDistance = -PHYSAC_FLT_MAX;
-    int bestIndex = 0;
+    if (shape->type == PHYSICS_CIRCLE)
+        return (DistSqr(point, position) <= shape->radius*shape->radius);
 
-    PolygonData dataA = shapeA.vertexData;
+    const PolygonData *data = &shape->vertexData;
+    Vector2 local = Mat2MultiplyVector2(Mat2Transpose(shape->transform), Vector2Subtract(point, position));
 
-    for (int i = 0; i < dataA.vertexCount; i++)
+    for (unsigned int i = 0; i < data->vertexCount; i++)
     {
-        // Retrieve a face normal from A shape
-        Vector2 normal = dataA.normals[i];
-        Vector2 transNormal = Mat2MultiplyVector2(shapeA.transform, normal);
+        if (MathDot(data->normals[i], Vector2Subtract(local, data->positions[i])) > 0.0f)
+            return false;
+    }
 
-        // Transform face normal into B shape's model space
-        Mat2 buT = Mat2Transpose(shapeB.transform);
-        normal = Mat2MultiplyVector2(buT, transNormal);
+    return true;
+}
 
-        // Retrieve support point from B shape along -n
-        Vector2 support = GetSupport(shapeB, (Vector2){ -normal.x, -normal.y });
+// Finds overlapping pairs with sweep and prune along x axis
+// NOTE: Bodies order is kept between steps, so insertion sort only moves bodies which passed each other
+static void FindPairsSweepAndPrune(void)
+{
+    // Physics bodies were created or destroyed, start again from bodies array order
+    if (sapCount != physicsBodiesCount)
+    {
+        for (unsigned int i = 0; i < physicsBodiesCount; i++)
+            sapOrder[i] = i;
 
-        // Retrieve vertex on face from A shape, transform into B shape's model space
-        Vector2 vertex = dataA.positions[i];
-        vertex = Mat2MultiplyVector2(shapeA.transform, vertex);
-        vertex = Vector2Add(vertex, shapeA.body->position);
-        vertex = Vector2Subtract(vertex, shapeB.body->position);
-        vertex = Mat2MultiplyVector2(buT, vertex);
+        sapCount = physicsBodiesCount;
+    }
 
-        // Compute penetration distance in B shape's model space
-        float distance = MathDot(normal, Vector2Subtract(support, vertex));
+    // Sort bodies by bounding box minimum x
+    for (unsigned int i = 1; i < sapCount; i++)
+    {
+        unsigned int index = sapOrder[i];
+        float minX = boundsMin[index].x;
+        int j = i - 1;
 
-        // Store greatest distance
-        if (distance > bestDistance)
+        while ((j >= 0) && (boundsMin[sapOrder[j]].x > minX))
         {
-            bestDistance = distance;
-            bestIndex = i;
+            sapOrder[j + 1] = sapOrder[j];
+            j--;
         }
+
+        sapOrder[j + 1] = index;
     }
 
-    *faceIndex = bestIndex;
-    return bestDistance;
+    // Sweep bodies along x axis, testing only bodies which x interval overlaps
+    for (unsigned int i = 0; i < sapCount; i++)
+    {
+        unsigned int a = sapOrder[i];
+
+        for (unsigned int j = i + 1; (j < sapCount) && (boundsMin[sapOrder[j]].x <= boundsMax[a].x); j++)
+        {
+            unsigned int b = sapOrder[j];
+
+            if ((boundsMin[a].y > boundsMax[b].y) || (boundsMin[b].y > boundsMax[a].y))
+                continue;
+
+            AddBroadphasePair(min(a, b), max(a, b));
+        }
+    }
 }
 
-// Finds two polygon shapes incident face
-static void FindIncidentFace(Vector2 *v0, Vector2 *v1, PhysicsShape ref, PhysicsShape inc, int index)
+// Adds pair of bodies to test for collision
+static void AddBroadphasePair(unsigned int a, unsigned int b)
 {
-    PolygonData refData = ref.vertexData;
-    PolygonData incData = inc.vertexData;
+    // Static bodies never collide with each other
+    if ((bodies[a]->inverseMass == 0) && (bodies[b]->inverseMass == 0))
+        return;
 
-    Vector2 referenceNormal = refData.normals[index];
+    broadphasePairs = (unsigned int *)GrowArray(broadphasePairs, &broadphasePairsCapacity, broadphasePairsCount + 1, sizeof(unsigned int)*2);
+    broadphasePairs[broadphasePairsCount*2] = a;
+    broadphasePairs[broadphasePairsCount*2 + 1] = b;
+    broadphasePairsCount++;
+}
 
-    // Calculate normal in incident's frame of reference
-    referenceNormal = Mat2MultiplyVector2(ref.transform, referenceNormal); // To world space
-    referenceNormal = Mat2MultiplyVector2(Mat2Transpose(inc.transform), referenceNormal); // To incident's model space
+// Returns array with room for count elements (moves data if needed)
+static void *GrowArray(void *data, unsigned int *capacity, unsigned int count, unsigned int size)
+{
+    if (count <= *capacity)
+        return data;
 
-    // Find most anti-normal face on polygon
-    int incidentFace = 0;
-    float minDot = PHYSAC_FLT_MAX;
+    unsigned int newCapacity = max(max(*capacity*2, count), 64);
+    void *newData = ResizeArray(data, *capacity, newCapacity, size);
 
-    for (int i = 0; i < incData.vertexCount; i++)
-    {
-        float dot = MathDot(referenceNormal, incData.normals[i]);
+    *capacity = newCapacity;
 
-        if (dot < minDot)
-        {
-            minDot = dot;
-            incidentFace = i;
-        }
+    return newData;
+}
+
+// Returns new array of newCount elements with first count elements of data
+static void *ResizeArray(void *data, unsigned int count, unsigned int newCount, unsigned int size)
+{
+    void *newData = PHYSAC_MALLOC(newCount*size);
+
+    if (data != NULL)
+    {
+        memcpy(newData, data, count*size);
+        PHYSAC_FREE(data);
     }
 
-    // Assign face vertices for incident face
-    *v0 = Mat2MultiplyVector2(inc.transform, incData.positions[incidentFace]);
-    *v0 = Vector2Add(*v0, inc.body->position);
-    incidentFace = (((incidentFace + 1) < incData.vertexCount) ? (incidentFace + 1) : 0);
-    *v1 = Mat2MultiplyVector2(inc.transform, incData.positions[incidentFace]);
-    *v1 = Vector2Add(*v1, inc.body->position);
+    return newData;
 }
 
-// Calculates clipping based on a normal and two faces
-static int Clip(Vector2 normal, float clip, Vector2 *faceA, Vector2 *faceB)
+// Returns best SIMD instructions supported by CPU and operating system
+static PhysicsSimdType DetectPhysicsSimd(void)
 {
-    int sp = 0;
-    Vector2 out[2] = { *faceA, *faceB };
+    PhysicsSimdType result = PHYSICS_SIMD_NONE;
 
-    // Retrieve distances from each endpoint to the line
-    float distanceA = MathDot(normal, *faceA) - clip;
-    float distanceB = MathDot(normal, *faceB) - clip;
+#if defined(PHYSAC_SIMD_SSE2)
+    result = PHYSICS_SIMD_SSE2;
+#endif
 
-    // If negative (behind plane)
-    if (distanceA <= 0.0f)
-        out[sp++] = *faceA;
+#if defined(PHYSAC_SIMD_AVX2)
+    bool osxsave = false;
+    bool avx = false;
+    bool avx2 = false;
+    unsigned long long xcr0 = 0;
 
-    if (distanceB <= 0.0f)
-        out[sp++] = *faceB;
+    #if defined(_MSC_VER)
+        int info[4] = { 0 };
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
 
-    // If the points are on different sides of the plane
-    if ((distanceA*distanceB) < 0.0f)
-    {
-        // Push intersection point
-        float alpha = distanceA/(distanceA - distanceB);
-        out[sp] = *faceA;
-        Vector2 delta = Vector2Subtract(*faceB, *faceA);
-        delta.x *= alpha;
-        delta.y *= alpha;
-        out[sp] = Vector2Add(out[sp], delta);
-        sp++;
-    }
+        __cpuid(info, 1);
+        osxsave = ((info[2] & (1 << 27)) != 0);
+        avx = ((info[2] & (1 << 28)) != 0);
 
-    // Assign the new converted values
-    *faceA = out[0];
-    *faceB = out[1];
+        if (maxLeaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = ((info[1] & (1 << 5)) != 0);
+        }
 
-    return sp;
-}
+        if (osxsave)
+            xcr0 = _xgetbv(0);
+    #else
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
 
-// Check if values are between bias range
-static bool BiasGreaterThan(float valueA, float valueB)
-{
-    return (valueA >= (valueB*0.95f + valueA*0.01f));
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        {
+            osxsave = ((ecx & (1 << 27)) != 0);
+            avx = ((ecx & (1 << 28)) != 0);
+        }
+
+        if (__get_cpuid_max(0, NULL) >= 7)
+        {
+            __cpuid_count(7, 0, eax, ebx, ecx, edx);
+            avx2 = ((ebx & (1 << 5)) != 0);
+        }
+
+        if (osxsave)
+        {
+            unsigned int low = 0, high = 0;
+            __asm__ __volatile__ ("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+            xcr0 = ((unsigned long long)high << 32) | low;
+        }
+    #endif
+
+    // Operating system must save SSE and AVX registers state (XCR0 bits 1 and 2)
+    if (osxsave && avx && avx2 && ((xcr0 & 6) == 6))
+        result = PHYSICS_SIMD_AVX2;
+#endif
+
+    return result;
 }
 
 // Returns the barycenter of a triangle given by 3 points
@@ -2104,11 +5309,56 @@ static inline Vector2 Vector2Subtract(Vector2 v1, Vector2 v2)
 }
 #endif
 
+#if defined(PHYSAC_DETERMINISTIC)
+// Returns the sine of an angle given in turns, only using float additions and multiplications
+static float MathSinTurns(float turns)
+{
+    // Angle is reduced to [-1/8, 1/8] turns from the nearest quarter turn, where Taylor polynomials are exact in float precision
+    float quarters = floorf(turns*4.0f + 0.5f);
+    float x = (turns - quarters*0.25f)*6.28318530718f;
+    float x2 = x*x;
+    float sine = x*(1.0f + x2*(-1.66666667e-1f + x2*(8.33333333e-3f + x2*(-1.98412698e-4f + x2*2.75573192e-6f))));
+    float cosine = 1.0f + x2*(-0.5f + x2*(4.16666667e-2f + x2*(-1.38888889e-3f + x2*2.48015873e-5f)));
+
+    switch ((int)(quarters - 4.0f*floorf(quarters*0.25f)))
+    {
+        case 0: return sine;
+        case 1: return cosine;
+        case 2: return -sine;
+        default: return -cosine;
+    }
+}
+
+// Returns the sine of an angle
+static float MathSin(float radians)
+{
+    return MathSinTurns(radians*0.159154943092f);
+}
+
+// Returns the cosine of an angle
+static float MathCos(float radians)
+{
+    return MathSinTurns(radians*0.159154943092f + 0.25f);
+}
+#else
+// Returns the sine of an angle
+static float MathSin(float radians)
+{
+    return sinf(radians);
+}
+
+// Returns the cosine of an angle
+static float MathCos(float radians)
+{
+    return cosf(radians);
+}
+#endif
+
 // Creates a matrix 2x2 from a given radians value
 static Mat2 Mat2Radians(float radians)
 {
-    float c = cosf(radians);
-    float s = sinf(radians);
+    float c = MathCos(radians);
+    float s = MathSin(radians);
 
     return (Mat2){ c, -s, s, c };
 }
@@ -2116,8 +5366,8 @@ static Mat2 Mat2Radians(float radians)
 // Set values from radians to a created matrix 2x2
 static void Mat2Set(Mat2 *matrix, float radians)
 {
-    float cos = cosf(radians);
-    float sin = sinf(radians);
+    float cos = MathCos(radians);
+    float sin = MathSin(radians);
 
     matrix->m00 = cos;
     matrix->m01 = -sin;
@@ -2137,4 +5387,19 @@ static inline Vector2 Mat2MultiplyVector2(Mat2 matrix, Vector2 vector)
     return (Vector2){ matrix.m00*vector.x + matrix.m01*vector.y, matrix.m10*vector.x + matrix.m11*vector.y };
 }
 
+// Code after implementation is fused as set by compiler options again
+#if defined(PHYSAC_NO_FP_CONTRACT)
+    #if defined(__clang__)
+        #pragma STDC FP_CONTRACT DEFAULT
+    #elif defined(__GNUC__)
+        #pragma GCC pop_options
+    #elif defined(_MSC_VER)
+        // MSVC has no pragma to restore command line setting, so it is told by /fp:contract and /fp:fast macros
+        // (before Visual Studio 2022 /fp:precise fused them too)
+        #if defined(_M_FP_CONTRACT) || defined(_M_FP_FAST) || (_MSC_VER < 1930)
+            #pragma fp_contract (on)
+        #endif
+    #endif
+#endif
+
 #endif  // PHYSAC_IMPLEMENTATION
@@ -12,6 +12,29 @@
 #define EXIT_WITH_ESCAPE                // Allows to exit game with escape key
 #define WINDOW_RESIZABLE                // Allows window to be resizable
 #define DEBUGGING_ENABLED               // Enables debugging via logmsg function
+#define LOG_LEVEL LOG_DEBUG             // Messages below this level are stripped at compile time (LOG_TRACE, LOG_DEBUG, LOG_INFO, LOG_WARNING, LOG_ERROR)
+#define LOG_RING_SIZE 1024              // Messages each thread can queue before logger drops them
+#define LOG_RATE_LIMIT 100              // Max times same message logged per second (Rest are counted as suppressed)
+#define TEXTURE_CACHE_SIZE 1024         // Max textures kept loaded in texture cache at once
+#define SPRITE_BATCH_SIZE 65536         // Max sprites queued before sprite batch gets flushed
+#define ATLAS_PAGE_SIZE 2048            // Width and height of texture atlas pages
+#define ATLAS_MAX_PAGES 8               // Max texture atlas pages
+#define FONT_ATLAS_SIZE 1024            // Width and height of glyphs atlas baked for each font
+#define TEXT_CACHE_SIZE 1024            // Max text layouts kept cached for draw_ttf_text
+#define SOUND_BANK_SIZE 256             // Max sounds kept decoded in sound bank
+#define SOUND_VOICES 32                 // Max sound bank sounds playing at once (Lowest priority voice stolen after that)
+#define STORAGE_COMPACT_SIZE 65536      // Min bytes of overwritten records in game.data before compacting it
+#define PHYSICS_THREAD                  // Step physics on its own thread (Needs pthreads, Without it or with MSVC physics steps in game loop)
+// #define SERVER_BUILD                 // Run as headless server even without --server (Set by CMake option SERVER_BUILD, Which builds GLFW null platform)
+#define SERVER_CHANNELS 2               // ENet channels of connections to headless server
+#define NET_QUEUE_SIZE 4096             // Events queued each way between game and network thread (Power of 2)
+#define NET_SPARE_PACKETS 1024          // Empty packets network thread keeps ready for net_packet (Power of 2)
+#define NET_PACKET_SIZE 1200            // Size of packets kept ready for net_packet (Bigger packets get allocated when taken)
+#define NET_DICTIONARY_SIZE 8192        // Max bytes of typical packet data compression dictionary keeps (Below 60000)
+#define SNAPSHOT_MAX_ENTITIES 1024      // Max entities replicated with snapshots (Entity ids are below it, Multiple of 32)
+#define SNAPSHOT_HISTORY 32             // Snapshots kept as delta baselines (Peers acknowledging none of them get full snapshot)
+#define SNAPSHOT_CHANNEL 1              // ENet channel snapshots and their acknowledgements are sent on (Below SERVER_CHANNELS)
+#define SNAPSHOT_MAX_HELD 128           // Entities each snapshot may hold back from peer to stay within bandwidth (More get sent anyway)
 
 
 //////////////////////////////////////////////////////////////////////////////////////
@@ -24,8 +47,40 @@
 #define TINYOBJ_LOADER_C_IMPLEMENTATION	 // Implement tinyobjloader-c library
 #define PHYSAC_IMPLEMENTATION            // Implement Physac
 #define PHYSAC_STANDALONE                // Use Physac standalone without using raylib
-#define PHYSAC_NO_THREADS                // Use Physac with no threads
 #define PHYSAC_STATIC                    // Allow to build Physac as static library
+#if !defined(PHYSICS_THREAD) || defined(_MSC_VER)
+#define PHYSAC_NO_THREADS                // Use Physac with no threads (Physics steps in game loop, MSVC has no pthreads)
+#endif
+#define LOG_TRACE 0                      // Log level for messages logged every frame
+#define LOG_DEBUG 1                      // Log level for debugging messages (logmsg)
+#define LOG_INFO 2                       // Log level for informative messages
+#define LOG_WARNING 3                    // Log level for warnings
+#define LOG_ERROR 4                      // Log level for errors
+#define LOG_MAX_THREADS 64               // Max threads which can log messages
+#define LOG_MAX_FORMATS 1024             // Max different format strings logger can give ids to (By text, Others are printed directly)
+#define LOG_FORMAT_CACHE 64              // Format strings each thread remembers ids of by pointer (Not hashed again)
+#define ATLAS_BUCKETS 1024               // Hash buckets of atlas entries (More entries share buckets)
+#define TEXT_CACHE_WAYS 4                // Layouts in each set of text cache (Texts of same set replace least recently used one)
+#define STORAGE_MAGIC 0x31445347         // First 4 bytes of game.data ("GSD1")
+#define STORAGE_REMOVED 0xFFFFFFFF       // Storage record size marking variable as removed
+#define NET_BLOCK_CLASSES 8              // Size classes of ENet memory blocks (64 bytes doubling up to 8 kilobytes)
+#define NET_COMPRESS_HASH_BITS 12        // Entries of compressor match table (2 ^ bits)
+#define NET_COMPRESS_MIN_MATCH 4         // Shortest match compressor writes (In bytes)
+#define NET_COMPRESS_INPUT 4096          // Largest datagram compressor takes (ENET_PROTOCOL_MAXIMUM_MTU)
+#define BITPACK_VARINT_BITS 4            // Value bits in each varint group (Each group takes one more bit telling if more groups follow)
+#define SNAPSHOT_FIELDS 7                // Quantized fields of each snapshot entity
+#define SNAPSHOT_ANGLE_STEPS 4096        // Steps entity angle quantized to in snapshots (Power of 2)
+#define SNAPSHOT_GRID_BUCKETS 4096       // Buckets interest grid cells are hashed into (Power of 2)
+#define SNAPSHOT_GRID_SPAN 32            // Max cells across area searched in interest grid (Bigger areas check all entities)
+#define SNAPSHOT_INTEREST_MARGIN 1.25f   // Entities peer has leave its area only beyond this times its radius (No flickering at edge)
+
+
+// Thread local storage (Each thread logs into its own queue)
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
 
 
 // Implement bool type when not found
@@ -71,6 +126,17 @@ typedef struct spritefont {
 } spritefont;
 
 
+typedef struct font {
+    unsigned int id;                // OpenGL texture id of glyphs atlas (0 if font failed to load)
+    float size;                     // Font height (In pixels)
+    float ascent;                   // Distance from top of text to baseline (In pixels)
+    float line_height;              // Distance between lines of text (In pixels)
+    void* glyphs;                   // Glyphs packed into glyphs atlas (stbtt_packedchar)
+    void* info;                     // Font info, Used for kerning (stbtt_fontinfo)
+    unsigned char* data;            // Font file content (Needed by font info)
+} font;
+
+
 typedef struct color {
     unsigned int r;                 // Red (0 - 255)
     unsigned int g;                 // Green (0 - 255)
@@ -79,12 +145,221 @@ typedef struct color {
 } color;
 
 
+typedef struct sound {
+    unsigned int id;                // Sound bank entry + 1 (0 if sound failed to load)
+    unsigned long long frames;      // Sound length (In PCM frames)
+} sound;
+
+
+typedef struct sound_bank_entry {
+    char* src;                      // Sound source file (NULL if entry is free)
+    unsigned int hash;              // Hash of sound source file
+    float* frames;                  // Decoded PCM frames (In audio engine format)
+    unsigned long long frame_count; // Decoded PCM frames count
+    int next;                       // Next entry in same hash bucket + 1 (0 if last)
+} sound_bank_entry;
+
+
+typedef struct texture {
+    unsigned int id;                // OpenGL texture id (0 if texture failed to load)
+    int width;                      // Texture width
+    int height;                     // Texture height
+} texture;
+
+
+typedef struct texture_cache_entry {
+    char* src;                      // Texture source file (NULL if entry is free)
+    unsigned int hash;              // Hash of texture source file
+    texture tex;                    // Loaded texture (Id 0 if source failed to load, Kept so it isn't decoded again)
+    unsigned long size;             // Texture size in video memory (In bytes)
+    int refs;                       // References taken by load_texture (Entry never evicted while > 0)
+    unsigned long last_used;        // Frame texture was last drawn in (For LRU eviction)
+    int next;                       // Next entry in same hash bucket + 1 (0 if last)
+    int lru_prev;                   // Previous entry in LRU list + 1 (0 if first, Entries with references aren't in list)
+    int lru_next;                   // Next entry in LRU list + 1 (0 if last)
+} texture_cache_entry;
+
+
+typedef struct sprite_vertex {
+    float x;                        // Vertex x
+    float y;                        // Vertex y
+    float u;                        // Texture coordinate x
+    float v;                        // Texture coordinate y
+    unsigned char r;                // Tint red (0 - 255)
+    unsigned char g;                // Tint green (0 - 255)
+    unsigned char b;                // Tint blue (0 - 255)
+    unsigned char a;                // Tint alpha (0 - 255)
+} sprite_vertex;
+
+
+typedef struct log_record {
+    double time;                    // Time message logged at (In seconds since logger started)
+    unsigned short id;              // Format string id
+    unsigned char level;            // Log level
+    unsigned int suppressed;        // Same messages suppressed by rate limit before this one
+    unsigned int dropped;           // Messages of same thread dropped before this one because queue was full
+    char args[2][112];              // Format string arguments (Truncated to fit)
+} log_record;
+
+
+typedef struct log_ring {
+    volatile unsigned int head;     // Records written by thread logging (Only that thread writes it)
+    volatile unsigned int tail;     // Records written out by logger thread (Only logger thread writes it)
+    unsigned int dropped;           // Records dropped because ring was full (Since last record queued)
+    log_record records[LOG_RING_SIZE]; // Queued records
+} log_ring;
+
+
+typedef struct storage_entry {
+    unsigned int position;          // Variable position
+    unsigned int size;              // Value length
+    char* value;                    // Value saved (NULL if slot is free)
+    bool pending;                   // Saved but not yet written to game.data by storage thread
+} storage_entry;
+
+
+typedef struct text_layout {
+    char* text;                     // Text laid out (NULL if layout is free)
+    unsigned int hash;              // Hash of text
+    unsigned int font_id;           // Font text laid out with
+    int count;                      // Glyphs in text
+    float* quads;                   // Glyphs positions and texture coordinates relative to text position (8 per glyph)
+    float width;                    // Text width (In pixels)
+    unsigned long last_used;        // Text cache use layout was last used in (For LRU replacement in its set)
+} text_layout;
+
+
+typedef struct atlas_entry {
+    char* src;                      // Image source file packed into atlas
+    unsigned int hash;              // Hash of image source file
+    int page;                       // Atlas page image packed into
+    rect rec;                       // Image rectangle in atlas page (In pixels)
+    int next;                       // Next entry in same hash bucket + 1 (0 if last)
+} atlas_entry;
+
+
+typedef struct net_event {
+    int type;                       // NET_CONNECT, NET_DISCONNECT or NET_RECEIVE (Commands to network thread are NET_SEND, NET_BROADCAST, NET_RELEASE or NET_DISCONNECT)
+    unsigned int peer;              // Peer index (Same while peer connected, Use it to keep per client data)
+    unsigned int channel;           // Channel packet received or sent on
+    struct _ENetPacket* packet;     // Packet received or to send (NULL if none)
+    double time;                    // When network thread received event (In seconds, Compare with net_time)
+    unsigned int bandwidth;         // Incoming bandwidth limit of peer host on NET_CONNECT (In bytes per second, 0 if unlimited)
+} net_event;
+
+
+typedef struct net_ring {
+    volatile unsigned int head;     // Events pushed (Only producer thread writes it)
+    volatile unsigned int tail;     // Events taken (Only consumer thread writes it)
+    net_event events[NET_QUEUE_SIZE]; // Queued events
+} net_ring;
+
+
+typedef struct bitpack {
+    unsigned char* data;            // Buffer bits are written into or read from
+    unsigned long size;             // Buffer size (In bytes)
+    unsigned long position;         // Bytes of buffer written or read
+    unsigned long long scratch;     // Bits not written to buffer yet, Or read from it but not taken yet
+    int scratch_bits;               // Bits in scratch
+    bool overflow;                  // Wrote or read past end of buffer (Data is invalid then)
+} bitpack;
+
+
+typedef struct snapshot_entity {
+    float x;                        // Position x
+    float y;                        // Position y
+    float vx;                       // Velocity x (Lets clients extrapolate between snapshots)
+    float vy;                       // Velocity y
+    float angle;                    // Rotation (In radians)
+    unsigned int type;              // Entity type (Game defined)
+    unsigned int state;             // Entity state (Game defined, Like animation or health)
+} snapshot_entity;
+
+
+typedef struct snapshot_frame {
+    unsigned int sequence;          // Snapshot sequence (0 if frame unused)
+    unsigned int tick;              // Update snapshot captured at (update_count of server)
+    unsigned int present[SNAPSHOT_MAX_ENTITIES / 32]; // Bit per entity in snapshot
+    int fields[SNAPSHOT_MAX_ENTITIES][SNAPSHOT_FIELDS]; // Quantized entities (Position, Velocity, Angle, Type and State)
+} snapshot_frame;
+
+
+typedef struct snapshot_view {
+    unsigned int present[SNAPSHOT_MAX_ENTITIES / 32]; // Bit per entity peer has in snapshot
+    unsigned int held_count;        // Entities held back from peer in snapshot
+    unsigned short held[SNAPSHOT_MAX_HELD]; // Ids of entities held back (Ascending, Peer predicted them from baseline)
+    int fields[SNAPSHOT_MAX_HELD][SNAPSHOT_FIELDS]; // Fields of entities held back as peer predicted them
+} snapshot_view;
+
+
+typedef struct snapshot_peer {
+    bool connected;                 // Peer connected (Snapshots sent to it)
+    unsigned int acked;             // Newest snapshot peer acknowledged (0 if none, Baseline of next snapshot sent to it)
+    unsigned int sent[SNAPSHOT_HISTORY]; // Sequences of snapshots sent to peer, By sequence (Acknowledgements of others ignored)
+    unsigned int bandwidth;         // Incoming bandwidth limit of peer host (In bytes per second, 0 if unlimited)
+    float x;                        // Center of area peer gets entities in
+    float y;
+    float radius;                   // Radius of area peer gets entities in (0 for all entities)
+    double budget;                  // Bits peer may still get, Refilled each snapshot by its bandwidth
+    float priority[SNAPSHOT_MAX_ENTITIES]; // Priority of entities waiting to be sent to peer, Grows each snapshot they wait
+    struct snapshot_view* views;    // What peer has in each snapshot sent to it, By sequence (Allocated when first sent)
+} snapshot_peer;
+
+
+typedef struct snapshot_candidate {
+    float priority;                 // Priority entity sent with
+    unsigned short id;              // Entity id
+    unsigned short bits;            // Bits entity takes in snapshot
+} snapshot_candidate;
+
+
+typedef struct net_compressor {
+    unsigned int table[1 << NET_COMPRESS_HASH_BITS]; // Last position of each 4 byte hash (Positions below base belong to earlier datagrams)
+    unsigned int base;              // Position of first byte of datagram being compressed (Grows with each datagram)
+    unsigned char input[NET_COMPRESS_INPUT]; // Datagram gathered from ENet buffers
+} net_compressor;
+
+
+typedef union net_block {
+    union net_block* next;          // Next free block of same size class (While block is free)
+    int size_class;                 // Size class of block (While block is used, -1 if allocated from system directly)
+    double align;                   // Keeps memory after block header aligned
+} net_block;
+
+
+enum {
+    BLEND_ALPHA,                    // Blend sprites using their alpha (Default)
+    BLEND_ADDITIVE,                 // Add sprites colors to what's behind them
+    BLEND_MULTIPLY,                 // Multiply sprites colors with what's behind them
+};
+
+
+enum {
+    STORAGE_SYNC_SAVE,              // Sync game.data to disk as soon as saves written (Safest, Slowest)
+    STORAGE_SYNC_INTERVAL,          // Write and sync saves gathered over storage_sync_interval (Default)
+    STORAGE_SYNC_CLOSE,             // Write saves as soon as possible, Sync game.data only when storage closes
+};
+
+
+enum {
+    NET_CONNECT = 1,                // Peer connected
+    NET_DISCONNECT,                 // Peer disconnected or timed out (Or command to disconnect peer)
+    NET_RECEIVE,                    // Packet received from peer
+    NET_SEND,                       // Command to send packet to peer
+    NET_BROADCAST,                  // Command to send packet to all peers
+    NET_RELEASE,                    // Command to destroy packet
+};
+
+
 //////////////////////////////////////////////////////////////////////////////////////
 // Includings: Libraries to work within your game
 //////////////////////////////////////////////////////////////////////////////////////
 #include <stdio.h>                       // C Standard IO library
 #include <stdlib.h>                      // C Standard library
 #include <string.h>                      // C String library
+#include <stddef.h>                      // C Standard definitions (offsetof)
+#include <math.h>                        // C Math library
+#include <signal.h>                      // C Signals library (Stops headless server)
 #include <glad/glad.h>                   // GLAD library (OpenGL loader)
 #include <GLFW/glfw3.h>                  // GLFW library (Window and Input)
 #include <miniaudio/miniaudio.h>         // miniaudio library (For audio)
@@ -94,6 +369,9 @@ typedef struct color {
 #include <stb/stb_truetype.h>            // stb_truetype (TTF and text)
 #include <stb/stb_image.h>               // stb_image (Texture rendering)
 #include <enet/enet.h>                   // ENet library (reliable UDP networking library)
+#if defined(_WIN32)
+#include <io.h>                          // _commit (Syncs game.data to disk)
+#endif
 
 
 //////////////////////////////////////////////////////////////////////////////////////
@@ -103,7 +381,24 @@ int window_width = 800;                 // Game window width
 int window_height = 450;                // Game window height
 bool window_fullscreen = false;         // Game fullscreen?
 const char* window_title = "MYGAME";    // Game window title
-int game_fps = 60;                      // Game frames per second
+bool log_binary = false;                // Write logs to game.log as format ids with arguments instead of text (Decode with --decode-log)
+int game_fps = 60;                      // Game frames per second (Frame limiter target without VSync, 0 for unlimited)
+int game_tps = 60;                      // Game updates per second (Fixed time step of update and input)
+size_t texture_cache_budget = 256 * 1024 * 1024; // Max video memory used by texture cache (In bytes)
+bool sprite_batch_sort = false;         // Sort sprites by texture and blend mode to reduce draw calls (Ignores draw order)
+int storage_sync = STORAGE_SYNC_INTERVAL; // When saves get synced to disk (STORAGE_SYNC_SAVE, STORAGE_SYNC_INTERVAL or STORAGE_SYNC_CLOSE)
+int storage_sync_interval = 1000;       // Time saves gather before storage thread writes and syncs them (In milliseconds)
+int physics_threads = 4;                // Threads solving physics islands, Including the one running physics step (Physics results are the same for any count)
+bool server_mode = false;               // Run as headless server without window, OpenGL and audio (Set by --server argument or SERVER_BUILD)
+int server_port = 7777;                 // Port headless server listens on
+int server_max_peers = 512;             // Max clients connected to headless server at once
+bool net_compression = true;            // Compress datagrams with LZ compressor (Server and clients must agree, See net_dictionary)
+bool net_record = false;                // Write datagrams sent to net.trace before compressing them (Prime dictionary with it using net_dictionary_load)
+unsigned int net_incoming_bandwidth = 0; // Incoming bandwidth limit of host told to peers, Server sends snapshots within it (In bytes per second, 0 if unlimited)
+unsigned int net_outgoing_bandwidth = 0; // Outgoing bandwidth limit of host, Server splits it among peers (In bytes per second, 0 if unlimited)
+float snapshot_precision = 0.01f;       // Precision of entities position and velocity in snapshots (In world units)
+unsigned int snapshot_bandwidth = 0;    // Max bytes per second of snapshots to each peer (0 for no limit besides net bandwidth limits)
+float snapshot_cell_size = 64.0f;       // Size of interest grid cells (In world units, About radius of peers area works best)
 int error_code;                         // Error code if game failed to do something
 char* error_description;                // Error description if game failed to do something
 
@@ -116,14 +411,130 @@ GLFWvidmode* window_video_mode;	        // GLFW Window video mode
 double t1;                              // First time
 double t2;                              // Second time
 double dt;                              // DeltaTime (Can be used, Useful...)
+double frame_alpha;                     // How far rendering is between last two updates (0 - 1), Use in draw to interpolate
+const PhysicsState* physics_state;      // Bodies state last published by physics thread (Bodies must only be changed with QueuePhysics* functions)
+float physics_alpha;                    // How far rendering is between last two physics steps (0 - 1), Use in draw with GetPhysicsStatePosition
+double update_accumulator;              // Time not yet consumed by fixed updates
+unsigned long frame_count;              // Frames rendered since game started
+unsigned long update_count;             // Updates ran since game started (Server time of snapshots)
+double frame_time;                      // Time taken by last frame (In seconds)
+double frame_time_avg;                  // Average frame time (In seconds)
+double frame_time_variance;             // Frame time variance (In seconds squared, Lower means smoother pacing)
+double frame_sleep_slack;               // How much sleeping overshoots (In seconds, Frame limiter spins for that long instead)
+int swap_interval;                      // Display refreshes each buffer swap waits for (1 with VSync, Frame limiter only runs if 0)
+volatile sig_atomic_t server_running;   // Headless server running (Cleared by SIGINT or SIGTERM to close it)
+double server_tick_late;                // How late last server tick started (In seconds)
+double server_tick_late_avg;            // Average server tick lateness (In seconds)
+double server_tick_late_max;            // Max server tick lateness since server started (In seconds)
 
 int* glfw_window_width;                 // Pointer to game window width when created
 int* glfw_window_height;                // Pointer to game window height when created
 int* glfw_window_x;                     // Pointer to game window x position when created
 int* glfw_window_y;                     // Pointer to game window y position when created
 
-FILE* game_data;                        // File to write game data to...
+FILE* game_data;                        // File to write game data to... (Records appended by storage thread, Open after storage_init)
 char loaded_variable_value[256];        // Temp string to return game loaded variable from...
+storage_entry* storage_index;           // Saved variables, Keyed by position
+unsigned int storage_capacity;          // Slots in storage index (Power of 2)
+unsigned int storage_count;             // Variables saved
+unsigned long storage_size;             // Size of game.data (In bytes)
+unsigned long storage_garbage;          // Bytes of overwritten and removed records in game.data (Dropped by compaction)
+unsigned int* storage_pending;          // Positions saved or removed since storage thread last wrote
+unsigned int storage_pending_count;     // Positions saved or removed since storage thread last wrote
+unsigned int storage_pending_capacity;  // Max positions storage_pending can hold before growing
+unsigned char* storage_buffer;          // Records serialized by storage thread, Written with one call
+unsigned long storage_buffer_size;      // Bytes serialized in storage buffer
+unsigned long storage_buffer_capacity;  // Max bytes storage buffer can hold before growing
+bool storage_snapshot;                  // Storage thread should write snapshot of all variables instead of appending
+volatile unsigned int storage_running;  // Storage thread running (Storage initialized)
+ma_thread storage_thread;               // Storage thread, Writes saves to game.data
+ma_mutex storage_lock;                  // Guards storage index and pending positions between game and storage thread
+ma_event storage_event;                 // Signaled to wake storage thread
+
+texture_cache_entry texture_cache[TEXTURE_CACHE_SIZE];  // Loaded textures, Keyed by source file
+int texture_cache_buckets[TEXTURE_CACHE_SIZE];          // Hash buckets of texture cache (First entry + 1, 0 if empty)
+int texture_cache_lru_first;            // Least recently drawn texture cache entry + 1 (Evicted first, 0 if none)
+int texture_cache_lru_last;             // Most recently drawn texture cache entry + 1 (0 if none)
+size_t texture_cache_used;              // Video memory used by texture cache (In bytes)
+unsigned long texture_cache_hits;       // Times texture found in cache
+unsigned long texture_cache_misses;     // Times texture decoded and uploaded (Should stay same in steady state)
+unsigned long texture_cache_evictions;  // Times texture removed from cache to stay within budget
+
+sprite_vertex* sprite_batch_vertices;   // Vertices of queued sprites (4 per sprite)
+unsigned int* sprite_batch_textures;    // Texture of each queued sprite
+unsigned char* sprite_batch_blends;     // Blend mode of each queued sprite
+unsigned long long* sprite_batch_keys;  // Sort keys of queued sprites (Texture, Blend mode, Queue order)
+int sprite_batch_count;                 // Sprites queued in sprite batch
+int sprite_batch_blend;                 // Blend mode used for next queued sprites
+GLuint sprite_batch_vbo;                // Sprite batch vertex buffer (Orphaned each flush)
+GLuint sprite_batch_ibo;                // Sprite batch index buffer (Static)
+GLuint sprite_batch_white;              // 1x1 white texture used for untextured sprites
+unsigned long sprite_batch_draw_calls;  // Draw calls issued by sprite batch in last frame
+unsigned long sprite_batch_sprites;     // Sprites drawn by sprite batch in last frame
+
+char** atlas_queue;                     // Images added with atlas_add waiting for atlas_build
+int atlas_queue_count;                  // Images waiting for atlas_build
+atlas_entry* atlas_entries;             // Images packed into atlas pages, Keyed by source file
+int* atlas_buckets;                     // Hash buckets of atlas entries (First entry + 1, 0 if empty)
+int atlas_entries_count;                // Images packed into atlas pages
+texture atlas_pages[ATLAS_MAX_PAGES];   // Atlas pages textures
+int atlas_pages_count;                  // Atlas pages used
+
+text_layout text_cache[TEXT_CACHE_SIZE]; // Laid out texts, Keyed by text and font (Sets of TEXT_CACHE_WAYS layouts)
+unsigned long text_cache_uses;          // Times text cache was used (Clock of layouts last use)
+
+log_ring* volatile log_rings[LOG_MAX_THREADS];          // Queues of threads which logged messages
+volatile unsigned int log_rings_count;  // Threads which logged messages
+const char* volatile log_formats[LOG_MAX_FORMATS];      // Copies of format strings by id (Never freed, Logger thread may still print them)
+volatile c89atomic_uint64 log_formats_limit[LOG_MAX_FORMATS]; // Rate limit window of format string (High 32 bits, In seconds) and times logged in it (Low 32 bits)
+volatile unsigned int log_formats_suppressed[LOG_MAX_FORMATS]; // Times format string suppressed since last logged
+bool log_formats_written[LOG_MAX_FORMATS];              // Format string written to binary log already
+volatile unsigned int log_running;      // Logger thread running (Messages logged directly otherwise)
+ma_thread log_thread;                   // Logger thread, Writes queued messages out
+ma_timer log_timer;                     // Timer for messages time
+FILE* log_file;                         // Binary log file
+static THREAD_LOCAL log_ring* log_thread_ring;          // Queue of current thread
+static THREAD_LOCAL const char* log_thread_formats[LOG_FORMAT_CACHE]; // Format strings current thread logged recently (By pointer)
+static THREAD_LOCAL int log_thread_formats_ids[LOG_FORMAT_CACHE];     // Ids of format strings current thread logged recently
+
+ENetHost* net_host;                     // Host serviced by network thread (NULL if network not started, Only network thread uses it while running)
+volatile unsigned int net_running;      // Network thread running
+bool net_listening;                     // Host made by net_listen (Server), Else by net_connect (Client)
+ma_thread net_thread;                   // Network thread, Sends and receives packets while game thread is busy
+ma_timer net_timer;                     // Timer for network events time
+net_ring net_inbound;                   // Events from network thread to game thread
+net_ring net_outbound;                  // Commands from game thread to network thread
+ENetPacket* net_spare[NET_SPARE_PACKETS]; // Empty packets made by network thread for net_packet
+volatile unsigned int net_spare_head;   // Spare packets made (Only network thread writes it)
+volatile unsigned int net_spare_tail;   // Spare packets taken (Only game thread writes it)
+net_block* net_blocks[NET_BLOCK_CLASSES]; // Free ENet memory blocks by size class (Only network thread uses them)
+unsigned long net_mallocs;              // Times ENet memory came from system (Should stay same in steady state)
+unsigned long net_packet_misses;        // Times net_packet found no spare packet and allocated one
+unsigned long net_stalls;               // Times network thread stopped receiving since game didn't take events (Inbound queue full)
+unsigned int net_peer_count;            // Peers host can have (Peer indices are below it)
+unsigned char net_dictionary_data[NET_DICTIONARY_SIZE]; // Typical packet data compressed datagrams can refer to
+unsigned int net_dictionary_size;       // Bytes in compression dictionary
+unsigned short net_dictionary_table[1 << NET_COMPRESS_HASH_BITS]; // Dictionary position + 1 of each 4 byte hash (0 if none)
+FILE* net_trace;                        // Datagrams sent written by compressor (If net_record enabled)
+unsigned long net_compress_in;          // Bytes of datagrams host sent before compression
+unsigned long net_compress_out;         // Bytes of datagrams host sent after compression (Ratio is net_compress_out / net_compress_in)
+unsigned long net_decompress_in;        // Bytes of compressed datagrams host received
+unsigned long net_decompress_out;       // Bytes compressed datagrams host received decompressed to
+double net_compress_time;               // Time host spent compressing datagrams (In seconds)
+double net_decompress_time;             // Time host spent decompressing datagrams (In seconds)
+
+snapshot_entity snapshot_entities[SNAPSHOT_MAX_ENTITIES]; // Entities sent with next snapshot (Server)
+unsigned int snapshot_present[SNAPSHOT_MAX_ENTITIES / 32]; // Bit per entity sent with next snapshot (Server)
+snapshot_frame* snapshot_frames;        // Snapshots sent (Server) or received (Client) kept as baselines, By sequence
+snapshot_peer* snapshot_peers;          // Snapshots sent and acknowledged of each peer (Server)
+unsigned int snapshot_sequence;         // Sequence of last snapshot sent (Server) or received (Client)
+unsigned char snapshot_buffer[SNAPSHOT_MAX_ENTITIES * 48 + 16]; // Snapshot being encoded (Big enough for all entities changed)
+unsigned long snapshot_bytes_sent;      // Bytes of snapshots sent to all peers (Server)
+unsigned long snapshot_full_count;      // Snapshots sent without baseline (Peer acknowledged none kept)
+unsigned long snapshot_held_count;      // Entities held back from peers to stay within bandwidth (Peers predicted them from velocity)
+int snapshot_grid[SNAPSHOT_GRID_BUCKETS]; // First entity in each bucket of interest grid (-1 if none, Server)
+int snapshot_grid_next[SNAPSHOT_MAX_ENTITIES]; // Next entity in same bucket of interest grid (-1 if last)
+snapshot_candidate snapshot_candidates[SNAPSHOT_MAX_ENTITIES]; // Entities that may be sent to peer being encoded
 
 
 //////////////////////////////////////////////////////////////////////////////////////
@@ -131,26 +542,66 @@ char loaded_variable_value[256];        // Temp string to return game loaded var
 //////////////////////////////////////////////////////////////////////////////////////
 void start(int argc, char** argv);       // Initializes game
 void loop(int argc, char** argv);        // Updates all game functions
+void server(int argc, char** argv);      // Runs game as headless server (No window, OpenGL or audio)
 void init(int argc, char** argv);        // Before game creation...
 void draw(int argc, char** argv);        // Renders graphics (OpenGL)
 void update(int argc, char** argv);      // Game logic
 void input(int argc, char** argv);       // Game input
+void network(net_event* event);          // Network events (Peers connected, Disconnected and packets received)
 void close(int argc, char** argv);       // When game closes
+static void frame_limit(double frame_start); // Waits until frame takes 1 / game_fps seconds (Unless VSync is on)
+static void server_stop(int sig);        // Stops headless server after current tick
+static unsigned int hash_string(const char* str); // FNV-1a hash of string
+static void net_dispatch(void);          // Passes events received by network thread to network
+static void* ENET_CALLBACK net_malloc(size_t size); // ENet memory from network thread block pools
+static void ENET_CALLBACK net_free(void* memory); // Gives ENet memory back to block pools
+static void snapshot_peer_reset(net_event* event); // Forgets snapshots sent to peer connected or disconnected
+static void snapshot_receive(net_event* event); // Handles snapshot or acknowledgement
 
 
 //////////////////////////////////////////////////////////////////////////////////////
 // Utilities
 //////////////////////////////////////////////////////////////////////////////////////
 void logmsg(char* a1, char* a2, char* a3);
+void log_init(void);
+void log_write(int level, const char* fmt, const char* a1, const char* a2);
+void log_close(void);
+void log_decode(char* src);
 void play_audio(char* src);
+sound load_sound(char* src);
+void unload_sound(char* src);
+int play_sound(sound snd, float volume, int priority);
+void stop_voice(int voice);
+int sound_voices_active(void);
+void sound_bank_init(void);
+void sound_bank_close(void);
 void set_audio_volume(float volume);
 void set_audio_gain(float gain);
 void pause_audio(void);
 void resume_audio(void);
 
 int charcode(char ch);
+texture load_texture(char* src);
+void unload_texture(char* src);
+void texture_cache_clear(void);
 void draw_texture(char* src, rect srcRec, rect dstRec, color tint);
+void draw_sprite(texture tex, rect srcRec, rect dstRec, color tint);
+void draw_rect(rect rec, color tint);
+void set_blend_mode(int mode);
+void sprite_batch_init(void);
+void sprite_batch_flush(void);
+void sprite_batch_close(void);
+void atlas_add(char* src);
+void atlas_build(void);
+bool atlas_save(char* dst);
+bool atlas_load(char* src);
+bool atlas_lookup(char* src, texture* page, rect* rec);
+void atlas_clear(void);
 void draw_text(spritefont font, char* text, float x, float y, float size, color tint);
+font load_font(char* src, float size);
+void unload_font(font f);
+void draw_ttf_text(font f, char* text, float x, float y, color tint);
+float measure_ttf_text(font f, char* text);
 
 void storage_init(void);
 void storage_save_string(char* string, unsigned int position);
@@ -159,6 +610,61 @@ char* storage_load_string(unsigned int position);
 double storage_load_var(unsigned int position);
 void storage_clear(void);
 void storage_remove_var(unsigned int position);
+void storage_compact(void);
+void storage_close(void);
+
+bool net_listen(int port, int peers);
+bool net_connect(char* address, int port);
+bool net_poll(net_event* event);
+ENetPacket* net_packet(size_t size, unsigned int flags);
+bool net_send(unsigned int peer, int channel, ENetPacket* packet);
+bool net_broadcast(int channel, ENetPacket* packet);
+void net_release(ENetPacket* packet);
+void net_disconnect(unsigned int peer);
+double net_time(void);
+void net_close(void);
+void net_dictionary(const void* data, size_t size);
+bool net_dictionary_load(char* src);
+void bitpack_init(bitpack* b, void* data, size_t size);
+void bitpack_write(bitpack* b, unsigned int value, int bits);
+void bitpack_write_varint(bitpack* b, unsigned int value);
+void bitpack_write_signed(bitpack* b, int value);
+void bitpack_write_float(bitpack* b, float value, float min, float max, int bits);
+size_t bitpack_flush(bitpack* b);
+unsigned int bitpack_read(bitpack* b, int bits);
+unsigned int bitpack_read_varint(bitpack* b);
+int bitpack_read_signed(bitpack* b);
+float bitpack_read_float(bitpack* b, float min, float max, int bits);
+void snapshot_set(unsigned int id, snapshot_entity* entity);
+void snapshot_remove(unsigned int id);
+void snapshot_send(void);
+void snapshot_interest(unsigned int peer, float x, float y, float radius);
+bool snapshot_get(unsigned int id, snapshot_entity* entity);
+void snapshot_close(void);
+
+
+// Leveled logging, Calls below LOG_LEVEL are removed at compile time
+#if LOG_LEVEL <= LOG_TRACE
+#define log_trace(fmt, a1, a2) log_write(LOG_TRACE, fmt, a1, a2)
+#else
+#define log_trace(fmt, a1, a2)
+#endif
+#if LOG_LEVEL <= LOG_DEBUG
+#define log_debug(fmt, a1, a2) log_write(LOG_DEBUG, fmt, a1, a2)
+#else
+#define log_debug(fmt, a1, a2)
+#endif
+#if LOG_LEVEL <= LOG_INFO
+#define log_info(fmt, a1, a2) log_write(LOG_INFO, fmt, a1, a2)
+#else
+#define log_info(fmt, a1, a2)
+#endif
+#if LOG_LEVEL <= LOG_WARNING
+#define log_warning(fmt, a1, a2) log_write(LOG_WARNING, fmt, a1, a2)
+#else
+#define log_warning(fmt, a1, a2)
+#endif
+#define log_error(fmt, a1, a2) log_write(LOG_ERROR, fmt, a1, a2)
 
 
 //////////////////////////////////////////////////////////////////////////////////////
@@ -193,11 +699,32 @@ int dropped_files_count;                // Dropped files count (Number of files
 ma_result audio_engine_init_result;     // Result of audio engine initialization
 ma_engine audio_engine;                 // audio engine itself (miniaudio_engine.h)
 
+sound_bank_entry sound_bank[SOUND_BANK_SIZE];           // Decoded sounds, Keyed by source file
+int sound_bank_buckets[SOUND_BANK_SIZE];                // Hash buckets of sound bank (First entry + 1, 0 if empty)
+ma_sound sound_voices[SOUND_VOICES];                    // Voices playing sound bank sounds (Created once)
+ma_audio_buffer sound_voice_buffers[SOUND_VOICES];      // Data source of each voice, Points at decoded sound
+int sound_voice_clips[SOUND_VOICES];                    // Sound bank entry voice buffer points at (-1 if none, Kept after stop until audio thread is done with it)
+int sound_voice_priorities[SOUND_VOICES];               // Priority each voice started with
+unsigned long sound_voice_started[SOUND_VOICES];        // When each voice started (Oldest of same priority stolen first)
+unsigned long sound_voice_counter;      // Voices started so far
+unsigned long sound_voice_steals;       // Times playing voice stolen for more important sound
+unsigned long sound_voice_drops;        // Times sound not played since all voices more important
+
 
 //////////////////////////////////////////////////////////////////////////////////////
 // Initialization: This holds creation of game window and assigns callbacks
 //////////////////////////////////////////////////////////////////////////////////////
 int main(int argc, char** argv) {
+    if (argc == 3 && !strcmp(argv[1], "--decode-log")) {
+        log_decode(argv[2]);
+        return 0;
+    }
+    
+#ifdef SERVER_BUILD
+    server_mode = true;
+#endif
+    if (argc >= 2 && !strcmp(argv[1], "--server")) server_mode = true;
+    
 	init(argc, &argv);
 	start(argc, &argv);
 	return 0;
@@ -205,10 +732,16 @@ int main(int argc, char** argv) {
 
 
 void start(int argc, char** argv) {
+    log_init();
+    
     //////////////////////////////////////////////////////////////////////////////////
     // Networking Initialization (enet.h)
     //////////////////////////////////////////////////////////////////////////////////
-    if (enet_initialize() == 0) {
+    ENetCallbacks net_callbacks = { 0 };
+    net_callbacks.malloc = net_malloc;
+    net_callbacks.free = net_free;
+    
+    if (enet_initialize_with_callbacks(ENET_VERSION, &net_callbacks) == 0) {
         logmsg("GAME: NETWORKING INITIALIZED SUCCESSFULLY!\n", "", "");
     }
 
@@ -216,7 +749,13 @@ void start(int argc, char** argv) {
     //////////////////////////////////////////////////////////////////////////////////
     // Physics Initialization (physac.h)
     //////////////////////////////////////////////////////////////////////////////////
+    SetPhysicsThreads(physics_threads);
     InitPhysics();
+    
+    if (server_mode) {
+        server(argc, argv);
+        return;
+    }
 
 
     //////////////////////////////////////////////////////////////////////////////////
@@ -232,6 +771,7 @@ void start(int argc, char** argv) {
     }
 
     logmsg("GAME: AUDIO ENGINE INITIALIZED SUCCESSFULLY!\n", "", "");
+    sound_bank_init();
 
 
     //////////////////////////////////////////////////////////////////////////////////
@@ -283,18 +823,22 @@ void start(int argc, char** argv) {
         for (int i = 0; i < 16; i++) {
             joysticks[i].index = i;
         }
+	glfwMakeContextCurrent(window);
+        
+        // Swap interval applies to current context, So it's set once context is made current
 #ifdef VSYNC_ENABLED
-        glfwSwapInterval(1);
+        swap_interval = 1;
 #else
-        glfwSwapInterval(0);
+        swap_interval = 0;
 #endif
-	glfwMakeContextCurrent(window);
+        glfwSwapInterval(swap_interval);
 #ifdef _WIN32 || WIN32
         gladLoadGL(glfwGetProcAddress);
 #else
         gladLoadGL();	    
 #endif
         logmsg("%s%s\n", "GAME: USED OPENGL ", glGetString(GL_VERSION));
+        sprite_batch_init();
         loop(argc, &argv);
     } else {
         logmsg("GAME: FAILED TO CREATE DISPLAY WINDOW!\n", "", "");
@@ -309,8 +853,6 @@ void start(int argc, char** argv) {
 //////////////////////////////////////////////////////////////////////////////////////
 void loop(int argc, char** argv) {
     while (!glfwWindowShouldClose(window)) {
-        RunPhysicsStep();
-
         for (int i = 0; i < 16; i++) {
             joysticks[i].name = glfwGetJoystickName(joysticks[i].index);
             joysticks[i].buttons = glfwGetJoystickButtons(joysticks[i].index, &joysticks[i].buttons_count);
@@ -331,17 +873,34 @@ void loop(int argc, char** argv) {
         glfwGetFramebufferSize(window, &window_height, &window_height);
 
         t2 = glfwGetTime();
-        dt = t2 - t1;
+        frame_time = t2 - t1;
+        t1 = t2;
+        
+        frame_time_variance = 0.95 * (frame_time_variance + 0.05 * (frame_time - frame_time_avg) * (frame_time - frame_time_avg));
+        frame_time_avg += 0.05 * (frame_time - frame_time_avg);
+
+        // Run update and input at fixed time step, Drop time if game can't keep up (Avoids spiral of death)
+        dt = 1.0 / game_tps;
+        update_accumulator += (frame_time > 0.25) ? 0.25 : frame_time;
 
-        if (dt >= (1.0 / game_fps)) {
-            logmsg("GAME: UPDATING...\n", "", "");
+        while (update_accumulator >= dt) {
+            net_dispatch();
+            log_trace("GAME: UPDATING...\n", "", "");
             update(argc, &argv);
-            logmsg("GAME: RECEIEVING GAME INPUT...\n", "", "");
+            log_trace("GAME: RECEIEVING GAME INPUT...\n", "", "");
             input(argc, &argv);
-            t1 = t2;
+            update_accumulator -= dt;
+            update_count++;
         }
+        
+        frame_alpha = update_accumulator / dt;
+#ifdef PHYSAC_NO_THREADS
+        RunPhysicsStep();
+#endif
+        physics_state = AcquirePhysicsState();
+        physics_alpha = GetPhysicsStateAlpha(physics_state);
 
-        logmsg("GAME: RENDERING...\n", "", "");
+        log_trace("GAME: RENDERING...\n", "", "");
         glViewport(0, 0, window_width, window_height);
         glMatrixMode(GL_MODELVIEW);
         glLoadIdentity();
@@ -349,23 +908,139 @@ void loop(int argc, char** argv) {
         glScalef(1, -1, 1);
         glTranslatef(0, -window_height, 0);
 
+        sprite_batch_draw_calls = 0;
+        sprite_batch_sprites = 0;
         draw(argc, &argv);
+        sprite_batch_flush();
         glfwSwapBuffers(window);
         glfwPollEvents();
+        frame_count++;
+        frame_limit(t2);
     }
     
     logmsg("GAME: CLOSING DISPLAY WINDOW...\n", "", "");
     close(argc, &argv);
+    sprite_batch_close();
+    atlas_clear();
+    texture_cache_clear();
     glfwDestroyWindow(window);
     glfwTerminate();
+    sound_bank_close();
     ma_engine_uninit(&audio_engine);
     ClosePhysics();
+    net_close();
     enet_deinitialize();
+    storage_close();
     logmsg("GAME: CLOSED SUCCESSFULLY!\n", "", "");
+    log_close();
     exit(0);
 }
 
 
+// Sleeps most of remaining frame time then spins the rest, Since sleeping can overshoot by milliseconds
+// NOTE: Skipped with VSync, Buffer swap already waits for display and sleeping too would only miss refreshes
+static void frame_limit(double frame_start) {
+    static double overshoot_avg = 0.001;
+    static double overshoot_variance = 0;
+    
+    if (game_fps <= 0 || swap_interval != 0) return;
+    
+    double frame_end = frame_start + 1.0 / game_fps;
+    double now = glfwGetTime();
+    
+    while (frame_end - now > frame_sleep_slack + 0.001) {
+        ma_sleep(1);
+        double overshoot = (glfwGetTime() - now) - 0.001;
+        now = glfwGetTime();
+        
+        // Expect sleeps to overshoot by their average plus two standard deviations
+        overshoot_variance = 0.95 * (overshoot_variance + 0.05 * (overshoot - overshoot_avg) * (overshoot - overshoot_avg));
+        overshoot_avg += 0.05 * (overshoot - overshoot_avg);
+        frame_sleep_slack = overshoot_avg + 2 * sqrt(overshoot_variance);
+        if (frame_sleep_slack < 0) frame_sleep_slack = 0;
+    }
+    
+    while (glfwGetTime() < frame_end) ma_yield();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////
+// Server: Headless game loop, Runs update at fixed tick while network thread services clients
+//////////////////////////////////////////////////////////////////////////////////////
+void server(int argc, char** argv) {
+    ma_timer timer;
+    
+    logmsg("GAME: STARTING HEADLESS SERVER...\n", "", "");
+#ifdef SERVER_BUILD
+    // GLFW null platform needs no display, So GLFW calls in game code still work
+    glfwSetErrorCallback(error);
+    glfwInit();
+#endif
+    bool hosted = net_listen(server_port, server_max_peers);
+    
+    if (!hosted) {
+        logmsg("GAME: FAILED TO CREATE SERVER HOST!\n", "", "");
+    } else {
+        logmsg("GAME: SERVER HOST CREATED SUCCESSFULLY!\n", "", "");
+    }
+    
+    signal(SIGINT, server_stop);
+    signal(SIGTERM, server_stop);
+    server_running = hosted;
+    
+    ma_timer_init(&timer);
+    dt = 1.0 / game_tps;
+    double next_tick = ma_timer_get_time_in_seconds(&timer);
+    
+    while (server_running) {
+        double now = ma_timer_get_time_in_seconds(&timer);
+        
+        // Ticks are due at fixed times since start, So a late tick doesn't delay next ones
+        if (now >= next_tick) {
+            server_tick_late = now - next_tick;
+            server_tick_late_avg += 0.05 * (server_tick_late - server_tick_late_avg);
+            if (server_tick_late > server_tick_late_max) server_tick_late_max = server_tick_late;
+            
+#ifdef PHYSAC_NO_THREADS
+            RunPhysicsStep();
+#endif
+            physics_state = AcquirePhysicsState();
+            net_dispatch();
+            log_trace("GAME: UPDATING...\n", "", "");
+            update(argc, argv);
+            update_count++;
+            
+            // Drop time if server can't keep up (Avoids spiral of death)
+            next_tick += dt;
+            if (now - next_tick > 0.25) next_tick = now;
+            continue;
+        }
+        
+        // Sleep until next tick, Rounded up so last fraction of millisecond isn't spent spinning (Network thread keeps servicing clients meanwhile)
+        ma_sleep((ma_uint32)ceil((next_tick - now) * 1000));
+    }
+    
+    logmsg("GAME: CLOSING HEADLESS SERVER...\n", "", "");
+    close(argc, argv);
+    net_close();
+#ifdef SERVER_BUILD
+    glfwTerminate();
+#endif
+    ClosePhysics();
+    enet_deinitialize();
+    storage_close();
+    logmsg("GAME: CLOSED SUCCESSFULLY!\n", "", "");
+    log_close();
+    exit(hosted ? 0 : 1);
+}
+
+
+static void server_stop(int sig) {
+    (void)sig;
+    server_running = 0;
+}
+
+
 //////////////////////////////////////////////////////////////////////////////////////
 // Game Variables: Put here your game variables
 //////////////////////////////////////////////////////////////////////////////////////
@@ -398,13 +1073,7 @@ void draw(int argc, char** argv) {
     glClearColor(0, 0, 0, 1);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glBegin(GL_QUADS);
-    glColor4ub(0, 0, 255, 255);
-    glVertex2i(player_x, player_y);
-    glVertex2i(player_x + player_width, player_y);
-    glVertex2i(player_x + player_width, player_y + player_height);
-    glVertex2i(player_x, player_y + player_height);
-    glEnd();
+    draw_rect((rect) { player_x, player_y, player_width, player_height }, (color) { 0, 0, 255, 255 });
 }
 
 
@@ -419,6 +1088,25 @@ void input(int argc, char** argv) {
 }
 
 
+//////////////////////////////////////////////////////////////////////////////////////
+// Network: Here you handle peers of net_listen or net_connect host (Runs before each update)
+//////////////////////////////////////////////////////////////////////////////////////
+void network(net_event* event) {
+    switch (event->type) {
+        case NET_CONNECT:
+            logmsg("GAME: PEER CONNECTED!\n", "", "");
+            break;
+        case NET_DISCONNECT:
+            logmsg("GAME: PEER DISCONNECTED!\n", "", "");
+            break;
+        case NET_RECEIVE:
+            break;
+        default:
+            break;
+    }
+}
+
+
 //////////////////////////////////////////////////////////////////////////////////////
 // Close: What should happens when your game closed...
 //////////////////////////////////////////////////////////////////////////////////////
@@ -481,192 +1169,3198 @@ static void window_resize(GLFWwindow* window, int new_width, int new_height) {
 //////////////////////////////////////////////////////////////////////////////////////
 void logmsg(char* a1, char* a2, char* a3) {
 #ifdef DEBUGGING_ENABLED
-    printf(a1, a2, a3);
+    log_debug(a1, a2, a3);
 #endif
 }
 
-int charcode(char ch) {
-    return (int)ch;
+
+// Returns id of format string by its text, Copying it first time logged (Lock free, Format strings are never removed)
+// NOTE: Format may be any string (Buffer or freed later), But each different text takes one of LOG_MAX_FORMATS ids, So pass changing text as arguments
+static int log_format_id(const char* fmt) {
+    unsigned int cached = (unsigned int)(((size_t)fmt >> 3) % LOG_FORMAT_CACHE);
+    
+    // Same pointer as last time only needs one compare (Buffer reused for other text doesn't match and gets looked up)
+    if (log_thread_formats[cached] == fmt && !strcmp(log_formats[log_thread_formats_ids[cached]], fmt)) {
+        return log_thread_formats_ids[cached];
+    }
+    
+    unsigned int slot = hash_string(fmt) % LOG_MAX_FORMATS;
+    char* copy = NULL;
+    int id = -1;
+    
+    for (int i = 0; i < LOG_MAX_FORMATS && id == -1; i++) {
+        const char* current = c89atomic_load_ptr(&log_formats[slot]);
+        
+        if (!current) {
+            if (!copy) {
+                copy = malloc(strlen(fmt) + 1);
+                if (!copy) return -1;
+                strcpy(copy, fmt);
+            }
+            
+            current = c89atomic_compare_and_swap_ptr((volatile void**)&log_formats[slot], NULL, copy);
+            
+            if (!current) {
+                copy = NULL;
+                id = slot;
+                break;
+            }
+        }
+        
+        if (!strcmp(current, fmt)) id = slot;
+        slot = (slot + 1) % LOG_MAX_FORMATS;
+    }
+    
+    free(copy);
+    
+    if (id != -1) {
+        log_thread_formats[cached] = fmt;
+        log_thread_formats_ids[cached] = id;
+    }
+    
+    return id;
 }
 
-void play_audio(char* src) {
-    ma_engine_play_sound(&audio_engine, src, NULL);
+
+static void log_output(log_record* record) {
+    const char* fmt = log_formats[record->id];
+    
+    if (!log_file) {
+        printf(fmt, record->args[0], record->args[1]);
+        if (record->suppressed) printf("GAME: PREVIOUS MESSAGE SUPPRESSED %u TIMES\n", record->suppressed);
+        if (record->dropped) printf("GAME: %u MESSAGES DROPPED BEFORE PREVIOUS ONE (LOG QUEUE FULL)\n", record->dropped);
+        return;
+    }
+    
+    // Binary log: Format strings written once, Then messages reference them by id
+    if (!log_formats_written[record->id]) {
+        unsigned char tag = 0;
+        unsigned short length = (unsigned short)strlen(fmt);
+        fwrite(&tag, 1, 1, log_file);
+        fwrite(&record->id, sizeof(unsigned short), 1, log_file);
+        fwrite(&length, sizeof(unsigned short), 1, log_file);
+        fwrite(fmt, 1, length, log_file);
+        log_formats_written[record->id] = true;
+    }
+    
+    unsigned char tag = 1;
+    fwrite(&tag, 1, 1, log_file);
+    fwrite(&record->id, sizeof(unsigned short), 1, log_file);
+    fwrite(&record->level, 1, 1, log_file);
+    fwrite(&record->time, sizeof(double), 1, log_file);
+    fwrite(&record->suppressed, sizeof(unsigned int), 1, log_file);
+    fwrite(&record->dropped, sizeof(unsigned int), 1, log_file);
+    
+    for (int i = 0; i < 2; i++) {
+        unsigned char length = (unsigned char)strlen(record->args[i]);
+        fwrite(&length, 1, 1, log_file);
+        fwrite(record->args[i], 1, length, log_file);
+    }
 }
 
 
-void set_audio_volume(float volume) {
-    ma_engine_set_volume(&audio_engine, volume);
+// Writes out queued messages of all threads
+static unsigned int log_drain(void) {
+    unsigned int written = 0;
+    unsigned int count = c89atomic_load_32(&log_rings_count);
+    if (count > LOG_MAX_THREADS) count = LOG_MAX_THREADS;
+    
+    for (unsigned int i = 0; i < count; i++) {
+        log_ring* ring = c89atomic_load_ptr(&log_rings[i]);
+        if (!ring) continue;
+        
+        unsigned int head = c89atomic_load_32(&ring->head);
+        unsigned int tail = ring->tail;
+        written += head - tail;
+        
+        while (tail != head) {
+            log_output(&ring->records[tail % LOG_RING_SIZE]);
+            tail++;
+        }
+        
+        c89atomic_store_32(&ring->tail, tail);
+    }
+    
+    if (written) fflush(log_file ? log_file : stdout);
+    return written;
 }
 
 
-void set_audio_gain(float gain) {
-    ma_engine_set_gain_db(&audio_engine, gain);
+static ma_thread_result MA_THREADCALL log_thread_main(void* data) {
+    (void)data;
+    unsigned int wait = 2;
+    
+    while (c89atomic_load_32(&log_running)) {
+        // Sleep longer while nothing gets logged (Up to 16 milliseconds), So idle game barely wakes logger
+        wait = log_drain() ? 2 : ((wait < 16) ? wait * 2 : 16);
+        ma_sleep(wait);
+    }
+    
+    log_drain();
+    return (ma_thread_result)0;
 }
 
 
-void pause_audio(void) {
-    ma_engine_stop(&audio_engine);
+void log_init(void) {
+    ma_timer_init(&log_timer);
+    
+    if (log_binary) log_file = fopen("game.log", "wb");
+    
+    c89atomic_store_32(&log_running, 1);
+    
+    if (ma_thread_create(&log_thread, ma_thread_priority_low, 0, log_thread_main, NULL) != MA_SUCCESS) {
+        c89atomic_store_32(&log_running, 0);
+    }
 }
 
 
-void resume_audio(void) {
-    ma_engine_start(&audio_engine);
+// Queues message into current thread queue, Never blocks (Drops message if queue is full)
+void log_write(int level, const char* fmt, const char* a1, const char* a2) {
+    int id = log_format_id(fmt);
+    
+    if (id == -1 || !c89atomic_load_32(&log_running)) {
+        printf(fmt, a1, a2);
+        return;
+    }
+    
+    // Rate limit repeated messages per format string, Window and count are swapped together so threads never lose counts
+    double time = ma_timer_get_time_in_seconds(&log_timer);
+    unsigned int window = (unsigned int)time;
+    c89atomic_uint64 limit = c89atomic_load_64(&log_formats_limit[id]);
+    
+    while (true) {
+        // Threads that read timer slightly earlier count against newer window instead of resetting it
+        unsigned int current = (unsigned int)(limit >> 32);
+        unsigned int count = (current >= window) ? (unsigned int)limit : 0;
+        
+        if (count >= LOG_RATE_LIMIT) {
+            c89atomic_fetch_add_32(&log_formats_suppressed[id], 1);
+            return;
+        }
+        
+        c89atomic_uint64 seen = c89atomic_compare_and_swap_64(&log_formats_limit[id], limit, ((c89atomic_uint64)(current > window ? current : window) << 32) | (count + 1));
+        if (seen == limit) break;
+        limit = seen;
+    }
+    
+    log_ring* ring = log_thread_ring;
+    
+    if (!ring) {
+        unsigned int index = c89atomic_fetch_add_32(&log_rings_count, 1);
+        
+        if (index >= LOG_MAX_THREADS) {
+            printf(fmt, a1, a2);
+            return;
+        }
+        
+        ring = calloc(1, sizeof(log_ring));
+        c89atomic_store_ptr((volatile void**)&log_rings[index], ring);
+        log_thread_ring = ring;
+    }
+    
+    unsigned int head = ring->head;
+    
+    if (head - c89atomic_load_32(&ring->tail) >= LOG_RING_SIZE) {
+        ring->dropped++;
+        return;
+    }
+    
+    log_record* record = &ring->records[head % LOG_RING_SIZE];
+    record->time = time;
+    record->id = (unsigned short)id;
+    record->level = (unsigned char)level;
+    record->suppressed = c89atomic_exchange_32(&log_formats_suppressed[id], 0);
+    record->dropped = ring->dropped;
+    ring->dropped = 0;
+    snprintf(record->args[0], sizeof(record->args[0]), "%s", a1 ? a1 : "");
+    snprintf(record->args[1], sizeof(record->args[1]), "%s", a2 ? a2 : "");
+    
+    c89atomic_store_32(&ring->head, head + 1);
 }
 
 
-void draw_texture(char* src, rect srcRec, rect dstRec, color tint) {
-    logmsg("GAME: LOADING TEXTURE %s\n", src, "");
-	
-    GLuint texture;
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(src, &width, &height, &nrChannels, STBI_rgb_alpha);
+void log_close(void) {
+    if (!c89atomic_load_32(&log_running)) return;
     
-    if (data) {
-        glEnable(GL_TEXTURE_2D);
-        glEnable(GL_BLEND);
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glActiveTexture(GL_TEXTURE0);
-
-        glColor4f(tint.r, tint.g, tint.b, tint.a);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-        glBlendFunc(GL_ONE, GL_ONE_MINUS_DST_ALPHA);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        if (!srcRec.w) srcRec.w = (float) width;
-        if (!srcRec.h) srcRec.h = (float)height;
-        if (!dstRec.w) dstRec.w = (float) width;
-        if (!dstRec.h) dstRec.h = (float) height;
-
-        float ix1 = (float) srcRec.x / width;
-        float ix2 = (float) (srcRec.w + srcRec.x) / width;
-        float iy1 = (float) srcRec.y / height;
-        float iy2 = (float) (srcRec.h + srcRec.y) / height;
-
-        glBegin(GL_QUADS);
-        glTexCoord2f(ix1, iy1);
-        glVertex2i(dstRec.x, dstRec.y);
-        glTexCoord2f(ix2, iy1);
-        glVertex2i(dstRec.x + dstRec.w, dstRec.y);
-        glTexCoord2f(ix2, iy2);
-        glVertex2i(dstRec.x + dstRec.w, dstRec.y + dstRec.h);
-        glTexCoord2f(ix1, iy2);
-        glVertex2i(dstRec.x, dstRec.y + dstRec.h);
-        glEnd();
-
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glDeleteTextures(1, &texture);
-        glDisable(GL_TEXTURE_2D);
-        glDisable(GL_BLEND);
-
-        logmsg("GAME: UNLOADING TEXTURE %s\n", src, "");
-        stbi_image_free(data);
-    } else {
-        logmsg("GAME: FAILED TO LOAD TEXTURE %s!\n", src, "");
+    c89atomic_store_32(&log_running, 0);
+    ma_thread_wait(&log_thread);
+    
+    for (int i = 0; i < LOG_MAX_THREADS; i++) {
+        if (log_rings[i] && log_rings[i]->dropped) printf("GAME: %u MESSAGES DROPPED AT CLOSE (LOG QUEUE FULL)\n", log_rings[i]->dropped);
+        free(log_rings[i]);
+        log_rings[i] = NULL;
     }
+    
+    if (log_file) fclose(log_file);
+    log_file = NULL;
 }
 
 
-void draw_text(spritefont font, char* text, float x, float y, float size, color tint) {
-    size_t c = 0;
+// Prints binary log written with log_binary enabled as text
+void log_decode(char* src) {
+    static const char* levels[] = { "TRACE", "DEBUG", "INFO", "WARNING", "ERROR" };
+    char* formats[LOG_MAX_FORMATS] = { 0 };
+    FILE* file = fopen(src, "rb");
+    unsigned char tag;
     
-    while (text[c] != "\0") {
-        draw_texture(font.src, font.chars[(int)text[c]], (rect) { x, y, size, size }, tint);
-        c++;
+    if (!file) {
+        printf("GAME: FAILED TO OPEN LOG %s!\n", src);
+        return;
+    }
+    
+    while (fread(&tag, 1, 1, file) == 1) {
+        unsigned short id, length;
+        
+        if (fread(&id, sizeof(unsigned short), 1, file) != 1 || id >= LOG_MAX_FORMATS) break;
+        
+        if (tag == 0) {
+            if (fread(&length, sizeof(unsigned short), 1, file) != 1) break;
+            free(formats[id]);
+            formats[id] = calloc(length + 1, 1);
+            if (fread(formats[id], 1, length, file) != length) break;
+        } else {
+            unsigned char level, arg_length;
+            double time;
+            unsigned int suppressed, dropped;
+            char args[2][256] = { { 0 } };
+            
+            if (fread(&level, 1, 1, file) != 1 || fread(&time, sizeof(double), 1, file) != 1 || fread(&suppressed, sizeof(unsigned int), 1, file) != 1 || fread(&dropped, sizeof(unsigned int), 1, file) != 1) break;
+            
+            for (int i = 0; i < 2; i++) {
+                if (fread(&arg_length, 1, 1, file) != 1 || fread(args[i], 1, arg_length, file) != arg_length) break;
+            }
+            
+            printf("[%10.4f] [%s] ", time, levels[level < 5 ? level : 4]);
+            printf(formats[id] ? formats[id] : "(UNKNOWN FORMAT)\n", args[0], args[1]);
+            if (suppressed) printf("GAME: PREVIOUS MESSAGE SUPPRESSED %u TIMES\n", suppressed);
+            if (dropped) printf("GAME: %u MESSAGES DROPPED BEFORE PREVIOUS ONE (LOG QUEUE FULL)\n", dropped);
+        }
     }
+    
+    for (int i = 0; i < LOG_MAX_FORMATS; i++) free(formats[i]);
+    fclose(file);
 }
 
+int charcode(char ch) {
+    return (int)ch;
+}
 
-void storage_init(void) {
-    logmsg("GAME: INITIALIZING STORAGE...\n", "", "");
+static unsigned int hash_string(const char* str) {
+    unsigned int hash = 2166136261u;
     
-    if ((game_data = fopen("game.data", "r"))) {
-        fclose(game_data);
-    } else {
-        game_data = fopen("game.data", "w");
-        fclose(game_data);
+    while (*str) {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619u;
     }
     
-    logmsg("GAME: STORAGE INITIALIZED SUCCESSFULLY!\n", "", "");
+    return hash;
 }
 
 
-void storage_save_string(char* string, unsigned int position) {
-    storage_remove_var(position);
-    game_data = fopen("game.data", "a");
-    for (int i = 0; i < position; i++) fprintf(game_data, "\0\n");
-    fprintf(game_data, "%s", string);
-    fclose(game_data);
+static int sound_bank_find(const char* src, unsigned int hash) {
+    int i = sound_bank_buckets[hash % SOUND_BANK_SIZE];
+    
+    while (i) {
+        sound_bank_entry* entry = &sound_bank[i - 1];
+        if (entry->hash == hash && !strcmp(entry->src, src)) return i - 1;
+        i = entry->next;
+    }
+    
+    return -1;
 }
 
 
-void storage_save_var(double var, unsigned int position) {
-    storage_remove_var(position);
-    char var_tostr[64];
-    snprintf(var_tostr, 64, "%f", var);
-    storage_save_string(var_tostr, position);
+// Creates voices once, Each voice plays sound bank clips through its own audio buffer so triggering never allocates
+void sound_bank_init(void) {
+    static float silence[MA_MAX_CHANNELS];
+    
+    for (int i = 0; i < SOUND_VOICES; i++) {
+        ma_audio_buffer_config config = ma_audio_buffer_config_init(ma_format_f32, audio_engine.channels, 1, silence, NULL);
+        ma_audio_buffer_init(&config, &sound_voice_buffers[i]);
+        ma_sound_init_from_data_source(&audio_engine, &sound_voice_buffers[i], 0, NULL, &sound_voices[i]);
+        sound_voice_clips[i] = -1;
+    }
 }
 
 
-char* storage_load_string(unsigned int position) {
-    memset(&loaded_variable_value[0], 0, sizeof(loaded_variable_value));
-    char line[256] = { 0 };
-    unsigned int line_count = 0;
-    game_data = fopen("game.data", "r");
+// Decodes sound once and keeps it in sound bank, So playing it never touches file or decoder
+sound load_sound(char* src) {
+    unsigned int hash = hash_string(src);
+    int index = sound_bank_find(src, hash);
     
-    while (fgets(line, 256, game_data)) {
-        ++line_count;
-        
-        if (line_count == position) {
-            strcpy(loaded_variable_value, line);
-            break;
-        }
+    if (index != -1) return (sound) { index + 1, sound_bank[index].frame_count };
+    
+    for (index = 0; index < SOUND_BANK_SIZE && sound_bank[index].src; index++);
+    
+    if (index == SOUND_BANK_SIZE) {
+        logmsg("GAME: SOUND BANK FULL, FAILED TO LOAD SOUND %s\n", src, "");
+        return (sound) { 0 };
     }
     
-    fclose(game_data);
-    strcpy(loaded_variable_value, line);
-    return loaded_variable_value;
+    logmsg("GAME: LOADING SOUND %s\n", src, "");
+    
+    // Decode to engine format, So voices mix it without any conversion
+    sound_bank_entry* entry = &sound_bank[index];
+    ma_decoder_config config = ma_decoder_config_init(ma_format_f32, audio_engine.channels, audio_engine.sampleRate);
+    ma_uint64 frame_count;
+    
+    if (ma_decode_file(src, &config, &frame_count, (void**)&entry->frames) != MA_SUCCESS || !frame_count) {
+        logmsg("GAME: FAILED TO LOAD SOUND %s\n", src, "");
+        ma_free(entry->frames, NULL);
+        entry->frames = NULL;
+        return (sound) { 0 };
+    }
+    
+    entry->src = malloc(strlen(src) + 1);
+    strcpy(entry->src, src);
+    entry->hash = hash;
+    entry->frame_count = frame_count;
+    entry->next = sound_bank_buckets[hash % SOUND_BANK_SIZE];
+    sound_bank_buckets[hash % SOUND_BANK_SIZE] = index + 1;
+    
+    return (sound) { index + 1, entry->frame_count };
 }
 
-double storage_load_var(unsigned int position) {
-    return atof(storage_load_string(position));
+
+// Stopped voice is released once audio thread isn't mixing it, Mixer flags mixing before it checks playing so later mixes skip it
+static bool sound_voice_released(int voice) {
+    return !ma_sound_is_playing(&sound_voices[voice]) && !c89atomic_load_32(&sound_voices[voice].isMixing);
 }
 
 
-void storage_remove_var(unsigned int position) {
-    unsigned int ctr = 0;
-    char str[256];
-    FILE* temp_data;
-    game_data = fopen("game.data", "r");
-    temp_data = fopen("temp.data", "w");
+void unload_sound(char* src) {
+    int index = sound_bank_find(src, hash_string(src));
+    if (index == -1) return;
+    
+    sound_bank_entry* entry = &sound_bank[index];
+    int* link = &sound_bank_buckets[entry->hash % SOUND_BANK_SIZE];
     
-    while (!feof(game_data)) {
-        strcpy(str, "\0");
-        fgets(str, 256, game_data);
+    while (*link != index + 1) link = &sound_bank[*link - 1].next;
+    *link = entry->next;
+    
+    // Frames can't be freed while audio thread mixes them, Unloading is rare so waiting here is fine
+    for (int i = 0; i < SOUND_VOICES; i++) {
+        if (sound_voice_clips[i] != index) continue;
         
-        if (!feof(game_data)) {
-            ctr++;
-            if (ctr != position) fprintf(temp_data, str);
-        }
+        ma_sound_stop(&sound_voices[i]);
+        while (!sound_voice_released(i)) ma_yield();
+        sound_voice_clips[i] = -1;
     }
     
-    fclose(game_data);
-    fclose(temp_data);
-    storage_clear();
-    rename("temp.data", "game.data");
+    logmsg("GAME: UNLOADING SOUND %s\n", entry->src, "");
+    ma_free(entry->frames, NULL);
+    free(entry->src);
+    memset(entry, 0, sizeof(sound_bank_entry));
+}
+
+
+// Plays sound on released voice, Or steals voice with lowest priority (Oldest first), Returns voice or -1 if all voices more important
+int play_sound(sound snd, float volume, int priority) {
+    if (!snd.id) return -1;
+    
+    int voice = -1;
+    int victim = -1;
+    
+    for (int i = 0; i < SOUND_VOICES; i++) {
+        // Finished voices stay playing until mixer notices, Stop them here so they can be released
+        if (ma_sound_at_end(&sound_voices[i])) ma_sound_stop(&sound_voices[i]);
+        
+        if (sound_voice_released(i)) {
+            voice = i;
+            break;
+        }
+        
+        // Voice stopped but still being mixed isn't stolen, It gets released on its own
+        if (!ma_sound_is_playing(&sound_voices[i])) continue;
+        
+        if (victim == -1 || sound_voice_priorities[i] < sound_voice_priorities[victim] ||
+           (sound_voice_priorities[i] == sound_voice_priorities[victim] && sound_voice_started[i] < sound_voice_started[victim])) {
+            victim = i;
+        }
+    }
+    
+    if (voice == -1) {
+        if (victim == -1 || sound_voice_priorities[victim] > priority) {
+            sound_voice_drops++;
+            return -1;
+        }
+        
+        sound_voice_steals++;
+        ma_sound_stop(&sound_voices[victim]);
+        
+        // Audio thread mixing stolen voice right now, It's released for next sound instead of waiting for it here
+        if (!sound_voice_released(victim)) {
+            sound_voice_drops++;
+            return -1;
+        }
+        
+        voice = victim;
+    }
+    
+    // Point released voice buffer at decoded sound (Doesn't copy or allocate)
+    sound_bank_entry* entry = &sound_bank[snd.id - 1];
+    ma_audio_buffer_config config = ma_audio_buffer_config_init(ma_format_f32, audio_engine.channels, entry->frame_count, entry->frames, NULL);
+    ma_audio_buffer_uninit(&sound_voice_buffers[voice]);
+    ma_audio_buffer_init(&config, &sound_voice_buffers[voice]);
+    
+    // Rewind voice, ma_sound_start clears end flag left by previous sound
+    ma_sound_seek_to_pcm_frame(&sound_voices[voice], 0);
+    sound_voice_clips[voice] = snd.id - 1;
+    sound_voice_priorities[voice] = priority;
+    sound_voice_started[voice] = ++sound_voice_counter;
+    ma_sound_set_volume(&sound_voices[voice], volume);
+    ma_sound_start(&sound_voices[voice]);
+    return voice;
+}
+
+
+// Stops voice without waiting for audio thread, play_sound reuses it once released
+void stop_voice(int voice) {
+    if (voice < 0 || voice >= SOUND_VOICES) return;
+    ma_sound_stop(&sound_voices[voice]);
+}
+
+
+int sound_voices_active(void) {
+    int active = 0;
+    
+    for (int i = 0; i < SOUND_VOICES; i++) {
+        if (ma_sound_is_playing(&sound_voices[i]) && !ma_sound_at_end(&sound_voices[i])) active++;
+    }
+    
+    return active;
+}
+
+
+void sound_bank_close(void) {
+    for (int i = 0; i < SOUND_BANK_SIZE; i++) {
+        if (sound_bank[i].src) unload_sound(sound_bank[i].src);
+    }
+    
+    for (int i = 0; i < SOUND_VOICES; i++) {
+        ma_sound_uninit(&sound_voices[i]);
+        ma_audio_buffer_uninit(&sound_voice_buffers[i]);
+    }
+}
+
+
+
+// Plays sound from sound bank if loaded with load_sound, Otherwise audio engine loads it
+void play_audio(char* src) {
+    int index = sound_bank_find(src, hash_string(src));
+    
+    if (index != -1) {
+        play_sound((sound) { index + 1, sound_bank[index].frame_count }, 1, 0);
+    } else {
+        ma_engine_play_sound(&audio_engine, src, NULL);
+    }
+}
+
+
+void set_audio_volume(float volume) {
+    ma_engine_set_volume(&audio_engine, volume);
+}
+
+
+void set_audio_gain(float gain) {
+    ma_engine_set_gain_db(&audio_engine, gain);
+}
+
+
+void pause_audio(void) {
+    ma_engine_stop(&audio_engine);
+}
+
+
+void resume_audio(void) {
+    ma_engine_start(&audio_engine);
+}
+
+
+static int texture_cache_find(const char* src, unsigned int hash) {
+    int i = texture_cache_buckets[hash % TEXTURE_CACHE_SIZE];
+    
+    while (i) {
+        texture_cache_entry* entry = &texture_cache[i - 1];
+        if (entry->hash == hash && !strcmp(entry->src, src)) return i - 1;
+        i = entry->next;
+    }
+    
+    return -1;
+}
+
+
+// Removes entry from LRU list
+static void texture_cache_unlink(int index) {
+    texture_cache_entry* entry = &texture_cache[index];
+    
+    if (entry->lru_prev) texture_cache[entry->lru_prev - 1].lru_next = entry->lru_next;
+    else texture_cache_lru_first = entry->lru_next;
+    
+    if (entry->lru_next) texture_cache[entry->lru_next - 1].lru_prev = entry->lru_prev;
+    else texture_cache_lru_last = entry->lru_prev;
+    
+    entry->lru_prev = entry->lru_next = 0;
+}
+
+
+// Adds entry to end of LRU list (Most recently drawn)
+static void texture_cache_link(int index) {
+    texture_cache_entry* entry = &texture_cache[index];
+    
+    entry->lru_prev = texture_cache_lru_last;
+    entry->lru_next = 0;
+    
+    if (texture_cache_lru_last) texture_cache[texture_cache_lru_last - 1].lru_next = index + 1;
+    else texture_cache_lru_first = index + 1;
+    
+    texture_cache_lru_last = index + 1;
+}
+
+
+static void texture_cache_remove(int index) {
+    texture_cache_entry* entry = &texture_cache[index];
+    int* link = &texture_cache_buckets[entry->hash % TEXTURE_CACHE_SIZE];
+    
+    while (*link != index + 1) link = &texture_cache[*link - 1].next;
+    *link = entry->next;
+    
+    if (!entry->refs) texture_cache_unlink(index);
+    logmsg("GAME: UNLOADING TEXTURE %s\n", entry->src, "");
+    glDeleteTextures(1, &entry->tex.id);
+    texture_cache_used -= entry->size;
+    free(entry->src);
+    memset(entry, 0, sizeof(texture_cache_entry));
+}
+
+
+// Evicts least recently used textures until size bytes fit in budget
+// NOTE: Textures with references aren't in LRU list, And textures drawn in current frame are at its end, So neither gets evicted
+static void texture_cache_evict(unsigned long size) {
+    while (texture_cache_used + size > texture_cache_budget && texture_cache_lru_first) {
+        int lru = texture_cache_lru_first - 1;
+        
+        if (texture_cache[lru].last_used == frame_count) break;
+        texture_cache_remove(lru);
+        texture_cache_evictions++;
+    }
+}
+
+
+// Returns cache entry of texture, Decodes and uploads it if not cached yet (-1 if cache full)
+// NOTE: Sources failing to load are cached with texture id 0, So missing files aren't read again every frame
+static int texture_cache_get(char* src) {
+    unsigned int hash = hash_string(src);
+    int index = texture_cache_find(src, hash);
+    
+    if (index != -1) {
+        texture_cache_hits++;
+        texture_cache[index].last_used = frame_count;
+        
+        if (!texture_cache[index].refs) {
+            texture_cache_unlink(index);
+            texture_cache_link(index);
+        }
+        
+        return index;
+    }
+    
+    logmsg("GAME: LOADING TEXTURE %s\n", src, "");
+    texture_cache_misses++;
+    
+    int width = 0, height = 0, nrChannels;
+    unsigned char* data = stbi_load(src, &width, &height, &nrChannels, STBI_rgb_alpha);
+    
+    if (!data) {
+        logmsg("GAME: FAILED TO LOAD TEXTURE %s!\n", src, "");
+        width = height = 0;
+    }
+    
+    unsigned long size = (unsigned long)width * height * 4;
+    texture_cache_evict(size);
+    
+    for (index = 0; index < TEXTURE_CACHE_SIZE; index++) {
+        if (!texture_cache[index].src) break;
+    }
+    
+    // Every entry is used, So least recently drawn one makes room
+    if (index == TEXTURE_CACHE_SIZE && texture_cache_lru_first && texture_cache[texture_cache_lru_first - 1].last_used != frame_count) {
+        index = texture_cache_lru_first - 1;
+        texture_cache_remove(index);
+        texture_cache_evictions++;
+    }
+    
+    if (index == TEXTURE_CACHE_SIZE) {
+        logmsg("GAME: TEXTURE CACHE IS FULL, FAILED TO CACHE TEXTURE %s!\n", src, "");
+        if (data) stbi_image_free(data);
+        return -1;
+    }
+    
+    texture_cache_entry* entry = &texture_cache[index];
+    entry->src = malloc(strlen(src) + 1);
+    strcpy(entry->src, src);
+    entry->hash = hash;
+    entry->tex.width = width;
+    entry->tex.height = height;
+    entry->size = size;
+    entry->refs = 0;
+    entry->last_used = frame_count;
+    entry->next = texture_cache_buckets[hash % TEXTURE_CACHE_SIZE];
+    texture_cache_buckets[hash % TEXTURE_CACHE_SIZE] = index + 1;
+    texture_cache_used += size;
+    texture_cache_link(index);
+    
+    if (!data) return index;
+    
+    glGenTextures(1, &entry->tex.id);
+    glBindTexture(GL_TEXTURE_2D, entry->tex.id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    stbi_image_free(data);
+    return index;
+}
+
+
+texture load_texture(char* src) {
+    int index = texture_cache_get(src);
+    
+    if (index == -1) return (texture) { 0 };
+    if (!texture_cache[index].refs++) texture_cache_unlink(index);
+    return texture_cache[index].tex;
+}
+
+
+void unload_texture(char* src) {
+    int index = texture_cache_find(src, hash_string(src));
+    
+    if (index != -1 && texture_cache[index].refs > 0 && !--texture_cache[index].refs) texture_cache_link(index);
+}
+
+
+void texture_cache_clear(void) {
+    for (int i = 0; i < TEXTURE_CACHE_SIZE; i++) {
+        if (texture_cache[i].src) texture_cache_remove(i);
+    }
+}
+
+
+static void sprite_batch_push(unsigned int tex, float x1, float y1, float x2, float y2, float u1, float v1, float u2, float v2, color tint) {
+    if (sprite_batch_count == SPRITE_BATCH_SIZE) sprite_batch_flush();
+    
+    sprite_vertex* v = &sprite_batch_vertices[sprite_batch_count * 4];
+    unsigned char r = tint.r, g = tint.g, b = tint.b, a = tint.a;
+    
+    v[0] = (sprite_vertex) { x1, y1, u1, v1, r, g, b, a };
+    v[1] = (sprite_vertex) { x2, y1, u2, v1, r, g, b, a };
+    v[2] = (sprite_vertex) { x2, y2, u2, v2, r, g, b, a };
+    v[3] = (sprite_vertex) { x1, y2, u1, v2, r, g, b, a };
+    
+    sprite_batch_textures[sprite_batch_count] = tex;
+    sprite_batch_blends[sprite_batch_count] = (unsigned char)sprite_batch_blend;
+    sprite_batch_count++;
+}
+
+
+void draw_sprite(texture tex, rect srcRec, rect dstRec, color tint) {
+    if (!tex.id) return;
+    
+    if (!srcRec.w) srcRec.w = (float) tex.width;
+    if (!srcRec.h) srcRec.h = (float) tex.height;
+    if (!dstRec.w) dstRec.w = (float) tex.width;
+    if (!dstRec.h) dstRec.h = (float) tex.height;
+
+    float ix1 = (float) srcRec.x / tex.width;
+    float ix2 = (float) (srcRec.w + srcRec.x) / tex.width;
+    float iy1 = (float) srcRec.y / tex.height;
+    float iy2 = (float) (srcRec.h + srcRec.y) / tex.height;
+    
+    sprite_batch_push(tex.id, dstRec.x, dstRec.y, dstRec.x + dstRec.w, dstRec.y + dstRec.h, ix1, iy1, ix2, iy2, tint);
+}
+
+
+void draw_texture(char* src, rect srcRec, rect dstRec, color tint) {
+    texture page;
+    rect rec;
+    
+    // Images packed into atlas are drawn from their atlas page, So they batch with each other
+    if (atlas_lookup(src, &page, &rec)) {
+        if (!srcRec.w) srcRec.w = rec.w;
+        if (!srcRec.h) srcRec.h = rec.h;
+        if (!dstRec.w) dstRec.w = rec.w;
+        if (!dstRec.h) dstRec.h = rec.h;
+        
+        srcRec.x += rec.x;
+        srcRec.y += rec.y;
+        draw_sprite(page, srcRec, dstRec, tint);
+        return;
+    }
+    
+    int index = texture_cache_get(src);
+    
+    if (index != -1) draw_sprite(texture_cache[index].tex, srcRec, dstRec, tint);
+}
+
+
+void draw_rect(rect rec, color tint) {
+    sprite_batch_push(sprite_batch_white, rec.x, rec.y, rec.x + rec.w, rec.y + rec.h, 0, 0, 1, 1, tint);
+}
+
+
+void set_blend_mode(int mode) {
+    sprite_batch_blend = mode;
+}
+
+
+void sprite_batch_init(void) {
+    static const unsigned char white[4] = { 255, 255, 255, 255 };
+    
+    sprite_batch_vertices = malloc(sizeof(sprite_vertex) * 4 * SPRITE_BATCH_SIZE);
+    sprite_batch_textures = malloc(sizeof(unsigned int) * SPRITE_BATCH_SIZE);
+    sprite_batch_blends = malloc(SPRITE_BATCH_SIZE);
+    sprite_batch_keys = malloc(sizeof(unsigned long long) * SPRITE_BATCH_SIZE);
+    sprite_batch_count = 0;
+    sprite_batch_blend = BLEND_ALPHA;
+    
+    // Indices never change, So upload quads indices once
+    GLuint* indices = malloc(sizeof(GLuint) * 6 * SPRITE_BATCH_SIZE);
+    
+    for (GLuint i = 0; i < SPRITE_BATCH_SIZE; i++) {
+        indices[i * 6 + 0] = i * 4 + 0;
+        indices[i * 6 + 1] = i * 4 + 1;
+        indices[i * 6 + 2] = i * 4 + 2;
+        indices[i * 6 + 3] = i * 4 + 2;
+        indices[i * 6 + 4] = i * 4 + 3;
+        indices[i * 6 + 5] = i * 4 + 0;
+    }
+    
+    glGenBuffers(1, &sprite_batch_ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite_batch_ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * 6 * SPRITE_BATCH_SIZE, indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    free(indices);
+    
+    glGenBuffers(1, &sprite_batch_vbo);
+    
+    glGenTextures(1, &sprite_batch_white);
+    glBindTexture(GL_TEXTURE_2D, sprite_batch_white);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+static int sprite_batch_compare(const void* a, const void* b) {
+    unsigned long long ka = *(const unsigned long long*)a;
+    unsigned long long kb = *(const unsigned long long*)b;
+    return (ka > kb) - (ka < kb);
+}
+
+
+static void sprite_batch_set_blend(int mode) {
+    switch (mode) {
+        case BLEND_ADDITIVE: glBlendFunc(GL_SRC_ALPHA, GL_ONE); break;
+        case BLEND_MULTIPLY: glBlendFunc(GL_DST_COLOR, GL_ONE_MINUS_SRC_ALPHA); break;
+        default: glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); break;
+    }
+}
+
+
+// Draws all queued sprites, One draw call per run of sprites sharing texture and blend mode
+// NOTE: Call it before using OpenGL directly in draw, So sprites drawn before are not drawn over it
+void sprite_batch_flush(void) {
+    int count = sprite_batch_count;
+    if (!count) return;
+    
+    size_t size = sizeof(sprite_vertex) * 4 * count;
+    glBindBuffer(GL_ARRAY_BUFFER, sprite_batch_vbo);
+    
+    // Orphan previous buffer storage so driver doesn't wait for last frame draws to finish
+    glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+    
+    if (sprite_batch_sort) {
+        for (int i = 0; i < count; i++) {
+            sprite_batch_keys[i] = ((unsigned long long)sprite_batch_textures[i] << 32) | ((unsigned long long)sprite_batch_blends[i] << 24) | (unsigned int)i;
+        }
+        
+        qsort(sprite_batch_keys, count, sizeof(unsigned long long), sprite_batch_compare);
+        
+        sprite_vertex* mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        
+        for (int i = 0; i < count; i++) {
+            memcpy(&mapped[i * 4], &sprite_batch_vertices[((unsigned int)sprite_batch_keys[i] & 0xFFFFFF) * 4], sizeof(sprite_vertex) * 4);
+        }
+        
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    } else {
+        for (int i = 0; i < count; i++) sprite_batch_keys[i] = (unsigned int)i;
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, sprite_batch_vertices);
+    }
+    
+    glEnable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glActiveTexture(GL_TEXTURE0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite_batch_ibo);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(sprite_vertex), (void*)offsetof(sprite_vertex, x));
+    glTexCoordPointer(2, GL_FLOAT, sizeof(sprite_vertex), (void*)offsetof(sprite_vertex, u));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(sprite_vertex), (void*)offsetof(sprite_vertex, r));
+    
+    int first = 0;
+    
+    while (first < count) {
+        unsigned int index = (unsigned int)sprite_batch_keys[first] & 0xFFFFFF;
+        unsigned int tex = sprite_batch_textures[index];
+        int blend = sprite_batch_blends[index];
+        int last = first + 1;
+        
+        while (last < count) {
+            index = (unsigned int)sprite_batch_keys[last] & 0xFFFFFF;
+            if (sprite_batch_textures[index] != tex || sprite_batch_blends[index] != blend) break;
+            last++;
+        }
+        
+        glBindTexture(GL_TEXTURE_2D, tex);
+        sprite_batch_set_blend(blend);
+        glDrawElements(GL_TRIANGLES, (last - first) * 6, GL_UNSIGNED_INT, (void*)(sizeof(GLuint) * 6 * first));
+        sprite_batch_draw_calls++;
+        first = last;
+    }
+    
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_BLEND);
+    
+    sprite_batch_sprites += count;
+    sprite_batch_count = 0;
+}
+
+
+void sprite_batch_close(void) {
+    glDeleteBuffers(1, &sprite_batch_vbo);
+    glDeleteBuffers(1, &sprite_batch_ibo);
+    glDeleteTextures(1, &sprite_batch_white);
+    free(sprite_batch_vertices);
+    free(sprite_batch_textures);
+    free(sprite_batch_blends);
+    free(sprite_batch_keys);
+}
+
+
+void atlas_add(char* src) {
+    atlas_queue = realloc(atlas_queue, sizeof(char*) * (atlas_queue_count + 1));
+    atlas_queue[atlas_queue_count] = malloc(strlen(src) + 1);
+    strcpy(atlas_queue[atlas_queue_count], src);
+    atlas_queue_count++;
+}
+
+
+static atlas_entry* atlas_insert(char* src, int page, rect rec) {
+    atlas_entry* entry = &atlas_entries[atlas_entries_count];
+    
+    entry->src = malloc(strlen(src) + 1);
+    strcpy(entry->src, src);
+    entry->hash = hash_string(src);
+    entry->page = page;
+    entry->rec = rec;
+    entry->next = atlas_buckets[entry->hash % ATLAS_BUCKETS];
+    atlas_buckets[entry->hash % ATLAS_BUCKETS] = ++atlas_entries_count;
+    return entry;
+}
+
+
+static void atlas_upload_page(int page, unsigned char* pixels) {
+    atlas_pages[page].width = ATLAS_PAGE_SIZE;
+    atlas_pages[page].height = ATLAS_PAGE_SIZE;
+    glGenTextures(1, &atlas_pages[page].id);
+    glBindTexture(GL_TEXTURE_2D, atlas_pages[page].id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+// Finds lowest position in skyline where w x h rectangle fits (Returns node index or -1 if not fits)
+static int atlas_skyline_fit(int* nodes, int nodes_count, int w, int h, int* out_x, int* out_y) {
+    int best = -1, best_y = ATLAS_PAGE_SIZE, best_w = ATLAS_PAGE_SIZE + 1;
+    
+    // Skyline nodes are stored as x, y, width
+    for (int i = 0; i < nodes_count; i++) {
+        int x = nodes[i * 3], y = 0, left = w;
+        if (x + w > ATLAS_PAGE_SIZE) break;
+        
+        for (int j = i; left > 0 && j < nodes_count; j++) {
+            if (nodes[j * 3 + 1] > y) y = nodes[j * 3 + 1];
+            left -= nodes[j * 3 + 2];
+        }
+        
+        if (y + h > ATLAS_PAGE_SIZE) continue;
+        
+        if (y < best_y || (y == best_y && nodes[i * 3 + 2] < best_w)) {
+            best = i;
+            best_y = y;
+            best_w = nodes[i * 3 + 2];
+            *out_x = x;
+        }
+    }
+    
+    *out_y = best_y;
+    return best;
+}
+
+
+// Raises skyline over rectangle packed at node index, Returns new nodes count
+static int atlas_skyline_insert(int* nodes, int nodes_count, int index, int x, int y, int w, int h) {
+    memmove(&nodes[(index + 1) * 3], &nodes[index * 3], sizeof(int) * 3 * (nodes_count - index));
+    nodes[index * 3] = x;
+    nodes[index * 3 + 1] = y + h;
+    nodes[index * 3 + 2] = w;
+    nodes_count++;
+    
+    // Shrink or remove nodes now covered by new node
+    for (int i = index + 1; i < nodes_count; i++) {
+        int shrink = (nodes[(i - 1) * 3] + nodes[(i - 1) * 3 + 2]) - nodes[i * 3];
+        if (shrink <= 0) break;
+        
+        nodes[i * 3] += shrink;
+        nodes[i * 3 + 2] -= shrink;
+        if (nodes[i * 3 + 2] > 0) break;
+        
+        memmove(&nodes[i * 3], &nodes[(i + 1) * 3], sizeof(int) * 3 * (nodes_count - i - 1));
+        nodes_count--;
+        i--;
+    }
+    
+    // Merge neighbour nodes with same height
+    for (int i = 0; i < nodes_count - 1; i++) {
+        if (nodes[i * 3 + 1] == nodes[(i + 1) * 3 + 1]) {
+            nodes[i * 3 + 2] += nodes[(i + 1) * 3 + 2];
+            memmove(&nodes[(i + 1) * 3], &nodes[(i + 2) * 3], sizeof(int) * 3 * (nodes_count - i - 2));
+            nodes_count--;
+            i--;
+        }
+    }
+    
+    return nodes_count;
+}
+
+
+static unsigned char** atlas_sort_images;
+static int* atlas_sort_sizes;
+
+static int atlas_compare(const void* a, const void* b) {
+    int ia = *(const int*)a, ib = *(const int*)b;
+    int ha = atlas_sort_sizes[ia * 2 + 1], hb = atlas_sort_sizes[ib * 2 + 1];
+    return (ha != hb) ? hb - ha : atlas_sort_sizes[ib * 2] - atlas_sort_sizes[ia * 2];
+}
+
+
+// Packs images added with atlas_add into atlas pages (Skyline bottom-left, Tallest images first)
+// NOTE: Images which don't fit into any page are drawn from texture cache instead
+void atlas_build(void) {
+    // Queued sprites may still use pages atlas_clear deletes
+    sprite_batch_flush();
+    logmsg("GAME: BUILDING TEXTURE ATLAS...\n", "", "");
+    atlas_clear();
+    
+    int count = atlas_queue_count;
+    int* order = malloc(sizeof(int) * (count + 1));
+    atlas_sort_images = malloc(sizeof(unsigned char*) * (count + 1));
+    atlas_sort_sizes = malloc(sizeof(int) * 2 * (count + 1));
+    
+    for (int i = 0; i < count; i++) {
+        int channels;
+        order[i] = i;
+        atlas_sort_images[i] = stbi_load(atlas_queue[i], &atlas_sort_sizes[i * 2], &atlas_sort_sizes[i * 2 + 1], &channels, STBI_rgb_alpha);
+        
+        if (!atlas_sort_images[i]) {
+            logmsg("GAME: FAILED TO LOAD TEXTURE %s!\n", atlas_queue[i], "");
+            atlas_sort_sizes[i * 2] = atlas_sort_sizes[i * 2 + 1] = 0;
+        }
+    }
+    
+    qsort(order, count, sizeof(int), atlas_compare);
+    
+    atlas_entries = malloc(sizeof(atlas_entry) * (count + 1));
+    atlas_buckets = calloc(ATLAS_BUCKETS, sizeof(int));
+    
+    int* nodes = malloc(sizeof(int) * 3 * (ATLAS_PAGE_SIZE + 1));
+    unsigned char* pixels = malloc(ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4);
+    bool* packed = calloc(count + 1, sizeof(bool));
+    int remaining = count;
+    
+    // Fill one page at a time with images that still fit in it
+    while (remaining > 0 && atlas_pages_count < ATLAS_MAX_PAGES) {
+        int nodes_count = 1, page_used = 0;
+        nodes[0] = 0;
+        nodes[1] = 0;
+        nodes[2] = ATLAS_PAGE_SIZE;
+        memset(pixels, 0, ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4);
+        
+        for (int k = 0; k < count; k++) {
+            int i = order[k];
+            if (packed[i] || !atlas_sort_images[i]) continue;
+            
+            // Pad images by 1 pixel so linear filtering doesn't bleed neighbours in
+            int w = atlas_sort_sizes[i * 2], h = atlas_sort_sizes[i * 2 + 1];
+            int x, y, node = atlas_skyline_fit(nodes, nodes_count, w + 1, h + 1, &x, &y);
+            
+            if (node == -1) continue;
+            nodes_count = atlas_skyline_insert(nodes, nodes_count, node, x, y, w + 1, h + 1);
+            
+            for (int row = 0; row < h; row++) {
+                memcpy(&pixels[((y + row) * ATLAS_PAGE_SIZE + x) * 4], &atlas_sort_images[i][row * w * 4], w * 4);
+            }
+            
+            atlas_insert(atlas_queue[i], atlas_pages_count, (rect) { x, y, w, h });
+            packed[i] = true;
+            page_used++;
+            remaining--;
+        }
+        
+        if (!page_used) break;
+        atlas_upload_page(atlas_pages_count++, pixels);
+    }
+    
+    for (int i = 0; i < count; i++) {
+        if (atlas_sort_images[i]) stbi_image_free(atlas_sort_images[i]);
+        free(atlas_queue[i]);
+    }
+    
+    free(packed);
+    free(pixels);
+    free(nodes);
+    free(order);
+    free(atlas_sort_images);
+    free(atlas_sort_sizes);
+    free(atlas_queue);
+    atlas_queue = NULL;
+    atlas_queue_count = 0;
+    
+    logmsg("GAME: TEXTURE ATLAS BUILT SUCCESSFULLY!\n", "", "");
+}
+
+
+// Writes atlas pages and index to file, So atlas_load can skip packing on next launches
+bool atlas_save(char* dst) {
+    FILE* file = fopen(dst, "wb");
+    if (!file) return false;
+    
+    int header[4] = { 0x314C5441, ATLAS_PAGE_SIZE, atlas_pages_count, atlas_entries_count };
+    fwrite(header, sizeof(int), 4, file);
+    
+    for (int i = 0; i < atlas_entries_count; i++) {
+        atlas_entry* entry = &atlas_entries[i];
+        int info[6] = { (int)strlen(entry->src), entry->page, entry->rec.x, entry->rec.y, entry->rec.w, entry->rec.h };
+        fwrite(info, sizeof(int), 6, file);
+        fwrite(entry->src, 1, info[0], file);
+    }
+    
+    unsigned char* pixels = malloc(ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4);
+    
+    for (int i = 0; i < atlas_pages_count; i++) {
+        glBindTexture(GL_TEXTURE_2D, atlas_pages[i].id);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        fwrite(pixels, 1, ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4, file);
+    }
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+    free(pixels);
+    fclose(file);
+    return true;
+}
+
+
+bool atlas_load(char* src) {
+    FILE* file = fopen(src, "rb");
+    int header[4] = { 0 };
+    long size = 0;
+    
+    if (!file) return false;
+    
+    if (!fseek(file, 0, SEEK_END)) size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    // Each entry takes 6 ints at least, So entries count can't be bigger than file allows
+    if (fread(header, sizeof(int), 4, file) != 4 || header[0] != 0x314C5441 || header[1] != ATLAS_PAGE_SIZE ||
+        header[2] < 0 || header[2] > ATLAS_MAX_PAGES || header[3] < 0 || (long)header[3] > (size - (long)sizeof(header)) / (long)(sizeof(int) * 6)) {
+        logmsg("GAME: INVALID TEXTURE ATLAS %s!\n", src, "");
+        fclose(file);
+        return false;
+    }
+    
+    // Queued sprites may still use pages atlas_clear deletes
+    sprite_batch_flush();
+    atlas_clear();
+    atlas_entries = malloc(sizeof(atlas_entry) * (header[3] + 1));
+    atlas_buckets = calloc(ATLAS_BUCKETS, sizeof(int));
+    
+    unsigned char* pixels = malloc(ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4);
+    bool valid = atlas_entries && atlas_buckets && pixels;
+    
+    for (int i = 0; valid && i < header[3]; i++) {
+        int info[6];
+        char name[4096];
+        
+        valid = fread(info, sizeof(int), 6, file) == 6 && info[0] >= 0 && info[0] < (int)sizeof(name) && info[1] >= 0 && info[1] < header[2] &&
+                fread(name, 1, info[0], file) == (size_t)info[0];
+        if (!valid) break;
+        
+        name[info[0]] = 0;
+        atlas_insert(name, info[1], (rect) { info[2], info[3], info[4], info[5] });
+    }
+    
+    for (int i = 0; valid && i < header[2]; i++) {
+        valid = fread(pixels, 1, ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4, file) == ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4;
+        if (valid) atlas_upload_page(atlas_pages_count++, pixels);
+    }
+    
+    free(pixels);
+    fclose(file);
+    
+    // Truncated atlas would leave entries pointing to missing pages, So nothing of it is kept
+    if (!valid) {
+        logmsg("GAME: INVALID TEXTURE ATLAS %s!\n", src, "");
+        atlas_clear();
+        return false;
+    }
+    
+    return true;
+}
+
+
+// Returns atlas page image packed into and image rectangle in it (In pixels)
+bool atlas_lookup(char* src, texture* page, rect* rec) {
+    if (!atlas_entries_count) return false;
+    
+    unsigned int hash = hash_string(src);
+    int i = atlas_buckets[hash % ATLAS_BUCKETS];
+    
+    while (i) {
+        atlas_entry* entry = &atlas_entries[i - 1];
+        
+        if (entry->hash == hash && !strcmp(entry->src, src)) {
+            if (entry->page >= atlas_pages_count) return false;
+            *page = atlas_pages[entry->page];
+            *rec = entry->rec;
+            return true;
+        }
+        
+        i = entry->next;
+    }
+    
+    return false;
+}
+
+
+void atlas_clear(void) {
+    for (int i = 0; i < atlas_entries_count; i++) free(atlas_entries[i].src);
+    for (int i = 0; i < atlas_pages_count; i++) glDeleteTextures(1, &atlas_pages[i].id);
+    
+    free(atlas_entries);
+    free(atlas_buckets);
+    atlas_entries = NULL;
+    atlas_buckets = NULL;
+    atlas_entries_count = 0;
+    atlas_pages_count = 0;
+}
+
+
+void draw_text(spritefont font, char* text, float x, float y, float size, color tint) {
+    size_t c = 0;
+    
+    while (text[c] != '\0') {
+        draw_texture(font.src, font.chars[(unsigned char)text[c]], (rect) { x + c * size, y, size, size }, tint);
+        c++;
+    }
+}
+
+
+// Loads TTF font and bakes glyphs of Latin-1 characters into glyphs atlas
+font load_font(char* src, float size) {
+    font f = { 0 };
+    FILE* file = fopen(src, "rb");
+    
+    logmsg("GAME: LOADING FONT %s\n", src, "");
+    
+    if (!file) {
+        logmsg("GAME: FAILED TO LOAD FONT %s!\n", src, "");
+        return f;
+    }
+    
+    long length = -1;
+    if (!fseek(file, 0, SEEK_END)) length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    if (length > 0) f.data = malloc(length);
+    
+    if (!f.data || fread(f.data, 1, length, file) != (size_t)length) {
+        logmsg("GAME: FAILED TO LOAD FONT %s!\n", src, "");
+        free(f.data);
+        fclose(file);
+        return (font) { 0 };
+    }
+    
+    fclose(file);
+    
+    f.info = malloc(sizeof(stbtt_fontinfo));
+    f.glyphs = malloc(sizeof(stbtt_packedchar) * 224);
+    
+    if (!f.info || !f.glyphs || !stbtt_InitFont(f.info, f.data, stbtt_GetFontOffsetForIndex(f.data, 0))) {
+        logmsg("GAME: FAILED TO LOAD FONT %s!\n", src, "");
+        unload_font(f);
+        return (font) { 0 };
+    }
+    
+    stbtt_pack_context pack;
+    stbtt_pack_range range = { size, 32, NULL, 224, f.glyphs, 0, 0 };
+    unsigned char* pixels = malloc(FONT_ATLAS_SIZE * FONT_ATLAS_SIZE);
+    unsigned char* rgba = malloc(FONT_ATLAS_SIZE * FONT_ATLAS_SIZE * 4);
+    
+    if (!pixels || !rgba) {
+        logmsg("GAME: FAILED TO LOAD FONT %s!\n", src, "");
+        free(pixels);
+        free(rgba);
+        unload_font(f);
+        return (font) { 0 };
+    }
+    
+    stbtt_PackBegin(&pack, pixels, FONT_ATLAS_SIZE, FONT_ATLAS_SIZE, 0, 1, NULL);
+    if (!stbtt_PackFontRanges(&pack, f.data, 0, &range, 1)) logmsg("GAME: NOT ALL GLYPHS OF FONT %s FIT IN GLYPHS ATLAS!\n", src, "");
+    stbtt_PackEnd(&pack);
+    
+    // Glyphs atlas is white with coverage as alpha, So tint works same as sprites
+    for (int i = 0; i < FONT_ATLAS_SIZE * FONT_ATLAS_SIZE; i++) {
+        rgba[i * 4 + 0] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = 255;
+        rgba[i * 4 + 3] = pixels[i];
+    }
+    
+    glGenTextures(1, &f.id);
+    glBindTexture(GL_TEXTURE_2D, f.id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, FONT_ATLAS_SIZE, FONT_ATLAS_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    free(pixels);
+    free(rgba);
+    
+    int ascent, descent, line_gap;
+    float scale = stbtt_ScaleForPixelHeight(f.info, size);
+    stbtt_GetFontVMetrics(f.info, &ascent, &descent, &line_gap);
+    
+    f.size = size;
+    f.ascent = ascent * scale;
+    f.line_height = (ascent - descent + line_gap) * scale;
+    
+    logmsg("GAME: FONT %s LOADED SUCCESSFULLY!\n", src, "");
+    return f;
+}
+
+
+void unload_font(font f) {
+    // Cached layouts of font would point to deleted glyphs atlas
+    for (int i = 0; i < TEXT_CACHE_SIZE; i++) {
+        if (text_cache[i].text && text_cache[i].font_id == f.id) {
+            free(text_cache[i].text);
+            free(text_cache[i].quads);
+            memset(&text_cache[i], 0, sizeof(text_layout));
+        }
+    }
+    
+    if (f.id) glDeleteTextures(1, &f.id);
+    free(f.glyphs);
+    free(f.info);
+    free(f.data);
+}
+
+
+// Returns layout of text, Laying it out only if not cached already
+static text_layout* text_cache_get(font f, char* text) {
+    unsigned int hash = hash_string(text) ^ (f.id * 2654435761u);
+    text_layout* set = &text_cache[(hash % (TEXT_CACHE_SIZE / TEXT_CACHE_WAYS)) * TEXT_CACHE_WAYS];
+    text_layout* layout = &set[0];
+    
+    text_cache_uses++;
+    
+    for (int i = 0; i < TEXT_CACHE_WAYS; i++) {
+        if (set[i].text && set[i].hash == hash && set[i].font_id == f.id && !strcmp(set[i].text, text)) {
+            set[i].last_used = text_cache_uses;
+            return &set[i];
+        }
+        
+        // Free layout of set, Or least recently used one otherwise
+        if (layout->text && (!set[i].text || set[i].last_used < layout->last_used)) layout = &set[i];
+    }
+    
+    // Replace whatever layout used chosen slot
+    free(layout->text);
+    free(layout->quads);
+    
+    int length = (int)strlen(text);
+    layout->text = malloc(length + 1);
+    strcpy(layout->text, text);
+    layout->hash = hash;
+    layout->font_id = f.id;
+    layout->quads = malloc(sizeof(float) * 8 * (length + 1));
+    layout->count = 0;
+    layout->width = 0;
+    layout->last_used = text_cache_uses;
+    
+    float scale = stbtt_ScaleForPixelHeight(f.info, f.size);
+    float x = 0, y = f.ascent;
+    int prev = 0;
+    
+    for (int i = 0; i < length; i++) {
+        int ch = (unsigned char)text[i];
+        
+        if (ch == '\n') {
+            x = 0;
+            y += f.line_height;
+            prev = 0;
+            continue;
+        }
+        
+        if (ch < 32) continue;
+        if (prev) x += scale * stbtt_GetCodepointKernAdvance(f.info, prev, ch);
+        
+        stbtt_aligned_quad q;
+        stbtt_GetPackedQuad(f.glyphs, FONT_ATLAS_SIZE, FONT_ATLAS_SIZE, ch - 32, &x, &y, &q, 0);
+        
+        float* quad = &layout->quads[layout->count * 8];
+        quad[0] = q.x0; quad[1] = q.y0; quad[2] = q.x1; quad[3] = q.y1;
+        quad[4] = q.s0; quad[5] = q.t0; quad[6] = q.s1; quad[7] = q.t1;
+        layout->count++;
+        
+        if (x > layout->width) layout->width = x;
+        prev = ch;
+    }
+    
+    return layout;
+}
+
+
+// Draws text with TTF font, All glyphs go into sprite batch with same texture (One draw call)
+void draw_ttf_text(font f, char* text, float x, float y, color tint) {
+    if (!f.id) return;
+    
+    text_layout* layout = text_cache_get(f, text);
+    
+    for (int i = 0; i < layout->count; i++) {
+        float* q = &layout->quads[i * 8];
+        sprite_batch_push(f.id, x + q[0], y + q[1], x + q[2], y + q[3], q[4], q[5], q[6], q[7], tint);
+    }
+}
+
+
+float measure_ttf_text(font f, char* text) {
+    if (!f.id) return 0;
+    return text_cache_get(f, text)->width;
+}
+
+
+// CRC-32 of data, Used to detect torn or corrupted storage records
+static unsigned int storage_crc(unsigned int crc, const void* data, unsigned long size) {
+    static unsigned int table[256];
+    const unsigned char* bytes = data;
+    
+    if (!table[1]) {
+        for (unsigned int i = 0; i < 256; i++) {
+            unsigned int c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+    }
+    
+    crc = ~crc;
+    for (unsigned long i = 0; i < size; i++) crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+
+// Returns index slot of variable, Or free slot it should go into
+static storage_entry* storage_find(unsigned int position) {
+    unsigned int mask = storage_capacity - 1;
+    unsigned int i = (position * 2654435761u) >> 7 & mask;
+    
+    while (storage_index[i].value && storage_index[i].position != position) i = (i + 1) & mask;
+    return &storage_index[i];
+}
+
+
+static void storage_grow(void) {
+    storage_entry* old = storage_index;
+    unsigned int old_capacity = storage_capacity;
+    
+    storage_capacity = old_capacity ? old_capacity * 2 : 1024;
+    storage_index = calloc(storage_capacity, sizeof(storage_entry));
+    
+    for (unsigned int i = 0; i < old_capacity; i++) {
+        if (old[i].value) *storage_find(old[i].position) = old[i];
+    }
+    
+    free(old);
+}
+
+
+// Puts variable into index, Record it replaces becomes garbage (Unless it was never written)
+static storage_entry* storage_put(unsigned int position, const char* value, unsigned int size) {
+    storage_entry* entry = storage_find(position);
+    
+    if (entry->value) {
+        if (!entry->pending) storage_garbage += 3 * sizeof(unsigned int) + entry->size;
+        free(entry->value);
+    } else {
+        if ((storage_count + 1) * 4 > storage_capacity * 3) {
+            storage_grow();
+            entry = storage_find(position);
+        }
+        
+        entry->position = position;
+        entry->pending = false;
+        storage_count++;
+    }
+    
+    entry->value = malloc(size + 1);
+    memcpy(entry->value, value, size);
+    entry->value[size] = '\0';
+    entry->size = size;
+    return entry;
+}
+
+
+// Removes variable from index, Shifts back following entries so lookups never need tombstones
+static bool storage_erase(unsigned int position) {
+    storage_entry* entry = storage_find(position);
+    if (!entry->value) return false;
+    
+    if (!entry->pending) storage_garbage += 3 * sizeof(unsigned int) + entry->size;
+    free(entry->value);
+    entry->value = NULL;
+    storage_count--;
+    
+    unsigned int mask = storage_capacity - 1;
+    unsigned int hole = entry - storage_index;
+    
+    for (unsigned int i = (hole + 1) & mask; storage_index[i].value; i = (i + 1) & mask) {
+        unsigned int home = (storage_index[i].position * 2654435761u) >> 7 & mask;
+        
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            storage_index[hole] = storage_index[i];
+            storage_index[i].value = NULL;
+            hole = i;
+        }
+    }
+    
+    return true;
+}
+
+
+// Queues variable to be written by storage thread, Saving it again before that only writes latest value
+static void storage_stage(unsigned int position) {
+    if (storage_pending_count == storage_pending_capacity) {
+        storage_pending_capacity = storage_pending_capacity ? storage_pending_capacity * 2 : 256;
+        storage_pending = realloc(storage_pending, storage_pending_capacity * sizeof(unsigned int));
+    }
+    
+    storage_pending[storage_pending_count++] = position;
+}
+
+
+// Serializes record into storage buffer, Size of STORAGE_REMOVED means variable removed
+static void storage_append(unsigned int position, const char* value, unsigned int size) {
+    unsigned int length = (size == STORAGE_REMOVED) ? 0 : size;
+    unsigned int header[3] = { 0, position, size };
+    
+    while (storage_buffer_size + sizeof(header) + length > storage_buffer_capacity) {
+        storage_buffer_capacity = storage_buffer_capacity ? storage_buffer_capacity * 2 : 65536;
+        storage_buffer = realloc(storage_buffer, storage_buffer_capacity);
+    }
+    
+    header[0] = storage_crc(storage_crc(0, &header[1], 2 * sizeof(unsigned int)), value, length);
+    memcpy(storage_buffer + storage_buffer_size, header, sizeof(header));
+    if (length) memcpy(storage_buffer + storage_buffer_size + sizeof(header), value, length);
+    storage_buffer_size += sizeof(header) + length;
+}
+
+
+// Flushes file to disk itself (Not just to OS)
+static void storage_fsync(FILE* file) {
+    fflush(file);
+#if defined(_WIN32)
+    _commit(_fileno(file));
+#else
+    fsync(fileno(file));
+#endif
+}
+
+
+// Replays records of storage file into index, Returns false if file ends with torn or corrupted record
+static bool storage_read(FILE* file) {
+    unsigned int header[3];
+    char* buffer = NULL;
+    unsigned int buffer_size = 0;
+    
+    fseek(file, 0, SEEK_END);
+    long end = ftell(file);
+    fseek(file, sizeof(unsigned int), SEEK_SET);
+    
+    while (fread(header, sizeof(unsigned int), 3, file) == 3) {
+        unsigned int length = (header[2] == STORAGE_REMOVED) ? 0 : header[2];
+        long left = end - ftell(file);
+        if (left < 0 || length > (unsigned long)left) break;
+        
+        if (length > buffer_size) {
+            buffer_size = length;
+            buffer = realloc(buffer, buffer_size);
+        }
+        
+        if (fread(buffer, 1, length, file) != length) break;
+        if (storage_crc(storage_crc(0, &header[1], 2 * sizeof(unsigned int)), buffer, length) != header[0]) break;
+        
+        storage_size += sizeof(header) + length;
+        
+        if (header[2] == STORAGE_REMOVED) {
+            storage_erase(header[1]);
+            storage_garbage += sizeof(header);
+        } else {
+            storage_put(header[1], buffer, length);
+        }
+    }
+    
+    free(buffer);
+    return end >= 0 && storage_size == (unsigned long)end;
+}
+
+
+// Imports game.data written by old storage (One variable per line, Position is line number)
+static void storage_import(FILE* file) {
+    char line[256];
+    unsigned int position = 0;
+    
+    rewind(file);
+    
+    while (fgets(line, 256, file)) {
+        unsigned int size = strlen(line);
+        position++;
+        
+        if (size && line[size - 1] == '\n') line[--size] = '\0';
+        if (size) storage_put(position, line, size);
+    }
+    
+    logmsg("GAME: IMPORTED OLD STORAGE FILE!\n", "", "");
+}
+
+
+// Replaces dst with src, Atomic so game.data is either old or new file after crash
+static bool storage_replace(const char* src, const char* dst) {
+#if defined(_WIN32)
+    return MoveFileExA(src, dst, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    return !rename(src, dst);
+#endif
+}
+
+
+// Writes snapshot in storage buffer to game.tmp, Syncs it and swaps it with game.data
+static void storage_rewrite(void) {
+    FILE* file = fopen("game.tmp", "wb");
+    unsigned int magic = STORAGE_MAGIC;
+    
+    if (!file) {
+        logmsg("GAME: FAILED TO WRITE STORAGE SNAPSHOT!\n", "", "");
+        return;
+    }
+    
+    fwrite(&magic, sizeof(unsigned int), 1, file);
+    fwrite(storage_buffer, 1, storage_buffer_size, file);
+    storage_fsync(file);
+    
+    if (ferror(file)) {
+        logmsg("GAME: FAILED TO WRITE STORAGE SNAPSHOT!\n", "", "");
+        fclose(file);
+        remove("game.tmp");
+        return;
+    }
+    
+    fclose(file);
+    if (game_data) fclose(game_data);
+    
+    if (storage_replace("game.tmp", "game.data")) {
+        storage_size = sizeof(unsigned int) + storage_buffer_size;
+    } else {
+        logmsg("GAME: FAILED TO WRITE STORAGE SNAPSHOT!\n", "", "");
+        remove("game.tmp");
+    }
+    
+    game_data = fopen("game.data", "ab");
+}
+
+
+// Writes variables saved since last call to game.data, Or whole snapshot if compaction needed
+static void storage_write(void) {
+    ma_mutex_lock(&storage_lock);
+    
+    bool snapshot = storage_snapshot || (storage_garbage > STORAGE_COMPACT_SIZE && storage_garbage > storage_size / 2);
+    storage_buffer_size = 0;
+    
+    if (snapshot) {
+        for (unsigned int i = 0; i < storage_capacity; i++) {
+            storage_entry* entry = &storage_index[i];
+            if (!entry->value) continue;
+            
+            storage_append(entry->position, entry->value, entry->size);
+            entry->pending = false;
+        }
+        
+        storage_garbage = 0;
+        storage_snapshot = false;
+    } else {
+        for (unsigned int i = 0; i < storage_pending_count; i++) {
+            storage_entry* entry = storage_find(storage_pending[i]);
+            
+            if (!entry->value) {
+                storage_append(storage_pending[i], NULL, STORAGE_REMOVED);
+                storage_garbage += 3 * sizeof(unsigned int);
+            } else if (entry->pending) {
+                storage_append(entry->position, entry->value, entry->size);
+                entry->pending = false;
+            }
+        }
+    }
+    
+    storage_pending_count = 0;
+    ma_mutex_unlock(&storage_lock);
+    
+    if (snapshot) {
+        storage_rewrite();
+    } else if (storage_buffer_size && game_data) {
+        fwrite(storage_buffer, 1, storage_buffer_size, game_data);
+        storage_size += storage_buffer_size;
+        
+        if (storage_sync == STORAGE_SYNC_CLOSE) {
+            fflush(game_data);
+        } else {
+            storage_fsync(game_data);
+        }
+    }
+}
+
+
+// Storage thread, Writes saves in background so game never waits for disk
+static ma_thread_result MA_THREADCALL storage_thread_main(void* data) {
+    (void)data;
+    
+    while (c89atomic_load_32(&storage_running)) {
+        ma_event_wait(&storage_event);
+        
+        // Let saves gather for a while so they get written and synced together
+        if (storage_sync == STORAGE_SYNC_INTERVAL) {
+            for (int slept = 0; slept < storage_sync_interval && c89atomic_load_32(&storage_running); slept += 10) ma_sleep(10);
+        }
+        
+        storage_write();
+    }
+    
+    return (ma_thread_result)0;
+}
+
+
+void storage_init(void) {
+    if (storage_running) return;
+    
+    logmsg("GAME: INITIALIZING STORAGE...\n", "", "");
+    
+    if (!storage_index) storage_grow();
+    storage_size = sizeof(unsigned int);
+    storage_garbage = 0;
+    storage_snapshot = true;
+    
+    FILE* file = fopen("game.data", "rb");
+    
+    if (file) {
+        unsigned int magic = 0;
+        
+        if (fread(&magic, sizeof(unsigned int), 1, file) == 1 && magic == STORAGE_MAGIC) {
+            storage_snapshot = !storage_read(file);
+            if (storage_snapshot) logmsg("GAME: STORAGE FILE ENDS WITH CORRUPTED RECORD, DROPPING IT...\n", "", "");
+        } else {
+            storage_import(file);
+        }
+        
+        fclose(file);
+    }
+    
+    if (ma_mutex_init(&storage_lock) != MA_SUCCESS) {
+        logmsg("GAME: STORAGE INITIALIZATION FAILED!\n", "", "");
+        return;
+    }
+    
+    if (ma_event_init(&storage_event) != MA_SUCCESS) {
+        logmsg("GAME: STORAGE INITIALIZATION FAILED!\n", "", "");
+        ma_mutex_uninit(&storage_lock);
+        return;
+    }
+    
+    if (storage_snapshot) {
+        storage_write();
+    } else {
+        game_data = fopen("game.data", "ab");
+    }
+    
+    // Storage thread runs while storage_running is set, So it's set before thread starts
+    c89atomic_store_32(&storage_running, 1);
+    
+    // Next save calls storage_init again, So nothing initialized here may stay initialized
+    if (!game_data || ma_thread_create(&storage_thread, ma_thread_priority_low, 0, storage_thread_main, NULL) != MA_SUCCESS) {
+        logmsg("GAME: STORAGE INITIALIZATION FAILED!\n", "", "");
+        c89atomic_store_32(&storage_running, 0);
+        
+        if (game_data) {
+            fclose(game_data);
+            game_data = NULL;
+        }
+        
+        ma_event_uninit(&storage_event);
+        ma_mutex_uninit(&storage_lock);
+        return;
+    }
+    
+    logmsg("GAME: STORAGE INITIALIZED SUCCESSFULLY!\n", "", "");
+}
+
+
+// Saves string to position, Only updates memory and wakes storage thread to write it
+void storage_save_string(char* string, unsigned int position) {
+    if (!storage_running) storage_init();
+    if (!storage_running) return;
+    
+    ma_mutex_lock(&storage_lock);
+    storage_entry* entry = storage_put(position, string, strlen(string));
+    
+    if (!entry->pending) {
+        entry->pending = true;
+        storage_stage(position);
+    }
+    
+    ma_mutex_unlock(&storage_lock);
+    ma_event_signal(&storage_event);
+}
+
+
+void storage_save_var(double var, unsigned int position) {
+    char var_tostr[64];
+    snprintf(var_tostr, 64, "%f", var);
+    storage_save_string(var_tostr, position);
+}
+
+
+// Returns string saved to position (Empty string if nothing saved), Served from memory
+char* storage_load_string(unsigned int position) {
+    if (!storage_running) storage_init();
+    
+    loaded_variable_value[0] = '\0';
+    if (!storage_index) return loaded_variable_value;
+    
+    storage_entry* entry = storage_find(position);
+    
+    if (entry->value) {
+        strncpy(loaded_variable_value, entry->value, sizeof(loaded_variable_value) - 1);
+        loaded_variable_value[sizeof(loaded_variable_value) - 1] = '\0';
+    }
+    
+    return loaded_variable_value;
+}
+
+double storage_load_var(unsigned int position) {
+    return atof(storage_load_string(position));
+}
+
+
+void storage_remove_var(unsigned int position) {
+    if (!storage_running) storage_init();
+    if (!storage_running) return;
+    
+    ma_mutex_lock(&storage_lock);
+    if (storage_erase(position)) storage_stage(position);
+    ma_mutex_unlock(&storage_lock);
+    ma_event_signal(&storage_event);
+}
+
+
+// Rewrites game.data without overwritten and removed variables (Also done automatically)
+void storage_compact(void) {
+    if (!storage_running) storage_init();
+    if (!storage_running) return;
+    
+    ma_mutex_lock(&storage_lock);
+    storage_snapshot = true;
+    ma_mutex_unlock(&storage_lock);
+    ma_event_signal(&storage_event);
 }
 
 
 void storage_clear(void) {
-    /*
-    game_data = fopen("game.data", "w");
-    fclose(game_data);
-    */
-	
-    remove("game.data");
+    if (!storage_running) {
+        remove("game.data");
+        return;
+    }
+    
+    ma_mutex_lock(&storage_lock);
+    
+    for (unsigned int i = 0; i < storage_capacity; i++) {
+        free(storage_index[i].value);
+        storage_index[i].value = NULL;
+    }
+    
+    storage_count = 0;
+    storage_pending_count = 0;
+    storage_snapshot = true;
+    ma_mutex_unlock(&storage_lock);
+    ma_event_signal(&storage_event);
+}
+
+
+// Stops storage thread, Writes and syncs remaining saves
+void storage_close(void) {
+    if (storage_running) {
+        c89atomic_store_32(&storage_running, 0);
+        ma_event_signal(&storage_event);
+        ma_thread_wait(&storage_thread);
+        
+        if (storage_garbage > storage_size / 2) storage_snapshot = true;
+        storage_write();
+        
+        if (game_data) {
+            storage_fsync(game_data);
+            fclose(game_data);
+            game_data = NULL;
+        }
+        
+        ma_event_uninit(&storage_event);
+        ma_mutex_uninit(&storage_lock);
+    }
+    
+    for (unsigned int i = 0; i < storage_capacity; i++) free(storage_index[i].value);
+    free(storage_index);
+    free(storage_pending);
+    free(storage_buffer);
+    storage_index = NULL;
+    storage_pending = NULL;
+    storage_buffer = NULL;
+    storage_capacity = 0;
+    storage_count = 0;
+    storage_pending_count = 0;
+    storage_pending_capacity = 0;
+    storage_buffer_capacity = 0;
+}
+
+
+// ENet memory, Freed blocks are kept per size class and reused so steady traffic never reaches system allocator
+// NOTE: Only called from network thread (Or game thread while network thread not running)
+static void* ENET_CALLBACK net_malloc(size_t size) {
+    int size_class = 0;
+    while (size_class < NET_BLOCK_CLASSES && ((size_t)64 << size_class) < size) size_class++;
+    
+    net_block* block = NULL;
+    
+    if (size_class < NET_BLOCK_CLASSES && net_blocks[size_class]) {
+        block = net_blocks[size_class];
+        net_blocks[size_class] = block->next;
+    } else {
+        block = malloc(sizeof(net_block) + ((size_class < NET_BLOCK_CLASSES) ? ((size_t)64 << size_class) : size));
+        if (!block) return NULL;
+        net_mallocs++;
+    }
+    
+    block->size_class = (size_class < NET_BLOCK_CLASSES) ? size_class : -1;
+    return block + 1;
+}
+
+
+static void ENET_CALLBACK net_free(void* memory) {
+    if (!memory) return;
+    
+    net_block* block = (net_block*)memory - 1;
+    int size_class = block->size_class;
+    
+    if (size_class < 0) {
+        free(block);
+        return;
+    }
+    
+    block->next = net_blocks[size_class];
+    net_blocks[size_class] = block;
+}
+
+
+static unsigned int net_hash(const unsigned char* data) {
+    unsigned int value;
+    memcpy(&value, data, 4);
+    return (value * 2654435761u) >> (32 - NET_COMPRESS_HASH_BITS);
+}
+
+
+// Writes length beyond 15 stored in token as run of bytes (255 means more follow)
+static bool net_write_length(unsigned char* out, size_t* position, size_t limit, size_t length) {
+    while (length >= 255) {
+        if (*position >= limit) return false;
+        out[(*position)++] = 255;
+        length -= 255;
+    }
+    
+    if (*position >= limit) return false;
+    out[(*position)++] = (unsigned char)length;
+    return true;
+}
+
+
+// Writes literals and match after them (No match if length is 0), Returns false if output limit reached
+static bool net_write_sequence(unsigned char* out, size_t* position, size_t limit, const unsigned char* literals, size_t literals_count, size_t offset, size_t length) {
+    size_t match = length ? length - NET_COMPRESS_MIN_MATCH : 0;
+    
+    if (*position >= limit) return false;
+    out[(*position)++] = (unsigned char)(((literals_count < 15) ? literals_count : 15) << 4 | ((match < 15) ? match : 15));
+    if (literals_count >= 15 && !net_write_length(out, position, limit, literals_count - 15)) return false;
+    
+    if (*position + literals_count > limit) return false;
+    memcpy(out + *position, literals, literals_count);
+    *position += literals_count;
+    
+    if (!length) return true;
+    
+    if (*position + 2 > limit) return false;
+    out[(*position)++] = (unsigned char)offset;
+    out[(*position)++] = (unsigned char)(offset >> 8);
+    return (match < 15) || net_write_length(out, position, limit, match - 15);
+}
+
+
+// Compresses datagram with LZ matches within it or into dictionary (Token, Literals, 16 bit offset like LZ4)
+// NOTE: Returns 0 if datagram doesn't get smaller, ENet sends it uncompressed then
+static size_t ENET_CALLBACK net_compress(void* context, const ENetBuffer* in_buffers, size_t in_count, size_t in_limit, enet_uint8* out, size_t out_limit) {
+    net_compressor* compressor = (net_compressor*)context;
+    unsigned char* in = compressor->input;
+    size_t size = 0;
+    size_t position = 0;
+    
+    if (in_limit > sizeof(compressor->input)) return 0;
+    
+    double start = ma_timer_get_time_in_seconds(&net_timer);
+    
+    for (size_t i = 0; i < in_count; i++) {
+        memcpy(in + size, in_buffers[i].data, in_buffers[i].dataLength);
+        size += in_buffers[i].dataLength;
+    }
+    
+    if (net_trace) {
+        unsigned short length = (unsigned short)size;
+        fwrite(&length, sizeof(length), 1, net_trace);
+        fwrite(in, 1, size, net_trace);
+    }
+    
+    // Positions of earlier datagrams are below base, So table never needs clearing
+    if (compressor->base > 0x7FFFFFFF - sizeof(compressor->input)) {
+        memset(compressor->table, 0, sizeof(compressor->table));
+        compressor->base = 1;
+    }
+    
+    unsigned int base = compressor->base;
+    size_t anchor = 0;
+    size_t ip = 0;
+    bool fits = true;
+    
+    while (fits && ip + NET_COMPRESS_MIN_MATCH <= size) {
+        unsigned int hash = net_hash(in + ip);
+        unsigned int candidate = compressor->table[hash];
+        size_t offset = 0;
+        size_t length = 0;
+        
+        compressor->table[hash] = base + (unsigned int)ip;
+        
+        if (candidate >= base && !memcmp(in + (candidate - base), in + ip, NET_COMPRESS_MIN_MATCH)) {
+            size_t match = candidate - base;
+            offset = ip - match;
+            length = NET_COMPRESS_MIN_MATCH;
+            while (ip + length < size && in[match + length] == in[ip + length]) length++;
+        } else if (net_dictionary_table[hash]) {
+            // Matches into dictionary stop at its end, So decompressor copies them in one piece
+            size_t match = net_dictionary_table[hash] - 1;
+            
+            if (ip + net_dictionary_size - match <= 0xFFFF && !memcmp(net_dictionary_data + match, in + ip, NET_COMPRESS_MIN_MATCH)) {
+                offset = ip + net_dictionary_size - match;
+                length = NET_COMPRESS_MIN_MATCH;
+                while (ip + length < size && match + length < net_dictionary_size && net_dictionary_data[match + length] == in[ip + length]) length++;
+            }
+        }
+        
+        if (!length) {
+            ip++;
+            continue;
+        }
+        
+        fits = net_write_sequence(out, &position, out_limit, in + anchor, ip - anchor, offset, length);
+        
+        for (size_t i = ip + 1; i + NET_COMPRESS_MIN_MATCH <= size && i < ip + length; i++) compressor->table[net_hash(in + i)] = base + (unsigned int)i;
+        
+        ip += length;
+        anchor = ip;
+    }
+    
+    if (fits && anchor < size) fits = net_write_sequence(out, &position, out_limit, in + anchor, size - anchor, 0, 0);
+    if (!fits || position >= size) position = 0;
+    
+    compressor->base += (unsigned int)size;
+    net_compress_in += size;
+    net_compress_out += position ? position : size;
+    net_compress_time += ma_timer_get_time_in_seconds(&net_timer) - start;
+    return position;
+}
+
+
+static size_t ENET_CALLBACK net_decompress(void* context, const enet_uint8* in, size_t in_limit, enet_uint8* out, size_t out_limit) {
+    (void)context;
+    double start = ma_timer_get_time_in_seconds(&net_timer);
+    size_t ip = 0;
+    size_t op = 0;
+    
+    while (ip < in_limit) {
+        unsigned int token = in[ip++];
+        size_t literals_count = token >> 4;
+        size_t length = (token & 15) + NET_COMPRESS_MIN_MATCH;
+        unsigned int extra = 255;
+        
+        while (literals_count >= 15 && extra == 255) {
+            if (ip >= in_limit) return 0;
+            extra = in[ip++];
+            literals_count += extra;
+        }
+        
+        if (ip + literals_count > in_limit || op + literals_count > out_limit) return 0;
+        memcpy(out + op, in + ip, literals_count);
+        ip += literals_count;
+        op += literals_count;
+        
+        if (ip == in_limit) break;
+        if (ip + 2 > in_limit) return 0;
+        
+        size_t offset = in[ip] | (in[ip + 1] << 8);
+        ip += 2;
+        extra = 255;
+        
+        while ((token & 15) == 15 && extra == 255) {
+            if (ip >= in_limit) return 0;
+            extra = in[ip++];
+            length += extra;
+        }
+        
+        if (!offset || op + length > out_limit) return 0;
+        
+        if (offset <= op) {
+            // Byte by byte, Since match can overlap bytes it produces
+            for (size_t i = 0; i < length; i++, op++) out[op] = out[op - offset];
+        } else {
+            size_t distance = offset - op;
+            if (distance > net_dictionary_size || length > distance) return 0;
+            memcpy(out + op, net_dictionary_data + net_dictionary_size - distance, length);
+            op += length;
+        }
+    }
+    
+    net_decompress_in += in_limit;
+    net_decompress_out += op;
+    net_decompress_time += ma_timer_get_time_in_seconds(&net_timer) - start;
+    return op;
+}
+
+
+static void ENET_CALLBACK net_compressor_destroy(void* context) {
+    free(context);
+}
+
+
+// Appends data to dictionary, Dropping oldest bytes beyond NET_DICTIONARY_SIZE
+static void net_dictionary_append(const unsigned char* data, size_t size) {
+    if (size >= NET_DICTIONARY_SIZE) {
+        memcpy(net_dictionary_data, data + size - NET_DICTIONARY_SIZE, NET_DICTIONARY_SIZE);
+        net_dictionary_size = NET_DICTIONARY_SIZE;
+        return;
+    }
+    
+    size_t keep = (net_dictionary_size + size > NET_DICTIONARY_SIZE) ? NET_DICTIONARY_SIZE - size : net_dictionary_size;
+    memmove(net_dictionary_data, net_dictionary_data + net_dictionary_size - keep, keep);
+    memcpy(net_dictionary_data + keep, data, size);
+    net_dictionary_size = (unsigned int)(keep + size);
+}
+
+
+// Indexes dictionary positions by hash of their 4 bytes (Later positions win)
+static void net_dictionary_index(void) {
+    memset(net_dictionary_table, 0, sizeof(net_dictionary_table));
+    
+    for (unsigned int i = 0; i + NET_COMPRESS_MIN_MATCH <= net_dictionary_size; i++) {
+        net_dictionary_table[net_hash(net_dictionary_data + i)] = (unsigned short)(i + 1);
+    }
+}
+
+
+// Primes compression dictionary with typical packet data (Keeps last NET_DICTIONARY_SIZE bytes)
+// NOTE: Call before net_listen or net_connect, Server and clients must prime same dictionary
+void net_dictionary(const void* data, size_t size) {
+    net_dictionary_append((const unsigned char*)data, size);
+    net_dictionary_index();
+}
+
+
+// Primes compression dictionary with datagrams of trace written with net_record (Last ones are kept)
+bool net_dictionary_load(char* src) {
+    unsigned char datagram[NET_COMPRESS_INPUT];
+    unsigned short length;
+    FILE* f = fopen(src, "rb");
+    
+    if (!f) return false;
+    
+    while (fread(&length, sizeof(length), 1, f) == 1 && length <= sizeof(datagram) && fread(datagram, 1, length, f) == length) {
+        net_dictionary_append(datagram, length);
+    }
+    
+    fclose(f);
+    net_dictionary_index();
+    return true;
+}
+
+
+static bool net_ring_push(net_ring* ring, net_event* event) {
+    unsigned int head = ring->head;
+    if (head - c89atomic_load_32(&ring->tail) >= NET_QUEUE_SIZE) return false;
+    
+    ring->events[head % NET_QUEUE_SIZE] = *event;
+    c89atomic_store_32(&ring->head, head + 1);
+    return true;
+}
+
+
+static bool net_ring_pop(net_ring* ring, net_event* event) {
+    unsigned int tail = ring->tail;
+    if (tail == c89atomic_load_32(&ring->head)) return false;
+    
+    *event = ring->events[tail % NET_QUEUE_SIZE];
+    c89atomic_store_32(&ring->tail, tail + 1);
+    return true;
+}
+
+
+// Runs commands queued by game thread
+static void net_run_commands(void) {
+    net_event command;
+    
+    while (net_ring_pop(&net_outbound, &command)) {
+        ENetPeer* peer = (command.peer < net_host->peerCount) ? &net_host->peers[command.peer] : NULL;
+        
+        switch (command.type) {
+            case NET_SEND:
+                // ENet owns packet once sent, Otherwise it's destroyed here (Peer disconnected before packet got out)
+                if (!peer || peer->state != ENET_PEER_STATE_CONNECTED || enet_peer_send(peer, (enet_uint8)command.channel, command.packet) < 0) {
+                    enet_packet_destroy(command.packet);
+                }
+                break;
+            case NET_BROADCAST:
+                enet_host_broadcast(net_host, (enet_uint8)command.channel, command.packet);
+                break;
+            case NET_RELEASE:
+                if (command.packet->referenceCount == 0) enet_packet_destroy(command.packet);
+                break;
+            case NET_DISCONNECT:
+                if (peer) enet_peer_disconnect(peer, 0);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+
+// Makes spare packets taken by net_packet since last call
+static void net_refill(void) {
+    unsigned int head = net_spare_head;
+    
+    while (head - c89atomic_load_32(&net_spare_tail) < NET_SPARE_PACKETS) {
+        ENetPacket* packet = enet_packet_create(NULL, NET_PACKET_SIZE, 0);
+        if (!packet) break;
+        
+        net_spare[head % NET_SPARE_PACKETS] = packet;
+        head++;
+    }
+    
+    c89atomic_store_32(&net_spare_head, head);
+}
+
+
+// Network thread, Owns host so sending and receiving never waits for game thread (Or game thread for socket)
+static ma_thread_result MA_THREADCALL net_thread_main(void* data) {
+    (void)data;
+    ENetEvent event;
+    net_event pending;
+    bool stalled = false;
+    
+    while (c89atomic_load_32(&net_running)) {
+        net_run_commands();
+        net_refill();
+        
+        // Stop receiving while inbound queue is full, So packets wait in ENet and socket instead of being dropped
+        if (stalled) {
+            if (!net_ring_push(&net_inbound, &pending)) {
+                ma_sleep(1);
+                continue;
+            }
+            
+            stalled = false;
+        }
+        
+        // Wake every millisecond while peers connected, So packets queued by game thread go out without waiting for more packets to arrive
+        int result = enet_host_service(net_host, &event, net_host->connectedPeers ? 1 : 10);
+        
+        while (result > 0) {
+            pending.type = (event.type == ENET_EVENT_TYPE_CONNECT) ? NET_CONNECT : ((event.type == ENET_EVENT_TYPE_RECEIVE) ? NET_RECEIVE : NET_DISCONNECT);
+            pending.peer = event.peer->incomingPeerID;
+            pending.channel = event.channelID;
+            pending.packet = event.packet;
+            pending.time = ma_timer_get_time_in_seconds(&net_timer);
+            pending.bandwidth = event.peer->incomingBandwidth;
+            
+            if (!net_ring_push(&net_inbound, &pending)) {
+                stalled = true;
+                net_stalls++;
+                break;
+            }
+            
+            result = enet_host_check_events(net_host, &event);
+        }
+    }
+    
+    if (stalled) enet_packet_destroy(pending.packet);
+    return (ma_thread_result)0;
+}
+
+
+// Starts network thread servicing host, Game thread must not use host after this
+static bool net_start(ENetHost* host) {
+    if (!host) return false;
+    
+    net_host = host;
+    net_peer_count = (unsigned int)host->peerCount;
+    ma_timer_init(&net_timer);
+    net_compress_in = 0;
+    net_compress_out = 0;
+    net_decompress_in = 0;
+    net_decompress_out = 0;
+    net_compress_time = 0;
+    net_decompress_time = 0;
+    
+    // Compressor context belongs to host, ENet frees it when host gets destroyed
+    if (net_compression) {
+        ENetCompressor compressor = { calloc(1, sizeof(net_compressor)), net_compress, net_decompress, net_compressor_destroy };
+        
+        if (compressor.context) {
+            ((net_compressor*)compressor.context)->base = 1;
+            enet_host_compress(host, &compressor);
+            if (net_record) net_trace = fopen("net.trace", "wb");
+        }
+    }
+    
+    net_refill();
+    c89atomic_store_32(&net_running, 1);
+    
+    if (ma_thread_create(&net_thread, ma_thread_priority_default, 0, net_thread_main, NULL) != MA_SUCCESS) {
+        c89atomic_store_32(&net_running, 0);
+        net_close();
+        return false;
+    }
+    
+    return true;
+}
+
+
+// Starts network thread with host peers can connect to on port
+bool net_listen(int port, int peers) {
+    ENetAddress address = { 0 };
+    
+    if (net_host) return false;
+    
+    address.host = ENET_HOST_ANY;
+    address.port = (enet_uint16)port;
+    net_listening = true;
+    return net_start(enet_host_create(&address, peers, SERVER_CHANNELS, net_incoming_bandwidth, net_outgoing_bandwidth));
+}
+
+
+// Starts network thread with host connecting to address and port (NET_CONNECT received when connected as peer 0)
+bool net_connect(char* address, int port) {
+    ENetAddress server_address = { 0 };
+    
+    if (net_host || enet_address_set_host(&server_address, address) != 0) return false;
+    
+    server_address.port = (enet_uint16)port;
+    net_listening = false;
+    ENetHost* host = enet_host_create(NULL, 1, SERVER_CHANNELS, net_incoming_bandwidth, net_outgoing_bandwidth);
+    if (!host) return false;
+    
+    if (!enet_host_connect(host, &server_address, SERVER_CHANNELS, 0)) {
+        enet_host_destroy(host);
+        return false;
+    }
+    
+    return net_start(host);
+}
+
+
+// Takes next event received by network thread (Packet of NET_RECEIVE event must be released with net_release)
+bool net_poll(net_event* event) {
+    return net_ring_pop(&net_inbound, event);
+}
+
+
+// Passes received events to network, Then releases their packets
+static void net_dispatch(void) {
+    net_event event;
+    
+    while (net_ring_pop(&net_inbound, &event)) {
+        if (event.type == NET_RECEIVE && event.channel == SNAPSHOT_CHANNEL) {
+            snapshot_receive(&event);
+        } else {
+            if (event.type != NET_RECEIVE) snapshot_peer_reset(&event);
+            network(&event);
+        }
+        
+        if (event.packet) net_release(event.packet);
+    }
+}
+
+
+// Returns empty packet of size to fill and send, Taken from spare packets so it never allocates while they last
+// NOTE: Packet must be sent with net_send or net_broadcast, Or given back with net_release
+ENetPacket* net_packet(size_t size, unsigned int flags) {
+    unsigned int tail = net_spare_tail;
+    
+    if (size <= NET_PACKET_SIZE && tail != c89atomic_load_32(&net_spare_head)) {
+        ENetPacket* packet = net_spare[tail % NET_SPARE_PACKETS];
+        c89atomic_store_32(&net_spare_tail, tail + 1);
+        packet->dataLength = size;
+        packet->flags = flags;
+        return packet;
+    }
+    
+    // Allocated from system directly like net_malloc does for big blocks, Since size class pools belong to network thread
+    net_packet_misses++;
+    net_block* block = malloc(sizeof(net_block) + sizeof(ENetPacket) + size);
+    if (!block) return NULL;
+    
+    block->size_class = -1;
+    ENetPacket* packet = (ENetPacket*)(block + 1);
+    packet->referenceCount = 0;
+    packet->flags = flags;
+    packet->data = (enet_uint8*)(packet + 1);
+    packet->dataLength = size;
+    packet->freeCallback = NULL;
+    packet->userData = NULL;
+    return packet;
+}
+
+
+// Queues packet to be sent to peer, Returns false if outbound queue is full (Packet still yours then)
+bool net_send(unsigned int peer, int channel, ENetPacket* packet) {
+    net_event command = { NET_SEND, peer, (unsigned int)channel, packet, 0, 0 };
+    return c89atomic_load_32(&net_running) && net_ring_push(&net_outbound, &command);
+}
+
+
+// Queues packet to be sent to all connected peers, Returns false if outbound queue is full (Packet still yours then)
+bool net_broadcast(int channel, ENetPacket* packet) {
+    net_event command = { NET_BROADCAST, 0, (unsigned int)channel, packet, 0, 0 };
+    return c89atomic_load_32(&net_running) && net_ring_push(&net_outbound, &command);
+}
+
+
+// Queues command, Waits for network thread to make room if outbound queue is full
+static void net_command(net_event* command) {
+    while (!net_ring_push(&net_outbound, command)) ma_yield();
+}
+
+
+// Gives packet back to network thread, Which destroys it (Packets never sent or received ones)
+void net_release(ENetPacket* packet) {
+    net_event command = { NET_RELEASE, 0, 0, packet, 0, 0 };
+    
+    if (!packet) return;
+    
+    if (!c89atomic_load_32(&net_running)) {
+        enet_packet_destroy(packet);
+        return;
+    }
+    
+    net_command(&command);
+}
+
+
+// Disconnects peer after packets queued to it are sent (NET_DISCONNECT received once done)
+void net_disconnect(unsigned int peer) {
+    net_event command = { NET_DISCONNECT, peer, 0, NULL, 0, 0 };
+    if (c89atomic_load_32(&net_running)) net_command(&command);
+}
+
+
+// Returns time on clock of network events time (In seconds), So now minus event time is how long event waited
+double net_time(void) {
+    return ma_timer_get_time_in_seconds(&net_timer);
+}
+
+
+// Stops network thread, Disconnects peers and destroys host with queued and spare packets
+void net_close(void) {
+    net_event event;
+    
+    if (c89atomic_load_32(&net_running)) {
+        c89atomic_store_32(&net_running, 0);
+        ma_thread_wait(&net_thread);
+    }
+    
+    if (!net_host) return;
+    
+    // Commands still queued run, So disconnects and last packets reach peers
+    net_run_commands();
+    
+    while (net_ring_pop(&net_inbound, &event)) enet_packet_destroy(event.packet);
+    while (net_spare_tail != net_spare_head) enet_packet_destroy(net_spare[net_spare_tail++ % NET_SPARE_PACKETS]);
+    
+    for (size_t i = 0; i < net_host->peerCount; i++) {
+        if (net_host->peers[i].state == ENET_PEER_STATE_CONNECTED) enet_peer_disconnect_now(&net_host->peers[i], 0);
+    }
+    
+    enet_host_destroy(net_host);
+    net_host = NULL;
+    net_listening = false;
+    snapshot_close();
+    net_peer_count = 0;
+    
+    if (net_trace) fclose(net_trace);
+    net_trace = NULL;
+    
+    for (int i = 0; i < NET_BLOCK_CLASSES; i++) {
+        while (net_blocks[i]) {
+            net_block* block = net_blocks[i];
+            net_blocks[i] = block->next;
+            free(block);
+        }
+    }
+}
+
+
+void bitpack_init(bitpack* b, void* data, size_t size) {
+    b->data = (unsigned char*)data;
+    b->size = size;
+    b->position = 0;
+    b->scratch = 0;
+    b->scratch_bits = 0;
+    b->overflow = false;
+}
+
+
+// Writes low bits of value (Up to 32 bits), Whole bytes go to buffer as soon as they fill
+void bitpack_write(bitpack* b, unsigned int value, int bits) {
+    if (bits < 32) value &= (1u << bits) - 1;
+    b->scratch |= (unsigned long long)value << b->scratch_bits;
+    b->scratch_bits += bits;
+    
+    while (b->scratch_bits >= 8) {
+        if (b->position < b->size) {
+            b->data[b->position++] = (unsigned char)b->scratch;
+        } else {
+            b->overflow = true;
+        }
+        
+        b->scratch >>= 8;
+        b->scratch_bits -= 8;
+    }
+}
+
+
+// Writes value in groups of BITPACK_VARINT_BITS bits, Each followed by bit telling if more groups follow (Small values take few bits)
+void bitpack_write_varint(bitpack* b, unsigned int value) {
+    while (value >> BITPACK_VARINT_BITS) {
+        bitpack_write(b, (value & ((1u << BITPACK_VARINT_BITS) - 1)) | (1u << BITPACK_VARINT_BITS), BITPACK_VARINT_BITS + 1);
+        value >>= BITPACK_VARINT_BITS;
+    }
+    
+    bitpack_write(b, value, BITPACK_VARINT_BITS + 1);
+}
+
+
+// Writes signed value as varint, Zigzag encoded so small negative values stay small
+void bitpack_write_signed(bitpack* b, int value) {
+    bitpack_write_varint(b, ((unsigned int)value << 1) ^ (unsigned int)-(int)((unsigned int)value >> 31));
+}
+
+
+// Writes value clamped to min - max range, Quantized to bits (Precision is (max - min) / (2 ^ bits - 1))
+void bitpack_write_float(bitpack* b, float value, float min, float max, int bits) {
+    unsigned int steps = (bits < 32) ? ((1u << bits) - 1) : 0xFFFFFFFFu;
+    float t = (value - min) / (max - min);
+    t = (t < 0) ? 0 : ((t > 1) ? 1 : t);
+    bitpack_write(b, (unsigned int)((double)t * steps + 0.5), bits);
+}
+
+
+// Writes last partial byte, Returns bytes written (0 if buffer overflowed)
+size_t bitpack_flush(bitpack* b) {
+    if (b->scratch_bits > 0) bitpack_write(b, 0, 8 - b->scratch_bits);
+    return b->overflow ? 0 : b->position;
+}
+
+
+unsigned int bitpack_read(bitpack* b, int bits) {
+    while (b->scratch_bits < bits) {
+        if (b->position < b->size) {
+            b->scratch |= (unsigned long long)b->data[b->position++] << b->scratch_bits;
+        } else {
+            b->overflow = true;
+        }
+        
+        b->scratch_bits += 8;
+    }
+    
+    unsigned int value = (unsigned int)(b->scratch & ((bits < 32) ? ((1ull << bits) - 1) : 0xFFFFFFFFull));
+    b->scratch >>= bits;
+    b->scratch_bits -= bits;
+    return value;
+}
+
+
+unsigned int bitpack_read_varint(bitpack* b) {
+    unsigned int value = 0;
+    
+    for (int shift = 0; shift < 32; shift += BITPACK_VARINT_BITS) {
+        unsigned int group = bitpack_read(b, BITPACK_VARINT_BITS + 1);
+        value |= (group & ((1u << BITPACK_VARINT_BITS) - 1)) << shift;
+        if (!(group >> BITPACK_VARINT_BITS)) return value;
+    }
+    
+    b->overflow = true;
+    return value;
+}
+
+
+int bitpack_read_signed(bitpack* b) {
+    unsigned int value = bitpack_read_varint(b);
+    return (int)((value >> 1) ^ -(value & 1));
+}
+
+
+float bitpack_read_float(bitpack* b, float min, float max, int bits) {
+    unsigned int steps = (bits < 32) ? ((1u << bits) - 1) : 0xFFFFFFFFu;
+    return min + (float)((double)bitpack_read(b, bits) / steps) * (max - min);
+}
+
+
+// Sets entity state sent with next snapshots (Server)
+void snapshot_set(unsigned int id, snapshot_entity* entity) {
+    if (id >= SNAPSHOT_MAX_ENTITIES) return;
+    snapshot_entities[id] = *entity;
+    snapshot_present[id / 32] |= 1u << (id % 32);
+}
+
+
+// Stops sending entity with snapshots, Clients drop it once they get snapshot without it (Server)
+void snapshot_remove(unsigned int id) {
+    if (id >= SNAPSHOT_MAX_ENTITIES) return;
+    snapshot_present[id / 32] &= ~(1u << (id % 32));
+}
+
+
+static bool snapshot_alloc(void) {
+    if (!snapshot_frames) snapshot_frames = calloc(SNAPSHOT_HISTORY, sizeof(snapshot_frame));
+    if (!snapshot_peers && net_peer_count) snapshot_peers = calloc(net_peer_count, sizeof(snapshot_peer));
+    return snapshot_frames && snapshot_peers;
+}
+
+
+// Forgets snapshots sent to peer, So next one it gets has no baseline (Peer connected or disconnected)
+static void snapshot_peer_reset(net_event* event) {
+    if (!snapshot_alloc() || event->peer >= net_peer_count) return;
+    
+    // Views stay allocated for next peer using same slot
+    snapshot_peer* p = &snapshot_peers[event->peer];
+    snapshot_view* views = p->views;
+    
+    memset(p, 0, sizeof(snapshot_peer));
+    p->connected = (event->type == NET_CONNECT);
+    p->bandwidth = event->bandwidth;
+    p->views = views;
+}
+
+
+// Sets area peer gets entities in, Nearer entities get sent first when its bandwidth is short (Server, Radius 0 for all entities)
+void snapshot_interest(unsigned int peer, float x, float y, float radius) {
+    if (!snapshot_alloc() || peer >= net_peer_count) return;
+    snapshot_peers[peer].x = x;
+    snapshot_peers[peer].y = y;
+    snapshot_peers[peer].radius = radius;
+}
+
+
+// Returns interest grid cell of position (Clamped, So far away positions stay in range)
+static int snapshot_cell(float position) {
+    float cell = floorf(position / snapshot_cell_size);
+    if (!(cell > -1e9f)) return -1000000000;
+    return (cell < 1e9f) ? (int)cell : 1000000000;
+}
+
+
+static unsigned int snapshot_grid_bucket(int x, int y) {
+    return ((unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u) & (SNAPSHOT_GRID_BUCKETS - 1);
+}
+
+
+// Puts entities into buckets of interest grid by their cell (Server, Once per snapshot)
+static void snapshot_grid_build(void) {
+    for (int i = 0; i < SNAPSHOT_GRID_BUCKETS; i++) snapshot_grid[i] = -1;
+    
+    for (unsigned int id = 0; id < SNAPSHOT_MAX_ENTITIES; id++) {
+        if (!((snapshot_present[id / 32] >> (id % 32)) & 1)) continue;
+        
+        unsigned int bucket = snapshot_grid_bucket(snapshot_cell(snapshot_entities[id].x), snapshot_cell(snapshot_entities[id].y));
+        snapshot_grid_next[id] = snapshot_grid[bucket];
+        snapshot_grid[bucket] = (int)id;
+    }
+}
+
+
+// Adds entity to interest if it's in area of peer (Entities peer has leave only beyond SNAPSHOT_INTEREST_MARGIN times radius)
+static void snapshot_interest_check(snapshot_peer* p, snapshot_view* base_view, unsigned int* interest, unsigned int id) {
+    float dx = snapshot_entities[id].x - p->x;
+    float dy = snapshot_entities[id].y - p->y;
+    bool in_base = base_view && ((base_view->present[id / 32] >> (id % 32)) & 1);
+    float reach = in_base ? p->radius * SNAPSHOT_INTEREST_MARGIN : p->radius;
+    
+    if (dx * dx + dy * dy <= reach * reach) interest[id / 32] |= 1u << (id % 32);
+}
+
+
+// Finds entities in area of peer with interest grid (All entities if peer has no area)
+static void snapshot_interest_find(snapshot_peer* p, snapshot_view* base_view, unsigned int* interest) {
+    if (p->radius <= 0) {
+        memcpy(interest, snapshot_present, sizeof(snapshot_present));
+        return;
+    }
+    
+    memset(interest, 0, sizeof(snapshot_present));
+    
+    float reach = p->radius * SNAPSHOT_INTEREST_MARGIN;
+    int left = snapshot_cell(p->x - reach);
+    int right = snapshot_cell(p->x + reach);
+    int top = snapshot_cell(p->y - reach);
+    int bottom = snapshot_cell(p->y + reach);
+    
+    // Areas over many cells check all entities, Cheaper than visiting cells
+    if (right - left >= SNAPSHOT_GRID_SPAN || bottom - top >= SNAPSHOT_GRID_SPAN) {
+        for (unsigned int id = 0; id < SNAPSHOT_MAX_ENTITIES; id++) {
+            if ((snapshot_present[id / 32] >> (id % 32)) & 1) snapshot_interest_check(p, base_view, interest, id);
+        }
+        
+        return;
+    }
+    
+    // Cells sharing bucket are checked more than once, Which only sets same bit again
+    for (int y = top; y <= bottom; y++) {
+        for (int x = left; x <= right; x++) {
+            for (int id = snapshot_grid[snapshot_grid_bucket(x, y)]; id >= 0; id = snapshot_grid_next[id]) {
+                snapshot_interest_check(p, base_view, interest, (unsigned int)id);
+            }
+        }
+    }
+}
+
+
+// Returns how much sending entity to peer matters each snapshot it waits (Nearer entities matter more)
+static float snapshot_relevance(snapshot_peer* p, unsigned int id) {
+    if (p->radius <= 0) return 1;
+    
+    float dx = snapshot_entities[id].x - p->x;
+    float dy = snapshot_entities[id].y - p->y;
+    float distance = sqrtf(dx * dx + dy * dy) / (p->radius * SNAPSHOT_INTEREST_MARGIN);
+    return (distance < 0.95f) ? 1 - distance : 0.05f;
+}
+
+
+// Moves candidate down heap until it's below higher priority ones (Highest priority on top)
+static void snapshot_heap_down(snapshot_candidate* heap, unsigned int count, unsigned int i) {
+    snapshot_candidate candidate = heap[i];
+    
+    while (i * 2 + 1 < count) {
+        unsigned int child = i * 2 + 1;
+        if (child + 1 < count && heap[child + 1].priority > heap[child].priority) child++;
+        if (heap[child].priority <= candidate.priority) break;
+        
+        heap[i] = heap[child];
+        i = child;
+    }
+    
+    heap[i] = candidate;
+}
+
+
+// Quantizes entity into snapshot fields, So server and clients delta encode exactly same values
+static void snapshot_quantize(snapshot_entity* entity, int* fields) {
+    fields[0] = (int)lrintf(entity->x / snapshot_precision);
+    fields[1] = (int)lrintf(entity->y / snapshot_precision);
+    fields[2] = (int)lrintf(entity->vx / snapshot_precision);
+    fields[3] = (int)lrintf(entity->vy / snapshot_precision);
+    fields[4] = (int)lrintf(entity->angle * (SNAPSHOT_ANGLE_STEPS / 6.28318530718f)) & (SNAPSHOT_ANGLE_STEPS - 1);
+    fields[5] = (int)entity->type;
+    fields[6] = (int)entity->state;
+}
+
+
+// Moves baseline position by its velocity over ticks, So entities moving steadily need almost no bits
+static void snapshot_predict(int* fields, const int* base, unsigned int ticks, unsigned int tps) {
+    memcpy(fields, base, sizeof(int) * SNAPSHOT_FIELDS);
+    if (!tps) return;
+    fields[0] = (int)((unsigned int)base[0] + (unsigned int)(int)((long long)base[2] * ticks / tps));
+    fields[1] = (int)((unsigned int)base[1] + (unsigned int)(int)((long long)base[3] * ticks / tps));
+}
+
+
+// Writes field as difference from baseline (Angle wraps around, Type and state are written as they are)
+static void snapshot_write_field(bitpack* b, int field, int value, int base) {
+    if (field == 4) {
+        bitpack_write_signed(b, ((value - base + SNAPSHOT_ANGLE_STEPS / 2) & (SNAPSHOT_ANGLE_STEPS - 1)) - SNAPSHOT_ANGLE_STEPS / 2);
+    } else if (field >= 5) {
+        bitpack_write_varint(b, (unsigned int)value);
+    } else {
+        bitpack_write_signed(b, (int)((unsigned int)value - (unsigned int)base));
+    }
+}
+
+
+// Writes entity fields, Each with bit telling if it changed from prediction
+static void snapshot_write_entity(bitpack* b, const int* fields, const int* predicted) {
+    for (int field = 0; field < SNAPSHOT_FIELDS; field++) {
+        bitpack_write(b, fields[field] != predicted[field], 1);
+        if (fields[field] != predicted[field]) snapshot_write_field(b, field, fields[field], predicted[field]);
+    }
+}
+
+
+// Returns bits snapshot_write_entity takes for entity, Without writing it
+static unsigned int snapshot_entity_bits(const int* fields, const int* predicted) {
+    unsigned int bits = SNAPSHOT_FIELDS;
+    
+    for (int field = 0; field < SNAPSHOT_FIELDS; field++) {
+        if (fields[field] == predicted[field]) continue;
+        
+        unsigned int value = (unsigned int)fields[field];
+        
+        if (field < 5) {
+            int difference = (field == 4) ? ((fields[field] - predicted[field] + SNAPSHOT_ANGLE_STEPS / 2) & (SNAPSHOT_ANGLE_STEPS - 1)) - SNAPSHOT_ANGLE_STEPS / 2 : (int)((unsigned int)fields[field] - (unsigned int)predicted[field]);
+            value = ((unsigned int)difference << 1) ^ (unsigned int)-(int)((unsigned int)difference >> 31);
+        }
+        
+        bits += BITPACK_VARINT_BITS + 1;
+        while (value >>= BITPACK_VARINT_BITS) bits += BITPACK_VARINT_BITS + 1;
+    }
+    
+    return bits;
+}
+
+
+static int snapshot_read_field(bitpack* b, int field, int base) {
+    if (field == 4) return (base + bitpack_read_signed(b)) & (SNAPSHOT_ANGLE_STEPS - 1);
+    if (field >= 5) return (int)bitpack_read_varint(b);
+    return (int)((unsigned int)base + (unsigned int)bitpack_read_signed(b));
+}
+
+
+// Predicts entity from what peer has in baseline (Entities held back from fields peer predicted for them)
+static void snapshot_predict_view(int* predicted, snapshot_frame* base, snapshot_view* base_view, unsigned int* held, unsigned int id, unsigned int ticks) {
+    while (*held < base_view->held_count && base_view->held[*held] < id) (*held)++;
+    
+    bool is_held = *held < base_view->held_count && base_view->held[*held] == id;
+    snapshot_predict(predicted, is_held ? base_view->fields[*held] : base->fields[id], ticks, (unsigned int)game_tps);
+}
+
+
+// Encodes frame for peer as changes from what it has in base (Everything if base is NULL), Fills view with what peer will have
+// NOTE: Only entities in area of peer are sent, Highest priority first while they fit in budget (In bits, INFINITY for no limit). Changed entities left out are held back, Peer predicts them from velocity until they fit
+static size_t snapshot_encode(bitpack* b, snapshot_peer* p, snapshot_frame* frame, snapshot_frame* base, snapshot_view* base_view, snapshot_view* view, double budget) {
+    unsigned int ticks = base ? frame->tick - base->tick : 0;
+    unsigned int interest[SNAPSHOT_MAX_ENTITIES / 32];
+    unsigned int selected[SNAPSHOT_MAX_ENTITIES / 32] = { 0 };
+    int predicted[SNAPSHOT_FIELDS];
+    unsigned int count = 0;
+    unsigned int held_count = 0;
+    unsigned int held = 0;
+    unsigned int next = 0;
+    
+    snapshot_interest_find(p, base ? base_view : NULL, interest);
+    
+    // Entities new to peer or changed from its prediction may be sent, Each with bits it takes (Id and flags guessed as 8 bits)
+    for (unsigned int word = 0; word < SNAPSHOT_MAX_ENTITIES / 32; word++) {
+        unsigned int present_base = base ? base_view->present[word] : 0;
+        if (!(interest[word] | present_base)) continue;
+        
+        for (unsigned int bit = 0; bit < 32; bit++) {
+            unsigned int id = word * 32 + bit;
+            bool in_view = (interest[word] >> bit) & 1;
+            bool in_base = (present_base >> bit) & 1;
+            
+            if (!in_view) {
+                p->priority[id] = 0;
+                if (in_base) budget -= 16;
+                continue;
+            }
+            
+            if (in_base) {
+                snapshot_predict_view(predicted, base, base_view, &held, id, ticks);
+                
+                if (!memcmp(frame->fields[id], predicted, sizeof(predicted))) {
+                    p->priority[id] = 0;
+                    continue;
+                }
+                
+                held_count++;
+            } else {
+                memset(predicted, 0, sizeof(predicted));
+            }
+            
+            if (isinf(budget)) {
+                selected[word] |= 1u << bit;
+                continue;
+            }
+            
+            // Entities peer predicts badly get more urgent, Besides nearer ones
+            float dx = (frame->fields[id][0] - predicted[0]) * snapshot_precision;
+            float dy = (frame->fields[id][1] - predicted[1]) * snapshot_precision;
+            p->priority[id] += snapshot_relevance(p, id) * (1 + sqrtf(dx * dx + dy * dy) * 16 / snapshot_cell_size);
+            
+            snapshot_candidates[count].priority = p->priority[id];
+            snapshot_candidates[count].id = (unsigned short)id;
+            snapshot_candidates[count].bits = (unsigned short)(snapshot_entity_bits(frame->fields[id], predicted) + 8);
+            count++;
+        }
+    }
+    
+    // Highest priority first, Smaller entities still fit after bigger one didn't (Stops after 8 in row didn't fit, Ones left out wait with higher priority)
+    for (unsigned int i = count / 2; i-- > 0;) snapshot_heap_down(snapshot_candidates, count, i);
+    
+    unsigned int misses = 0;
+    budget -= 100;
+    
+    while (count && (misses < 8 || held_count > SNAPSHOT_MAX_HELD)) {
+        unsigned int id = snapshot_candidates[0].id;
+        unsigned int bits = snapshot_candidates[0].bits;
+        bool in_base = base && ((base_view->present[id / 32] >> (id % 32)) & 1);
+        
+        snapshot_candidates[0] = snapshot_candidates[--count];
+        snapshot_heap_down(snapshot_candidates, count, 0);
+        
+        // Peer gets changed entities it has anyway when too many would be held back
+        if (bits > budget && !(in_base && held_count > SNAPSHOT_MAX_HELD)) {
+            misses++;
+            continue;
+        }
+        
+        selected[id / 32] |= 1u << (id % 32);
+        budget -= bits;
+        misses = 0;
+        if (in_base) held_count--;
+    }
+    
+    bitpack_write(b, 0, 1);
+    bitpack_write(b, frame->sequence, 32);
+    bitpack_write(b, frame->tick, 32);
+    bitpack_write_varint(b, (unsigned int)game_tps);
+    bitpack_write_varint(b, base ? frame->sequence - base->sequence : 0);
+    
+    memset(view->present, 0, sizeof(view->present));
+    view->held_count = 0;
+    held = 0;
+    
+    for (unsigned int word = 0; word < SNAPSHOT_MAX_ENTITIES / 32; word++) {
+        unsigned int present_base = base ? base_view->present[word] : 0;
+        if (!(interest[word] | present_base)) continue;
+        
+        for (unsigned int bit = 0; bit < 32; bit++) {
+            unsigned int id = word * 32 + bit;
+            bool in_view = (interest[word] >> bit) & 1;
+            bool in_base = (present_base >> bit) & 1;
+            
+            if (!in_view && !in_base) continue;
+            
+            if (!in_view) {
+                bitpack_write(b, 1, 1);
+                bitpack_write_varint(b, id - next);
+                bitpack_write(b, 1, 1);
+                next = id + 1;
+                continue;
+            }
+            
+            if (in_base) {
+                snapshot_predict_view(predicted, base, base_view, &held, id, ticks);
+            } else {
+                memset(predicted, 0, sizeof(predicted));
+            }
+            
+            // Entities peer predicts right are left out, Changed ones not selected are held back (New ones wait)
+            if (in_base && !memcmp(frame->fields[id], predicted, sizeof(predicted))) {
+                view->present[word] |= 1u << bit;
+                continue;
+            }
+            
+            if (!((selected[word] >> bit) & 1)) {
+                if (!in_base) continue;
+                
+                if (view->held_count < SNAPSHOT_MAX_HELD) {
+                    view->present[word] |= 1u << bit;
+                    view->held[view->held_count] = (unsigned short)id;
+                    memcpy(view->fields[view->held_count], predicted, sizeof(predicted));
+                    view->held_count++;
+                    snapshot_held_count++;
+                    continue;
+                }
+            }
+            
+            bitpack_write(b, 1, 1);
+            bitpack_write_varint(b, id - next);
+            bitpack_write(b, 0, 1);
+            snapshot_write_entity(b, frame->fields[id], predicted);
+            view->present[word] |= 1u << bit;
+            p->priority[id] = 0;
+            next = id + 1;
+        }
+    }
+    
+    bitpack_write(b, 0, 1);
+    return bitpack_flush(b);
+}
+
+
+// Decodes snapshot into frame of its sequence, Returns false if its baseline isn't kept anymore or data is invalid
+static bool snapshot_decode(bitpack* b) {
+    int predicted[SNAPSHOT_FIELDS];
+    unsigned int sequence = bitpack_read(b, 32);
+    unsigned int tick = bitpack_read(b, 32);
+    unsigned int tps = bitpack_read_varint(b);
+    unsigned int distance = bitpack_read_varint(b);
+    
+    if (b->overflow || sequence == 0 || distance >= SNAPSHOT_HISTORY) return false;
+    
+    snapshot_frame* base = distance ? &snapshot_frames[(sequence - distance) % SNAPSHOT_HISTORY] : NULL;
+    if (base && base->sequence != sequence - distance) return false;
+    
+    snapshot_frame* frame = &snapshot_frames[sequence % SNAPSHOT_HISTORY];
+    memset(frame->present, 0, sizeof(frame->present));
+    
+    // Entities not written are where baseline predicts them
+    if (base) {
+        memcpy(frame->present, base->present, sizeof(frame->present));
+        
+        for (unsigned int id = 0; id < SNAPSHOT_MAX_ENTITIES; id++) {
+            if ((base->present[id / 32] >> (id % 32)) & 1) snapshot_predict(frame->fields[id], base->fields[id], tick - base->tick, tps);
+        }
+    }
+    
+    unsigned int next = 0;
+    
+    while (bitpack_read(b, 1)) {
+        unsigned int id = next + bitpack_read_varint(b);
+        bool removed = bitpack_read(b, 1);
+        if (b->overflow || id >= SNAPSHOT_MAX_ENTITIES) break;
+        
+        bool in_base = (frame->present[id / 32] >> (id % 32)) & 1;
+        next = id + 1;
+        
+        if (removed) {
+            frame->present[id / 32] &= ~(1u << (id % 32));
+            continue;
+        }
+        
+        frame->present[id / 32] |= 1u << (id % 32);
+        
+        if (in_base) {
+            memcpy(predicted, frame->fields[id], sizeof(predicted));
+        } else {
+            memset(predicted, 0, sizeof(predicted));
+        }
+        
+        for (int field = 0; field < SNAPSHOT_FIELDS; field++) {
+            frame->fields[id][field] = bitpack_read(b, 1) ? snapshot_read_field(b, field, predicted[field]) : predicted[field];
+        }
+    }
+    
+    if (b->overflow || next > SNAPSHOT_MAX_ENTITIES) {
+        frame->sequence = 0;
+        return false;
+    }
+    
+    frame->sequence = sequence;
+    frame->tick = tick;
+    snapshot_sequence = sequence;
+    return true;
+}
+
+
+// Captures entities into next snapshot, Sends each connected peer changes since last snapshot it acknowledged (Server, Call once per update)
+void snapshot_send(void) {
+    bitpack b;
+    
+    if (!net_listening || !snapshot_alloc()) return;
+    
+    snapshot_sequence++;
+    if (snapshot_sequence == 0) snapshot_sequence++;
+    
+    snapshot_frame* frame = &snapshot_frames[snapshot_sequence % SNAPSHOT_HISTORY];
+    frame->sequence = snapshot_sequence;
+    frame->tick = (unsigned int)update_count;
+    memcpy(frame->present, snapshot_present, sizeof(frame->present));
+    
+    for (unsigned int id = 0; id < SNAPSHOT_MAX_ENTITIES; id++) {
+        if ((snapshot_present[id / 32] >> (id % 32)) & 1) snapshot_quantize(&snapshot_entities[id], frame->fields[id]);
+    }
+    
+    snapshot_grid_build();
+    
+    unsigned int connected = 0;
+    for (unsigned int peer = 0; peer < net_peer_count; peer++) connected += snapshot_peers[peer].connected;
+    
+    for (unsigned int peer = 0; peer < net_peer_count; peer++) {
+        snapshot_peer* p = &snapshot_peers[peer];
+        if (!p->connected) continue;
+        
+        if (!p->views) p->views = calloc(SNAPSHOT_HISTORY, sizeof(snapshot_view));
+        if (!p->views) continue;
+        
+        // Baseline is newest snapshot peer acknowledged, If still kept
+        snapshot_frame* base = NULL;
+        snapshot_view* base_view = NULL;
+        
+        if (p->acked && snapshot_sequence - p->acked < SNAPSHOT_HISTORY) {
+            base = &snapshot_frames[p->acked % SNAPSHOT_HISTORY];
+            base_view = &p->views[p->acked % SNAPSHOT_HISTORY];
+        } else {
+            snapshot_full_count++;
+        }
+        
+        // Peer gets snapshots within smallest bandwidth limit, Host outgoing bandwidth is split among peers (Budget saved for 2 snapshots at most)
+        unsigned int limit = snapshot_bandwidth;
+        if (p->bandwidth && (!limit || p->bandwidth < limit)) limit = p->bandwidth;
+        if (net_outgoing_bandwidth && (!limit || net_outgoing_bandwidth / connected < limit)) limit = net_outgoing_bandwidth / connected;
+        
+        if (limit) {
+            double refill = limit * 8.0 / (game_tps > 0 ? game_tps : 1);
+            p->budget = (p->budget + refill < refill * 2) ? p->budget + refill : refill * 2;
+        }
+        
+        bitpack_init(&b, snapshot_buffer, sizeof(snapshot_buffer));
+        size_t size = snapshot_encode(&b, p, frame, base, base_view, &p->views[snapshot_sequence % SNAPSHOT_HISTORY], limit ? p->budget : INFINITY);
+        if (!size) continue;
+        
+        // Sent unreliable even when fragmented, Lost snapshots are replaced by next ones anyway
+        ENetPacket* packet = net_packet(size, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+        if (!packet) continue;
+        
+        memcpy(packet->data, snapshot_buffer, size);
+        
+        if (net_send(peer, SNAPSHOT_CHANNEL, packet)) {
+            p->sent[snapshot_sequence % SNAPSHOT_HISTORY] = snapshot_sequence;
+            snapshot_bytes_sent += size;
+            if (limit) p->budget -= size * 8.0;
+        } else {
+            net_release(packet);
+        }
+    }
+}
+
+
+// Handles packet received on SNAPSHOT_CHANNEL, Snapshot from server or acknowledgement from client
+static void snapshot_receive(net_event* event) {
+    unsigned char ack[8];
+    bitpack b;
+    
+    if (!snapshot_alloc() || event->peer >= net_peer_count) return;
+    
+    bitpack_init(&b, event->packet->data, event->packet->dataLength);
+    
+    // Server takes only acknowledgements and client only snapshots, So clients can't overwrite baselines of server
+    if (bitpack_read(&b, 1)) {
+        if (!net_listening) return;
+        
+        // Acknowledgements only count for snapshots really sent to peer and still kept as baselines
+        snapshot_peer* p = &snapshot_peers[event->peer];
+        unsigned int acked = bitpack_read(&b, 32);
+        
+        if (!b.overflow && acked && p->sent[acked % SNAPSHOT_HISTORY] == acked && (int)(acked - p->acked) > 0) {
+            p->acked = acked;
+        }
+        
+        return;
+    }
+    
+    if (net_listening || !snapshot_decode(&b)) return;
+    
+    bitpack_init(&b, ack, sizeof(ack));
+    bitpack_write(&b, 1, 1);
+    bitpack_write(&b, snapshot_sequence, 32);
+    size_t size = bitpack_flush(&b);
+    
+    ENetPacket* packet = net_packet(size, 0);
+    if (!packet) return;
+    
+    memcpy(packet->data, ack, size);
+    if (!net_send(event->peer, SNAPSHOT_CHANNEL, packet)) net_release(packet);
+}
+
+
+// Returns entity state in last snapshot received (Client, False if entity isn't in it)
+bool snapshot_get(unsigned int id, snapshot_entity* entity) {
+    if (!snapshot_frames || !snapshot_sequence || id >= SNAPSHOT_MAX_ENTITIES) return false;
+    
+    snapshot_frame* frame = &snapshot_frames[snapshot_sequence % SNAPSHOT_HISTORY];
+    if (frame->sequence != snapshot_sequence || !((frame->present[id / 32] >> (id % 32)) & 1)) return false;
+    
+    int* fields = frame->fields[id];
+    entity->x = fields[0] * snapshot_precision;
+    entity->y = fields[1] * snapshot_precision;
+    entity->vx = fields[2] * snapshot_precision;
+    entity->vy = fields[3] * snapshot_precision;
+    entity->angle = fields[4] * (6.28318530718f / SNAPSHOT_ANGLE_STEPS);
+    entity->type = (unsigned int)fields[5];
+    entity->state = (unsigned int)fields[6];
+    return true;
+}
+
+
+// Frees snapshots kept as baselines (Called when game closes)
+void snapshot_close(void) {
+    for (unsigned int peer = 0; snapshot_peers && peer < net_peer_count; peer++) free(snapshot_peers[peer].views);
+    free(snapshot_frames);
+    free(snapshot_peers);
+    snapshot_frames = NULL;
+    snapshot_peers = NULL;
+    snapshot_sequence = 0;
 }
@@ -0,0 +1,233 @@
+// Headless Physac stress and determinism check, Built with CMake option PHYSICS_BENCH
+// Usage: physics-bench [bodies] [steps] (5000 bodies and 600 steps by default)
+// Exits with 1 if any check fails, So it can be run by scripts too
+#define PHYSAC_IMPLEMENTATION
+#define PHYSAC_STANDALONE
+#define PHYSAC_NO_LOOP_THREAD
+#define PHYSAC_MAX_BODIES 16384
+#define PHYSAC_MAX_MANIFOLDS 65536
+#if defined(_MSC_VER)
+#define PHYSAC_NO_THREADS               // MSVC has no pthreads (Islands solved by stepping thread only)
+#endif
+#define BENCH_STEP (1000.0 / 600.0)     // Physics step of stress and stacking runs in milliseconds (Physac default)
+#define BENCH_COARSE_STEP (1000.0 / 60.0)   // Physics step projectiles get fired with in milliseconds
+
+#include <physac/physac.h>           // Included first, Defines _POSIX_C_SOURCE before system headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+
+const char* broadphase_names[] = { "brute force", "grid", "sweep and prune" };
+const char* simd_names[] = { "scalar", "sse2", "avx2" };
+unsigned int bench_seed;                // Scene random state (Own generator, So scene is the same with any C library)
+
+
+// Returns time in seconds from monotonic clock
+double bench_time(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+
+// Returns random number in [0, range)
+int bench_random(int range) {
+    bench_seed = bench_seed * 1103515245u + 12345u;
+    return (int)((bench_seed >> 16) % (unsigned int)range);
+}
+
+
+// Creates mixed circles, boxes and polygons falling into static container
+void bench_scene(int count) {
+    int columns = 100;
+    bench_seed = 1;
+    
+    PhysicsBody floor = CreatePhysicsBodyRectangle((Vector2) { 1000, 2100 }, 2200, 100, 10);
+    PhysicsBody left = CreatePhysicsBodyRectangle((Vector2) { -50, 1000 }, 100, 2300, 10);
+    PhysicsBody right = CreatePhysicsBodyRectangle((Vector2) { 2050, 1000 }, 100, 2300, 10);
+    floor->enabled = false;
+    left->enabled = false;
+    right->enabled = false;
+    
+    for (int i = 0; i < count - 3; i++) {
+        Vector2 position = { 10.0f + (i % columns) * 19.8f, 2000.0f - (i / columns) * 20.0f };
+        PhysicsBody body;
+    
+        switch (bench_random(3)) {
+            case 0: body = CreatePhysicsBodyCircle(position, 4.0f + bench_random(5), 1); break;
+            case 1: body = CreatePhysicsBodyRectangle(position, 6.0f + bench_random(10), 6.0f + bench_random(10), 1); break;
+            default: body = CreatePhysicsBodyPolygon(position, 5.0f + bench_random(4), 3 + bench_random(6), 1); break;
+        }
+    
+        if (!body) break;
+        SetPhysicsBodyRotation(body, bench_random(628) * 0.01f);
+        body->velocity = (Vector2) { (bench_random(200) - 100) * 0.001f, 0 };
+    }
+}
+
+
+// Runs scene with given settings, Returns hash of bodies state after last step
+unsigned int bench_run(int bodies, int steps, PhysicsBroadphaseType broadphase, PhysicsSimdType simd, int threads) {
+    InitPhysics();
+    SetPhysicsTimeStep(BENCH_STEP);
+    SetPhysicsBroadphase(broadphase);
+    SetPhysicsSimd(simd);
+    SetPhysicsThreads(threads);
+    bench_scene(bodies);
+    
+    double start = bench_time();
+    int pairs = 0;
+    
+    for (int i = 0; i < steps; i++) {
+        StepPhysics();
+        pairs += GetPhysicsBroadphasePairsCount();
+    }
+    
+    double elapsed = bench_time() - start;
+    unsigned int hash = GetPhysicsHash();
+    
+    printf("%-16s %-7s %d threads: %8.3f ms/step, %8d pairs/step, %5d awake, hash %08x\n",
+        broadphase_names[broadphase], simd_names[GetPhysicsSimd()], GetPhysicsThreads(),
+        elapsed * 1000.0 / steps, pairs / steps, GetPhysicsAwakeBodiesCount(), hash);
+    
+    ClosePhysics();
+    return hash;
+}
+
+
+// Stacks box pyramid and returns how far its top box sank after given steps
+float bench_stack(int iterations, bool warm_starting, int steps) {
+    int rows = 20;
+    float size = 20.0f;
+    
+    InitPhysics();
+    SetPhysicsTimeStep(BENCH_STEP);
+    SetPhysicsCollisionIterations(iterations);
+    SetPhysicsWarmStarting(warm_starting);
+    SetPhysicsSleeping(false);
+    
+    PhysicsBody floor = CreatePhysicsBodyRectangle((Vector2) { 500, 1000 }, 1000, 40, 10);
+    PhysicsBody top = NULL;
+    floor->enabled = false;
+    
+    for (int row = 0; row < rows; row++) {
+        for (int i = 0; i < rows - row; i++) {
+            Vector2 position = { 500.0f + (i - (rows - row - 1) * 0.5f) * (size + 0.5f), 980.0f - size * 0.5f - row * size };
+            top = CreatePhysicsBodyRectangle(position, size, size, 1);
+        }
+    }
+    
+    float start = top->position.y;
+    double time = bench_time();
+    
+    for (int i = 0; i < steps; i++) StepPhysics();
+    
+    float sunk = top->position.y - start;
+    printf("pyramid %d rows, %3d iterations, warm starting %-3s: top box sank %7.3f after %d steps (%.3f ms/step)\n",
+        rows, iterations, warm_starting ? "on" : "off", sunk, steps, (bench_time() - time) * 1000.0 / steps);
+    
+    ClosePhysics();
+    return sunk;
+}
+
+
+// Fires fast circles and polygons at thin wall with coarse steps, Returns how many ended behind it
+int bench_tunnel(bool bullets) {
+    int count = 64;
+    int through = 0;
+    PhysicsBody projectiles[64];
+    
+    InitPhysics();
+    SetPhysicsTimeStep(BENCH_COARSE_STEP);
+    SetPhysicsGravity(0, 0);
+    
+    PhysicsBody wall = CreatePhysicsBodyRectangle((Vector2) { 500, 300 }, 4, 2000, 10);
+    wall->enabled = false;
+    
+    for (int i = 0; i < count; i++) {
+        Vector2 position = { 100, i * 25.0f - 500.0f };
+        projectiles[i] = (i % 2) ? CreatePhysicsBodyPolygon(position, 4, 4, 1) : CreatePhysicsBodyCircle(position, 3, 1);
+        projectiles[i]->velocity = (Vector2) { 3.0f + i * 0.05f, (i % 5) * 0.1f - 0.2f };
+        projectiles[i]->isBullet = bullets;
+    }
+    
+    for (int i = 0; i < 20; i++) StepPhysics();
+    for (int i = 0; i < count; i++) if (projectiles[i]->position.x > 500) through++;
+    
+    printf("%d projectiles at thin wall, %.0f Hz, continuous collision %-3s: %d tunneled\n", count, 1000.0 / BENCH_COARSE_STEP, bullets ? "on" : "off", through);
+    
+    ClosePhysics();
+    return through;
+}
+
+
+int main(int argc, char** argv) {
+    int bodies = (argc > 1) ? atoi(argv[1]) : 5000;
+    int steps = (argc > 2) ? atoi(argv[2]) : 600;
+    bool failed = false;
+    
+    if (bodies < 4 || bodies > PHYSAC_MAX_BODIES || steps < 1) {
+        printf("Usage: physics-bench [bodies (4 - %d)] [steps]\n", PHYSAC_MAX_BODIES);
+        return 1;
+    }
+    
+    // Same scene must give same hash with any SIMD kernel and any threads count, Broadphases are only timed
+    InitPhysics();
+    PhysicsSimdType best = GetPhysicsSimd();
+    ClosePhysics();
+    
+    printf("%d bodies, %d steps\n\n", bodies, steps);
+    unsigned int reference = bench_run(bodies, steps, PHYSICS_BROADPHASE_GRID, PHYSICS_SIMD_NONE, 1);
+    
+    for (int simd = PHYSICS_SIMD_NONE; simd <= (int)best; simd++) {
+        for (int threads = 1; threads <= 4; threads *= 2) {
+            if (simd == PHYSICS_SIMD_NONE && threads == 1) continue;
+    
+            if (bench_run(bodies, steps, PHYSICS_BROADPHASE_GRID, simd, threads) != reference) {
+                printf("FAILED: hash differs from scalar single thread run\n");
+                failed = true;
+            }
+        }
+    }
+    
+    bench_run(bodies, steps, PHYSICS_BROADPHASE_SAP, best, 1);
+    // Brute force tests every pair, So it's only timed on smaller scenes for fewer steps
+    if (bodies <= 2000) bench_run(bodies, (steps < 60) ? steps : 60, PHYSICS_BROADPHASE_NONE, best, 1);
+    
+    // Warm started solver must hold pyramid with 10 iterations about as well as cold one with 100
+    printf("\n");
+    float warm = bench_stack(10, true, 600);
+    float cold = bench_stack(100, false, 600);
+    bench_stack(10, false, 600);
+    
+    if (warm > cold + 1.0f) {
+        printf("FAILED: warm started pyramid sank more than cold one with 100 iterations\n");
+        failed = true;
+    }
+    
+    // Bullets must not pass thin wall at coarse step
+    printf("\n");
+    bench_tunnel(false);
+    
+    if (bench_tunnel(true)) {
+        printf("FAILED: bullets tunneled through wall\n");
+        failed = true;
+    }
+    
+    printf("\n%s\n", failed ? "FAILED" : "PASSED");
+    return failed ? 1 : 0;
+}